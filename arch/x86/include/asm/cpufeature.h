@@ -31,6 +31,7 @@
 #define _CPUF_I386_SSSE3	10
 #define _CPUF_I386_SSE4_1	11
 #define _CPUF_I386_SSE4_2	12
+#define _CPUF_I386_AES		13
 
 /* CPUID flags */
 /* OBSOLETE (see below)! */
@@ -46,6 +47,7 @@
 #define CPUID1_ECX_SSSE3	(1L << 9)
 #define CPUID1_ECX_SSE4_1	(1L << 19)
 #define CPUID1_ECX_SSE4_2	(1L << 20)
+#define CPUID1_ECX_AES		(1L << 25)
 
 /* OBSOLETE (see below)! */
 int cpufeature(int featureno);
@@ -0,0 +1,19 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#ifndef __ASM_X86_SMP_H
+#define __ASM_X86_SMP_H
+
+#ifndef __ASSEMBLY__
+
+int smp_init(void);
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __ASM_X86_SMP_H */
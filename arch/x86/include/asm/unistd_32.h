@@ -111,6 +111,10 @@
 #define __NR_getsysinfo_up	89	/* to PM or FS */
 #define __NR_svrctl		90
 
+#define __NR_epoll_create	91
+#define __NR_epoll_ctl		92
+#define __NR_epoll_wait		93
+
 #if defined(__KERNEL__) || defined(__UKERNEL__)
 
 #include <nucleos/types.h>
@@ -88,17 +88,22 @@
 #define SPL0				0x0
 #define	SPLHI				0xF
 
+#ifndef CONFIG_SMP
 /*
- * to make APIC work if SMP is not configured, we need to set the maximal number
- * fo CPUS to 1, cpuid to return 0 and the current cpu is always BSP
+ * to make APIC work if SMP is not configured, cpuid returns 0 and the current
+ * cpu is always BSP (CONFIG_MAX_CPUS is 1, see kernel/const.h)
  */
-#define CONFIG_MAX_CPUS 1
 #define cpu_is_bsp(x) 1
 
 static int cpuid(void)
 {
 	return 0;
 }
+#else
+/* The BSP is cpu 0, the APs are numbered as smp_init() found them */
+#define cpu_is_bsp(x) ((x) == 0)
+#define cpuid() arch_cpuid()
+#endif
 
 #define lapic_write_icr1(val)	lapic_write(LAPIC_ICR1, val)
 #define lapic_write_icr2(val)	lapic_write(LAPIC_ICR2, val)
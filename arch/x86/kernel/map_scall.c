@@ -206,6 +206,33 @@ static int msg_dup2(kipc_msg_t *msg, const struct pt_regs *r)
 	return 0;
 }
 
+static int msg_epoll_create(kipc_msg_t *msg, const struct pt_regs *r)
+{
+	msg->m_data1 = r->bx;	/* size (hint only) */
+
+	return 0;
+}
+
+static int msg_epoll_ctl(kipc_msg_t *msg, const struct pt_regs *r)
+{
+	msg->EP_FD = r->bx;	/* epoll handle */
+	msg->EP_OP = r->cx;	/* operation */
+	msg->EP_TFD = r->dx;	/* target descriptor */
+	msg->EP_EVENT = r->si;	/* event */
+
+	return 0;
+}
+
+static int msg_epoll_wait(kipc_msg_t *msg, const struct pt_regs *r)
+{
+	msg->EP_FD = r->bx;		/* epoll handle */
+	msg->EP_EVENTS = r->cx;		/* events */
+	msg->EP_MAXEVENTS = r->dx;	/* maxevents */
+	msg->EP_TIMEOUT = r->si;	/* timeout */
+
+	return 0;
+}
+
 static int msg_exec(kipc_msg_t *msg, const struct pt_regs *r)
 {
 	msg->m_data4 = r->bx;	/* filename */
@@ -968,4 +995,8 @@ static struct endpt_args scall_to_srv[] = {
 	SCALL_TO_SRV(wait,		PM),
 	SCALL_TO_SRV(waitpid,		PM),
 	SCALL_TO_SRV(write,		VFS),	/* 90 */
+
+	SCALL_TO_SRV(epoll_create,	VFS),
+	SCALL_TO_SRV(epoll_ctl,	VFS),
+	SCALL_TO_SRV(epoll_wait,	VFS),
 };
@@ -0,0 +1,208 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+/*
+ * Multiprocessor support. The processors are enumerated from the MP
+ * configuration table of the BIOS and numbered for cpuid(), the BSP enables
+ * its local APIC. The APs are not started until the kernel can schedule
+ * processes on them; everything runs on the BSP.
+ */
+#include <nucleos/string.h>
+#include <kernel/kernel.h>
+#include <kernel/proc.h>
+#include <kernel/glo.h>
+#include <kernel/proto.h>
+#include <asm/kernel/const.h>
+#include <asm/kernel/proto.h>
+#include <asm/apic.h>
+#include <asm/smp.h>
+
+/* MP floating pointer structure */
+struct mp_fps {
+	char sig[4];			/* "_MP_" */
+	u32_t config;			/* physical address of the config table */
+	u8_t len;			/* in 16 bytes units */
+	u8_t rev;
+	u8_t cksum;
+	u8_t feature[5];
+} __attribute__((packed));
+
+/* MP configuration table header */
+struct mp_config {
+	char sig[4];			/* "PCMP" */
+	u16_t len;			/* base table length */
+	u8_t rev;
+	u8_t cksum;
+	char oem[8];
+	char product[12];
+	u32_t oem_table;
+	u16_t oem_len;
+	u16_t count;			/* number of entries */
+	u32_t lapic;			/* local APIC address */
+	u16_t ext_len;
+	u8_t ext_cksum;
+	u8_t reserved;
+} __attribute__((packed));
+
+/* Processor entry of the configuration table */
+struct mp_proc {
+	u8_t type;			/* MP_PROCESSOR */
+	u8_t apic_id;
+	u8_t apic_ver;
+	u8_t flags;
+	u32_t signature;
+	u32_t features;
+	u32_t reserved[2];
+} __attribute__((packed));
+
+#define MP_PROCESSOR		0
+#define MP_PROC_SIZE		20	/* other entries are 8 bytes */
+#define MP_PROC_ENABLED		0x01
+#define MP_PROC_BSP		0x02
+
+#define MP_CONFIG_MAX		4096
+
+#define BDA_EBDA_SEG		0x40e	/* segment of the extended BIOS data */
+#define BDA_BASE_MEM		0x413	/* base memory size in KB */
+
+static u8_t cpu_apicid[CONFIG_MAX_CPUS];
+
+static u8_t mp_buf[MP_CONFIG_MAX];
+
+static int mp_cksum(u8_t *p, unsigned len)
+{
+	u8_t sum = 0;
+
+	while (len--)
+		sum += *p++;
+
+	return sum;
+}
+
+/* Look for the MP floating pointer in [base, base + len). */
+static phys_bytes mp_search(phys_bytes base, unsigned len)
+{
+	struct mp_fps *fps;
+	unsigned chunk, off;
+
+	for (; len > 0; base += chunk, len -= chunk) {
+		chunk = len < 1024 ? len : 1024;
+		phys_copy(vir2phys(mp_buf), base, chunk);
+
+		for (off = 0; off + sizeof(*fps) <= chunk; off += 16) {
+			fps = (struct mp_fps *) (mp_buf + off);
+			if (!memcmp(fps->sig, "_MP_", 4) && fps->len == 1 &&
+			    !mp_cksum((u8_t *) fps, sizeof(*fps)))
+				return fps->config;
+		}
+	}
+
+	return 0;
+}
+
+/* Find the enabled processors. Returns the number of CPUs or 0. */
+static unsigned mp_scan(void)
+{
+	struct mp_config *cfg = (struct mp_config *) mp_buf;
+	struct mp_proc *pe;
+	phys_bytes config = 0;
+	u16_t ebda, basemem;
+	u8_t *p, *end;
+	unsigned n, i;
+
+	phys_copy(vir2phys(&ebda), BDA_EBDA_SEG, sizeof(ebda));
+	phys_copy(vir2phys(&basemem), BDA_BASE_MEM, sizeof(basemem));
+
+	if (ebda)
+		config = mp_search((phys_bytes) ebda << 4, 1024);
+	if (!config && basemem)
+		config = mp_search(((phys_bytes) basemem - 1) * 1024, 1024);
+	if (!config)
+		config = mp_search(0xf0000, 0x10000);
+	if (!config)
+		return 0;
+
+	phys_copy(vir2phys(mp_buf), config, sizeof(*cfg));
+	if (memcmp(cfg->sig, "PCMP", 4) || cfg->len > MP_CONFIG_MAX ||
+	    cfg->len < sizeof(*cfg))
+		return 0;
+
+	phys_copy(vir2phys(mp_buf), config, cfg->len);
+	if (mp_cksum(mp_buf, cfg->len))
+		return 0;
+
+	/* The BSP is always cpu 0. */
+	n = 1;
+	cpu_apicid[0] = bsp_lapic_id;
+
+	p = mp_buf + sizeof(*cfg);
+	end = mp_buf + cfg->len;
+	for (i = 0; i < cfg->count && p < end; i++) {
+		if (*p != MP_PROCESSOR) {
+			p += 8;
+			continue;
+		}
+
+		pe = (struct mp_proc *) p;
+		p += MP_PROC_SIZE;
+
+		if (!(pe->flags & MP_PROC_ENABLED) || pe->apic_id == bsp_lapic_id)
+			continue;
+
+		if (n == CONFIG_MAX_CPUS) {
+			printk("SMP: CPU with APIC id %d over the limit of %d CPUs\n",
+			       pe->apic_id, CONFIG_MAX_CPUS);
+			continue;
+		}
+
+		cpu_apicid[n] = pe->apic_id;
+		apicid2cpuid[pe->apic_id] = n;
+		n++;
+	}
+
+	return n;
+}
+
+/*===========================================================================*
+ *				arch_cpuid				     *
+ *===========================================================================*/
+int arch_cpuid(void)
+{
+	if (!lapic_addr)
+		return 0;
+
+	return apicid2cpuid[lapic_read(LAPIC_ID) >> 24];
+}
+
+/*===========================================================================*
+ *				smp_init				     *
+ *===========================================================================*/
+int smp_init(void)
+{
+	unsigned cpu, n;
+
+	if (!apic_single_cpu_init())
+		return 0;
+
+	bsp_lapic_id = lapic_read(LAPIC_ID) >> 24;
+	apicid2cpuid[bsp_lapic_id] = 0;
+
+	if ((n = mp_scan()) <= 1) {
+		BOOT_VERBOSE(printk("SMP: no MP table or single CPU\n"));
+		return 1;
+	}
+
+	for (cpu = 1; cpu < n; cpu++)
+		BOOT_VERBOSE(printk("SMP: CPU %d (APIC id %d) left halted\n",
+				    cpu, cpu_apicid[cpu]));
+
+	printk("SMP: %d CPUs found, using the boot CPU only\n", n);
+
+	return 1;
+}
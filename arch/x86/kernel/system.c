@@ -27,6 +27,9 @@
 #ifdef CONFIG_X86_LOCAL_APIC
 #include <asm/apic.h>
 #endif
+#ifdef CONFIG_SMP
+#include <asm/smp.h>
+#endif
 
 #define CR0_EM		0x0004		/* set to enable trap on any FP instruction */
 #define CR0_MP_NE	0x0022		/* set MP and NE flags to handle FPU 
@@ -167,6 +170,15 @@ void arch_init(void)
 		BOOT_VERBOSE(printk("APIC not present, using legacy PIC\n"));
 	}
 #endif
+
+#ifdef CONFIG_SMP
+	if (config_no_apic) {
+		BOOT_VERBOSE(printk("APIC disabled, using legacy PIC and one CPU\n"));
+	}
+	else if (!smp_init()) {
+		BOOT_VERBOSE(printk("APIC not present, using legacy PIC and one CPU\n"));
+	}
+#endif
 }
 
 #define COM1_BASE	0x3F8
@@ -207,17 +219,24 @@ void do_ser_debug()
 
 static void ser_dump_queues(void)
 {
-	int q;
-	for(q = 0; q < NR_SCHED_QUEUES; q++) {
-		struct proc *p;
+	int q, cpu;
+	for(cpu = 0; cpu < CONFIG_MAX_CPUS; cpu++) {
+		struct runqueue *rq = cpu_rq(cpu);
+
+		if(CONFIG_MAX_CPUS > 1)
+			printk("cpu %d:\n", cpu);
+
+		for(q = 0; q < NR_SCHED_QUEUES; q++) {
+			struct proc *p;
 
-		if(rdy_head[q])
-			printk("%2d: ", q);
+			if(rq->rdy_head[q])
+				printk("%2d: ", q);
 
-		for(p = rdy_head[q]; p; p = p->p_nextready) {
-			printk("%s / %d  ", p->p_name, p->p_endpoint);
+			for(p = rq->rdy_head[q]; p; p = p->p_nextready) {
+				printk("%s / %d  ", p->p_name, p->p_endpoint);
+			}
+			printk("\n");
 		}
-		printk("\n");
 	}
 }
 
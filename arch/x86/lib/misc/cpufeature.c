@@ -65,6 +65,9 @@ int cpufeature(int featureno)
 			return cpuid_feature_ecx & CPUID1_ECX_SSE4_1;
 		case _CPUF_I386_SSE4_2:
 			return cpuid_feature_ecx & CPUID1_ECX_SSE4_2;
+		case _CPUF_I386_AES:
+			return (cpuid_feature_edx & CPUID1_EDX_FXSR) &&
+			       (cpuid_feature_ecx & CPUID1_ECX_AES);
 	}
 
 	return 0;
@@ -32,6 +32,7 @@
 #include <nucleos/endpoint.h>
 #include <ibm/pci.h>
 #include <nucleos/mman.h>
+#include <nucleos/dpoll.h>
 #include <asm/ioctls.h>
 
 #define ATAPI_DEBUG	    0	/* To debug ATAPI code. */
@@ -238,6 +239,7 @@ struct command {
 #define MAX_DRIVES         8
 #define COMPAT_DRIVES      4
 #define MAX_SECS	 256	/* controller can transfer this many sectors */
+#define MAX_SECS_EXT	8192	/* LBA48 DMA, one PRDT of N_PRDTE pages */
 #define MAX_ERRORS         4	/* how often to try rd/wt before quitting */
 #define NR_MINORS       (MAX_DRIVES * DEV_PER_DRIVE)
 #define SUB_PER_DRIVE	(NR_PARTITIONS * NR_PARTITIONS)
@@ -245,6 +247,7 @@ struct command {
 #define DELAY_USECS     1000	/* controller timeout in microseconds */
 #define DELAY_TICKS 	   1	/* controller timeout in ticks */
 #define DEF_TIMEOUT_TICKS 	300	/* controller timeout in ticks */
+#define DEF_POLL_US		50	/* poll for DMA completion below this */
 #define RECOVERY_USECS 500000	/* controller recovery time in microseconds */
 #define RECOVERY_TICKS    30	/* controller recovery time in ticks */
 #define INITIALIZED	0x01	/* drive is initialized */
@@ -264,7 +267,7 @@ struct command {
 int timeout_ticks = DEF_TIMEOUT_TICKS, max_errors = MAX_ERRORS;
 long w_standard_timeouts = 0, w_pci_debug = 0, w_instance = 0,
 	disable_dma = 0, atapi_debug = 0, w_identify_wakeup_ticks,
-	wakeup_ticks, w_atapi_dma;
+	wakeup_ticks, w_atapi_dma, w_poll_us = DEF_POLL_US;
 
 int w_testing = 0, w_silent = 0;
 
@@ -299,7 +302,9 @@ static struct wini {		/* main drive struct, one entry per drive */
   unsigned ldhpref;		/* top four bytes of the LDH (head) register */
   unsigned precomp;		/* write precompensation cylinder / 4 */
   unsigned max_count;		/* max request for this drive */
+  unsigned max_dma_count;	/* max DMA request for this drive */
   unsigned open_ct;		/* in-use count */
+  struct dpoll dpoll;		/* polled or interrupt DMA completion */
   struct device part[DEV_PER_DRIVE];	/* disks and partitions */
   struct device subpart[SUB_PER_DRIVE];	/* subpartitions */
 } wini[MAX_DRIVES], *w_wn;
@@ -340,6 +345,8 @@ static phys_bytes prdt_phys;
 
 #define PRDTE_FL_EOT	0x80	/* End of table */
 
+#define PRD_PAGE_SIZE	4096	/* buffers are contiguous within a page */
+
 /* Some IDE devices announce themselves as RAID controllers */
 static struct
 {
@@ -369,6 +376,8 @@ static int com_out_ext(struct command *cmd);
 static void setup_dma(unsigned *sizep, int proc_nr,
 			iovec_t *iov, size_t addr_offset, int do_write,
 			int *do_copyoutp);
+static int dma_umap(int proc_nr, iovec_t *iop, size_t offset,
+			unsigned size, phys_bytes *physp);
 static void w_need_reset(void);
 static void ack_irqs(unsigned int);
 static int w_do_close(struct driver *dp, kipc_msg_t *m_ptr);
@@ -379,6 +388,9 @@ static void w_timeout(void);
 static int w_reset(void);
 static void w_intr_wait(void);
 static int at_intr_wait(void);
+static int at_dma_wait(void);
+static int at_status(void);
+static int w_poll_dma(u32_t spin);
 static int w_waitfor(int mask, int value);
 static int w_waitfor_dma(int mask, int value);
 static void w_geometry(struct partition *entry);
@@ -482,6 +494,7 @@ static void init_params()
   env_parse("ata_id_timeout", "d", 0, &wakeup_secs, 1, 60);
   env_parse("atapi_debug", "d", 0, &atapi_debug, 0, 1);
   env_parse("atapi_dma", "d", 0, &w_atapi_dma, 0, 1);
+  env_parse("ata_poll", "d", 0, &w_poll_us, 0, DPOLL_MAX);
 
   w_identify_wakeup_ticks = wakeup_secs * system_hz;
 
@@ -596,6 +609,8 @@ static void init_drive(struct wini *w, int base_cmd, int base_ctl,
 	w->irq_hook_id = hook;
 	w->ldhpref = ldh_init(drive);
 	w->max_count = MAX_SECS << SECTOR_SHIFT;
+	w->max_dma_count = MAX_SECS << SECTOR_SHIFT;
+	dpoll_setlimit(&w->dpoll, w_poll_us);
 	w->lba48 = 0;
 	w->dma = 0;
 }
@@ -1025,6 +1040,12 @@ static int w_identify()
 		size = id_longword(60);
 
 		w= id_word(ID_CSS);
+		if (w & ID_CSS_LBA48) {
+			/* The LBA48 DMA commands take a 16 bit sector count,
+			 * use them for large requests.
+			 */
+			wn->max_dma_count = MAX_SECS_EXT << SECTOR_SHIFT;
+		}
 		if (size < LBA48_CHECK_SIZE)
 		{
 			/* No need to check for LBA48 */
@@ -1240,7 +1261,12 @@ static int do_transfer(struct wini *wn, unsigned int precomp,
 	sector_high= 0;	/* For future extensions */
 
 	do_lba48= 0;
-	if (sector >= LBA48_CHECK_SIZE || sector_high != 0)
+	if (count > MAX_SECS)
+	{
+		/* Only DMA requests get here, see max_dma_count */
+		do_lba48= 1;
+	}
+	else if (sector >= LBA48_CHECK_SIZE || sector_high != 0)
 	{
 		if (wn->lba48)
 			do_lba48= 1;
@@ -1373,7 +1399,7 @@ unsigned nr_req;		/* length of request vector */
   int n, r, s, errors, do_dma, do_write, do_copyout;
   unsigned long v, block, w_status;
   u64_t dv_size = w_dv->dv_size;
-  unsigned cylinder, head, sector, nbytes;
+  unsigned cylinder, head, sector, nbytes, max_count;
   unsigned dma_buf_offset;
   size_t addr_offset = 0;
 
@@ -1402,10 +1428,11 @@ unsigned nr_req;		/* length of request vector */
 
 	do_write= (opcode == DEV_SCATTER_S);
 	do_dma= wn->dma;
+	max_count= do_dma ? wn->max_dma_count : wn->max_count;
 	
-	if (nbytes >= wn->max_count) {
+	if (nbytes >= max_count) {
 		/* The drive can't do more then max_count at once. */
-		nbytes = wn->max_count;
+		nbytes = max_count;
 	}
 
 	/* First check to see if a reinitialization is needed. */
@@ -1442,7 +1469,7 @@ unsigned nr_req;		/* length of request vector */
 		 */
 
 		wn->dma_intseen = 0;
-		if ((r = at_intr_wait()) != 0) 
+		if ((r = at_dma_wait()) != 0) 
 		{
 			/* Don't retry if sector marked bad or too many
 			 * errors.
@@ -1709,18 +1736,23 @@ size_t addr_offset;
 int do_write;
 int *do_copyoutp;
 {
-	phys_bytes phys, user_phys;
-	unsigned n, offset, size;
+	phys_bytes phys, user_phys, prd_end;
+	unsigned n, offset, size, done, excess;
 	int i, j, r, bad;
 	unsigned long v;
 	struct wini *wn = w_wn;
 	int verbose = 0;
 
-	/* First try direct scatter/gather to the supplied buffers */
+	/* First try direct scatter/gather to the supplied buffers. The whole
+	 * vector goes into one table, pieces that are physically adjacent
+	 * share a descriptor.
+	 */
 	size= *sizep;
 	i= 0;	/* iov index */
 	j= 0;	/* prdt index */
 	bad= 0;
+	done= 0;	/* bytes covered by the prdt */
+	prd_end= 0;	/* end of the last prdt entry */
 	offset= 0;	/* Offset in current iov */
 
 	if(verbose)
@@ -1739,20 +1771,23 @@ int *do_copyoutp;
 			n= size;
 		if (n == 0 || (n & 1))
 			panic("at_wini", "bad size in iov", iov[i].iov_size);
-		if(proc_nr != ENDPT_SELF) {
-			r= sys_umap(proc_nr, VM_GRANT, iov[i].iov_addr, n,
-				&user_phys);
-			if (r != 0)
-				panic("at_wini",
-					"can't map user buffer (VM_GRANT)", r);
-			user_phys += offset + addr_offset;
-		} else {
-			r= sys_umap(proc_nr, VM_D,
-				iov[i].iov_addr+offset+addr_offset, n,
+
+		/* vector is not allowed to be bigger than 64K */
+		if (n > 0x10000)
+			n= 0x10000;
+
+		if (dma_umap(proc_nr, &iov[i], offset+addr_offset, n,
+			&user_phys) != 0)
+		{
+			/* Not physically contiguous, take the rest of the
+			 * first page only.
+			 */
+			r= dma_umap(proc_nr, &iov[i], offset+addr_offset, 1,
 				&user_phys);
 			if (r != 0)
-				panic("at_wini",
-					"can't map user buffer (VM_D)", r);
+				panic("at_wini", "can't map user buffer", r);
+			if (n > PRD_PAGE_SIZE - user_phys % PRD_PAGE_SIZE)
+				n= PRD_PAGE_SIZE - user_phys % PRD_PAGE_SIZE;
 		}
 		if (user_phys & 1)
 		{
@@ -1766,23 +1801,31 @@ int *do_copyoutp;
 		if (user_phys/0x10000 != (user_phys+n-1)/0x10000)
 			n= ((user_phys/0x10000)+1)*0x10000 - user_phys;
 
-		/* vector is not allowed to be bigger than 64K, but we get that
-		 * for free.
-		 */
-
-		if (j >= N_PRDTE)
+		if (j > 0 && user_phys == prd_end && user_phys % 0x10000 != 0)
 		{
-			/* Too many entries */
-
-			bad= 1;
-			break;
+			/* Continues the previous entry within the same 64K,
+			 * a count of 64K wraps to 0 as it should.
+			 */
+			prdt[j-1].prdte_count += n;
 		}
+		else
+		{
+			if (j >= N_PRDTE)
+			{
+				/* Table is full, do the rest in another
+				 * command.
+				 */
+				break;
+			}
 
-		prdt[j].prdte_base= user_phys;
-		prdt[j].prdte_count= n;
-		prdt[j].prdte_reserved= 0;
-		prdt[j].prdte_flags= 0;
-		j++;
+			prdt[j].prdte_base= user_phys;
+			prdt[j].prdte_count= n;
+			prdt[j].prdte_reserved= 0;
+			prdt[j].prdte_flags= 0;
+			j++;
+		}
+		prd_end= user_phys + n;
+		done += n;
 
 		offset += n;
 		if (offset >= iov[i].iov_size)
@@ -1795,6 +1838,33 @@ int *do_copyoutp;
 		size -= n;
 	}
 
+	if (!bad && size > 0)
+	{
+		/* Only whole sectors can be transferred, drop the tail of the
+		 * table.
+		 */
+		excess= done % SECTOR_SIZE;
+		done -= excess;
+		while (excess > 0)
+		{
+			n= prdt[j-1].prdte_count;
+			if (n == 0)
+				n= 0x10000;
+			if (n > excess)
+			{
+				prdt[j-1].prdte_count= n - excess;
+				break;
+			}
+			excess -= n;
+			j--;
+		}
+
+		if (done == 0)
+			bad= 1;
+		else
+			*sizep= done;
+	}
+
 	if (!bad)
 	{
 		if (j <= 0 || j > N_PRDTE)
@@ -1862,7 +1932,7 @@ int *do_copyoutp;
 			panic("at_wini", "bad buffer alignment in setup_dma",
 				phys);
 		}
-		for (j= 0; j<N_PRDTE; i++)
+		for (j= 0; j<N_PRDTE; j++)
 		{
 			if (size == 0)
 			{
@@ -1888,6 +1958,7 @@ int *do_copyoutp;
 			prdt[j].prdte_reserved= 0;
 			prdt[j].prdte_flags= 0;
 
+			phys += n;
 			size -= n;
 			if (size == 0)
 			{
@@ -1925,6 +1996,23 @@ int *do_copyoutp;
 }
 
 
+/*===========================================================================*
+ *				dma_umap				     *
+ *===========================================================================*/
+static int dma_umap(int proc_nr, iovec_t *iop, size_t offset,
+	unsigned size, phys_bytes *physp)
+{
+/* Physical address of size bytes at offset in an I/O vector element. Fails
+ * if they are not physically contiguous.
+ */
+	if (proc_nr != ENDPT_SELF)
+		return sys_umap_grant(proc_nr, iop->iov_addr, offset, size,
+			physp);
+
+	return sys_umap(ENDPT_SELF, VM_D, iop->iov_addr + offset, size,
+		physp);
+}
+
 /*===========================================================================*
  *				w_need_reset				     *
  *===========================================================================*/
@@ -2000,6 +2088,10 @@ static void w_timeout(void)
 	/*FALL THROUGH*/
   default:
 	/* Some other command. */
+	if (w_command == CMD_READ_DMA_EXT || w_command == CMD_WRITE_DMA_EXT) {
+		/* Go back to the usual command size. */
+		wn->max_dma_count = MAX_SECS << SECTOR_SHIFT;
+	}
 	if (w_testing)  wn->state |= IGNORING;	/* Kick out this drive. */
 	else if (!w_silent) printk("%s: timeout on command 0x%02x\n",
 		w_name(), w_command);
@@ -2121,10 +2213,44 @@ static void w_intr_wait()
 static int at_intr_wait()
 {
 /* Wait for an interrupt, study the status bits and return error/success. */
+
+  w_intr_wait();
+  return(at_status());
+}
+
+/*===========================================================================*
+ *				at_dma_wait				     *
+ *===========================================================================*/
+static int at_dma_wait()
+{
+/* Wait for a DMA command to complete. Commands that are likely to complete
+ * soon are polled for, that is cheaper than the interrupt and the wakeup.
+ */
+  struct wini *wn = w_wn;
+  u64_t start;
+  u32_t spin;
+  int polled;
+
+  read_tsc_64(&start);
+
+  polled = wn->irq != NO_IRQ && dpoll_want(&wn->dpoll, &spin) &&
+	w_poll_dma(spin);
+  if (!polled)
+	w_intr_wait();
+
+  dpoll_done(&wn->dpoll, start, polled);
+  return(at_status());
+}
+
+/*===========================================================================*
+ *				at_status				     *
+ *===========================================================================*/
+static int at_status()
+{
+/* Study the status bits of a completed command and return error/success. */
   int r, s;
   unsigned long inbval;
 
-  w_intr_wait();
   if ((w_wn->w_status & (STATUS_BSY | STATUS_WF | STATUS_ERR)) == 0) {
 	r = 0;
   } else {
@@ -2200,6 +2326,40 @@ int value;			/* required status */
   return(0);
 }
 
+/*===========================================================================*
+ *				w_poll_dma				     *
+ *===========================================================================*/
+static int w_poll_dma(u32_t spin)
+{
+/* Spin for at most spin tsc cycles until the DMA command completes. Reading
+ * the status register also clears the drive's interrupt, a notification
+ * that is already pending is acked later as a leftover. Returns 1 if the
+ * command completed.
+ */
+  struct wini *wn = w_wn;
+  unsigned long w_status;
+  u64_t start, now;
+
+  read_tsc_64(&start);
+  do {
+	if (sys_inb(wn->base_dma + DMA_STATUS, (u32_t*)&w_status) != 0)
+		panic(w_name(), "w_poll_dma: sys_inb failed", NO_NUM);
+	if (w_status & DMA_ST_INT) {
+		if (sys_inb(wn->base_cmd + REG_STATUS, (u32_t*)&w_status) != 0)
+			panic(w_name(), "w_poll_dma: sys_inb failed", NO_NUM);
+		if (!(w_status & STATUS_BSY)) {
+			wn->w_status = w_status;
+			wn->dma_intseen = 1;
+			return 1;
+		}
+	}
+	read_tsc_64(&now);
+	now = sub64(now, start);
+  } while (ex64hi(now) == 0 && ex64lo(now) < spin);
+
+  return 0;
+}
+
 /*===========================================================================*
  *				w_geometry				     *
  *===========================================================================*/
@@ -2575,6 +2735,9 @@ kipc_msg_t *m;
 		}
 	
 		return 0;
+	} else if (m->REQUEST == DIOCGETPOLL || m->REQUEST == DIOCSETPOLL) {
+		if (w_prepare(m->DEVICE) == NIL_DEV) return -ENXIO;
+		return dpoll_ioctl(&w_wn->dpoll, m);
 	} else  if (m->REQUEST == DIOCOPENCT) {
 		int count;
 		if (w_prepare(m->DEVICE) == NIL_DEV) return -ENXIO;
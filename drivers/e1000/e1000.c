@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <nucleos/drivers.h>
 #include <net/ether.h>
+#include <net/in.h>
 #include <net/eth_io.h>
 #include <servers/ds/ds.h>
 #include <servers/vm/vm.h>
@@ -38,7 +39,14 @@ static void e1000_init_addr(e1000_t *e);
 static void e1000_init_buf(e1000_t *e);
 static void e1000_reset_hw(e1000_t *e);
 static void e1000_writev_s(kipc_msg_t *mp, int from_int);
+static int  e1000_tso(e1000_t *e, iovec_s_t *iovec, int tail);
+static void e1000_tso_desc(e1000_t *e, int cur, int size, int last);
 static void e1000_readv_s(kipc_msg_t *mp, int from_int);
+static void e1000_readv_z(kipc_msg_t *mp, int from_int);
+static void e1000_rxzc_start(e1000_t *e);
+static void e1000_rxzc_stop(e1000_t *e);
+static void e1000_rx_take(e1000_t *e, rxbuf_s_t *rxb);
+static void e1000_rx_refill(e1000_t *e);
 static void e1000_getstat_s(kipc_msg_t *mp);
 static void e1000_getname(kipc_msg_t *mp);
 static void e1000_interrupt(kipc_msg_t *mp);
@@ -132,6 +140,7 @@ int main(int argc, char *argv[])
 	{
 	    case DL_WRITEV_S:   e1000_writev_s(&m, FALSE);	break;
 	    case DL_READV_S:    e1000_readv_s(&m, FALSE);	break;
+	    case DL_READV_Z:    e1000_readv_z(&m, FALSE);	break;
 	    case DL_CONF:	e1000_init(&m);			break;
 	    case DL_STOP:       e1000_stop();                   break;
 	    case DL_GETSTAT_S:  e1000_getstat_s(&m);		break;
@@ -162,6 +171,12 @@ kipc_msg_t *mp;
     }
     /* Retrieve e1000 pointer. */
     e = e1000_port(mp->DL_PORT);
+
+    /* A new client knows nothing about the buffers of the old one. */
+    if ((e->status & E1000_RXZC) && e->client != mp->DL_PROC)
+    {
+	e1000_rxzc_stop(e);
+    }
     e->client = mp->DL_PROC;
 
     /* Initialize hardware, if needed. */
@@ -338,6 +353,7 @@ e1000_t *e;
 {
     int r, i;
     u16_t word;
+    long v;
 
     e->status  |= E1000_ENABLED;
     e->irq_hook = e->irq;
@@ -350,6 +366,18 @@ e1000_t *e;
     {
         panic(e->name, "sys_irqsetpolicy failed", r);
     }
+    /*
+     * Optionally have the kernel space interrupt notifications at least
+     * e1000_irqticks ticks apart. The line stays masked until
+     * e1000_interrupt() has serviced the card, which then handles all
+     * packets that arrived meanwhile.
+     */
+    v = 0;
+    env_parse("e1000_irqticks", "d", 0, &v, 0, 10);
+    if (v && (r = sys_irqcoalesce(&e->irq_hook, v)) != 0)
+    {
+	printk("%s: sys_irqcoalesce failed: %d\n", e->name, r);
+    }
     if ((r = sys_irqenable(&e->irq_hook)) != 0)
     {
 	panic(e->name, "sys_irqenable failed", r);
@@ -485,6 +513,7 @@ e1000_t *e;
 	{
 	    panic(e->name, "failed to allocate RX buffers", NO_NUM);
 	}
+	e->rx_buffer_p = rx_buff_p;
 	/* Setup receive descriptors. */
 	for (i = 0; i < E1000_RXDESC_NR; i++)
 	{
@@ -516,6 +545,7 @@ e1000_t *e;
 	{
 	    panic(e->name, "failed to allocate TX buffers", NO_NUM);
 	}
+	e->tx_buffer_p = tx_buff_p;
 	/* Setup transmit descriptors. */
 	for (i = 0; i < E1000_RXDESC_NR; i++)
 	{
@@ -604,6 +634,15 @@ int from_int;
 	E1000_DEBUG(4, ("%s: head=%d, tail=%d\n",
 	                 e->name, head, tail));
 
+	/* Large TCP frame to be segmented by the card? */
+	if (e->tx_message.DL_MSS)
+	{
+	    tail = e1000_tso(e, iovec, tail);
+	    e1000_reg_write(e, E1000_REG_TDT, tail);
+	    reply(e, 0, FALSE);
+	    return;
+	}
+
 	/* Loop vector elements. */
 	for (i = 0; i < e->tx_message.DL_COUNT; i++)
 	{
@@ -620,10 +659,16 @@ int from_int;
 	    {
 		panic(e->name, "sys_safecopyfrom() failed", r);
 	    }
-	    /* Mark this descriptor ready. */
+	    /* Mark this descriptor ready. The slot may have been used for
+	     * segmentation, reset the buffer and extended fields.
+	     */
+	    desc->buffer  = e->tx_buffer_p + (tail * E1000_IOBUF_SIZE);
 	    desc->status  = 0;
 	    desc->command = 0;
 	    desc->length  = size;
+	    desc->checksum_off = 0;
+	    desc->checksum_st  = 0;
+	    desc->special = 0;
 
 	    /* Marks End-of-Packet. */
 	    if (i == e->tx_message.DL_COUNT - 1)
@@ -649,6 +694,117 @@ int from_int;
     reply(e, 0, FALSE);
 }
 
+/*===========================================================================*
+ *				e1000_tso				     *
+ *===========================================================================*/
+static int e1000_tso(e, iovec, tail)
+e1000_t *e;
+iovec_s_t *iovec;
+int tail;
+{
+    e1000_context_desc_t *ctx;
+    u8_t *hdr;
+    int r, i, first, cur, off, done, size, bytes = 0, ip_off, tcp_off, hdr_len;
+    u32_t sum;
+
+    /*
+     * The context descriptor takes the first slot. The frame is copied
+     * contiguously into the buffers of the following slots.
+     */
+    ctx   = (e1000_context_desc_t *) &e->tx_desc[tail];
+    first = cur = (tail + 1) % e->tx_desc_count;
+    off   = 0;
+
+    for (i = 0; i < e->tx_message.DL_COUNT; i++)
+    {
+	for (done = 0; done < iovec[i].iov_size; done += size)
+	{
+	    if (off == E1000_IOBUF_SIZE)
+	    {
+		e1000_tso_desc(e, cur, off, FALSE);
+		cur = (cur + 1) % e->tx_desc_count;
+		off = 0;
+	    }
+	    size = iovec[i].iov_size - done < E1000_IOBUF_SIZE - off ?
+		   iovec[i].iov_size - done : E1000_IOBUF_SIZE - off;
+
+	    if ((r = sys_safecopyfrom(e->client, iovec[i].iov_grant, done,
+				     (vir_bytes) e->tx_buffer + off +
+				     (cur * E1000_IOBUF_SIZE),
+				      size, D)) != 0)
+	    {
+		panic(e->name, "sys_safecopyfrom() failed", r);
+	    }
+	    off   += size;
+	    bytes += size;
+	}
+    }
+    e1000_tso_desc(e, cur, off, TRUE);
+
+    /*
+     * The card fills in the IP length and both checksums of each segment.
+     * It expects the TCP checksum to hold the pseudo header sum without
+     * the length.
+     */
+    hdr     = (u8_t *) e->tx_buffer + (first * E1000_IOBUF_SIZE);
+    ip_off  = ETH_HDR_SIZE;
+    tcp_off = ip_off + ((hdr[ip_off] & 0xf) << 2);
+    hdr_len = tcp_off + ((hdr[tcp_off + 12] >> 4) << 2);
+
+    hdr[ip_off + 2]  = hdr[ip_off + 3]  = 0;
+    hdr[ip_off + 10] = hdr[ip_off + 11] = 0;
+
+    sum = IPPROTO_TCP;
+    for (i = 12; i < 20; i += 2)
+	sum += (hdr[ip_off + i] << 8) | hdr[ip_off + i + 1];
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    hdr[tcp_off + 16] = sum >> 8;
+    hdr[tcp_off + 17] = sum & 0xff;
+
+    ctx->ip_css     = ip_off;
+    ctx->ip_cso     = ip_off + 10;
+    ctx->ip_cse     = tcp_off - 1;
+    ctx->tu_css     = tcp_off;
+    ctx->tu_cso     = tcp_off + 16;
+    ctx->tu_cse     = 0;
+    ctx->cmd_length = E1000_TX_CTX_DEXT | E1000_TX_CTX_TSE |
+		      E1000_TX_CTX_IP | E1000_TX_CTX_TCP | (bytes - hdr_len);
+    ctx->status     = 0;
+    ctx->hdr_len    = hdr_len;
+    ctx->mss        = e->tx_message.DL_MSS;
+
+    E1000_DEBUG(2, ("e1000: wrote %d byte TSO frame, mss %d\n",
+		    bytes, e->tx_message.DL_MSS));
+
+    return (cur + 1) % e->tx_desc_count;
+}
+
+/*===========================================================================*
+ *				e1000_tso_desc				     *
+ *===========================================================================*/
+static void e1000_tso_desc(e, cur, size, last)
+e1000_t *e;
+int cur;
+int size;
+int last;
+{
+    e1000_tx_desc_t *desc = &e->tx_desc[cur];
+
+    desc->buffer       = e->tx_buffer_p + (cur * E1000_IOBUF_SIZE);
+    desc->buffer_h     = 0;
+    desc->length       = size;
+    desc->checksum_off = E1000_TX_DTYP_DATA;
+    desc->command      = E1000_TX_CMD_DEXT | E1000_TX_CMD_TSE |
+			 E1000_TX_CMD_FCS;
+    desc->status       = 0;
+    desc->checksum_st  = E1000_TX_POPTS_IXSM | E1000_TX_POPTS_TXSM;
+    desc->special      = 0;
+
+    if (last)
+	desc->command |= E1000_TX_CMD_EOP | E1000_TX_CMD_RS;
+}
+
 /*===========================================================================*
  *				e1000_readv_s				     *
  *===========================================================================*/
@@ -723,6 +879,15 @@ int from_int;
 	}
 	desc->status = 0;
 
+	/* Let the client know whether the next packet is waiting already. */
+	if (e->rx_desc[(cur + 1) % e->rx_desc_count].status &
+	    E1000_RX_STATUS_EOP)
+	{
+	    e->status |= E1000_RECV_MORE;
+	}
+	else
+	    e->status &= ~E1000_RECV_MORE;
+
 	/*
 	 * Update state.
 	 */
@@ -736,6 +901,229 @@ int from_int;
     reply(e, 0, FALSE);
 }
 
+/*===========================================================================*
+ *				e1000_readv_z				     *
+ *===========================================================================*/
+static void e1000_readv_z(mp, from_int)
+kipc_msg_t *mp;
+int from_int;
+{
+    e1000_t *e = e1000_port(mp->DL_PORT);
+    e1000_rx_desc_t *desc;
+    rxbuf_s_t rxb[E1000_RXBATCH];
+    int r, i, j, n, max, cur;
+
+    E1000_DEBUG(3, ("e1000: readv_z(%x,%d)\n", mp, from_int));
+
+    /* Are we called from the interrupt handler? */
+    if (!from_int)
+    {
+	e->rx_message = *mp;
+	e->status    |= E1000_READING | E1000_RXBUF_TAKEN;
+	e->rx_size    = 0;
+
+	/*
+	 * Take the buffers the client hands us.
+	 */
+	n = e->rx_message.DL_COUNT;
+	if (n < 0 || n > E1000_RXZC_NR - e->rx_free_nr)
+	{
+	    panic(e->name, "too many receive buffers", n);
+	}
+	for (i = 0; i < n; i += max)
+	{
+	    max = n - i < E1000_RXBATCH ? n - i : E1000_RXBATCH;
+
+	    if ((r = sys_safecopyfrom(e->client, e->rx_message.DL_GRANT,
+				      i * sizeof(rxbuf_s_t), (vir_bytes) rxb,
+				      max * sizeof(rxbuf_s_t), D)) != 0)
+	    {
+		panic(e->name, "sys_safecopyfrom() failed", r);
+	    }
+	    for (j = 0; j < max; j++)
+		e1000_rx_take(e, &rxb[j]);
+	}
+
+	if (e->status & E1000_RXZC)
+	    e1000_rx_refill(e);
+	else if (e->rx_free_nr > 0)
+	    e1000_rxzc_start(e);
+    }
+    /*
+     * The client has to be done with the previous batch before we
+     * overwrite its packet table.
+     */
+    if ((e->status & E1000_READING) && (e->status & E1000_RXZC) &&
+	(u32_t) e->rx_message.DL_RXSEQ == e->rx_seq)
+    {
+	max = e->rx_message.DL_RXMAX < E1000_RXBATCH ?
+	      e->rx_message.DL_RXMAX : E1000_RXBATCH;
+
+	/*
+	 * The packets stay where the card put them, in client buffers.
+	 */
+	for (n = 0, cur = e->rx_next; n < max; n++)
+	{
+	    desc = &e->rx_desc[cur];
+	    if (e->rx_buf_id[cur] < 0 || !(desc->status & E1000_RX_STATUS_EOP))
+		break;
+
+	    e->rx_pkt[n].rxp_id  = e->rx_buf_id[cur];
+	    e->rx_pkt[n].rxp_len = desc->length >= ETH_MIN_PACK_SIZE ?
+				   desc->length : ETH_MIN_PACK_SIZE;
+	    e->rx_buf_id[cur] = -1;
+	    desc->status = 0;
+	    cur = (cur + 1) % e->rx_desc_count;
+	}
+	if (n == 0)
+	{
+    	    reply(e, 0, FALSE);
+	    return;
+	}
+	e->rx_next = cur;
+
+	if ((r = sys_safecopyto(e->client, e->rx_message.DL_RXGRANT, 0,
+				(vir_bytes) e->rx_pkt, n * sizeof(rxpkt_s_t),
+				D)) != 0)
+	{
+	    panic(e->name, "sys_safecopyto() failed", r);
+	}
+	e->rx_pkt_nr = n;
+	e->rx_seq++;
+
+	/* Let the client know whether more packets are waiting already. */
+	if (e->rx_buf_id[cur] >= 0 &&
+	    (e->rx_desc[cur].status & E1000_RX_STATUS_EOP))
+	{
+	    e->status |= E1000_RECV_MORE;
+	}
+	else
+	    e->status &= ~E1000_RECV_MORE;
+
+	e->status |= E1000_RECEIVED;
+	E1000_DEBUG(2, ("e1000: got %d packets\n", n));
+
+	/* Put fresh buffers in the descriptors and hand them back. */
+	e1000_rx_refill(e);
+    }
+    reply(e, 0, FALSE);
+}
+
+/*===========================================================================*
+ *				e1000_rxzc_start			     *
+ *===========================================================================*/
+static void e1000_rxzc_start(e)
+e1000_t *e;
+{
+    int i;
+
+    /*
+     * Stop the receiver and rebuild the ring with client buffers.
+     * Packets in the ring are dropped.
+     */
+    e1000_reg_unset(e, E1000_REG_RCTL, E1000_REG_RCTL_EN);
+
+    for (i = 0; i < e->rx_desc_count; i++)
+    {
+	e->rx_buf_id[i] = -1;
+	e->rx_desc[i].status = 0;
+    }
+    /* The descriptor at the tail always holds a buffer. */
+    e->rx_free_nr--;
+    e->rx_buf_id[0] = e->rx_free[e->rx_free_nr].id;
+    e->rx_desc[0].buffer = e->rx_free[e->rx_free_nr].phys;
+
+    e1000_reg_write(e, E1000_REG_RDH, 0);
+    e1000_reg_write(e, E1000_REG_RDT, 0);
+    e->rx_next = 0;
+    e->rx_seq  = 0;
+    e->status |= E1000_RXZC;
+    e1000_rx_refill(e);
+
+    e1000_reg_set(e, E1000_REG_RCTL, E1000_REG_RCTL_EN);
+}
+
+/*===========================================================================*
+ *				e1000_rxzc_stop				     *
+ *===========================================================================*/
+static void e1000_rxzc_stop(e)
+e1000_t *e;
+{
+    int i;
+
+    /* Back to our own buffers. Those of the client are forgotten. */
+    e1000_reg_unset(e, E1000_REG_RCTL, E1000_REG_RCTL_EN);
+
+    for (i = 0; i < e->rx_desc_count; i++)
+    {
+	e->rx_desc[i].buffer = e->rx_buffer_p + (i * E1000_IOBUF_SIZE);
+	e->rx_desc[i].status = 0;
+    }
+    e->rx_free_nr = 0;
+    e->status &= ~(E1000_RXZC | E1000_READING | E1000_RECEIVED);
+
+    e1000_reg_write(e, E1000_REG_RDH, 0);
+    e1000_reg_write(e, E1000_REG_RDT, e->rx_desc_count - 1);
+    e1000_reg_set(e, E1000_REG_RCTL, E1000_REG_RCTL_EN);
+}
+
+/*===========================================================================*
+ *				e1000_rx_take				     *
+ *===========================================================================*/
+static void e1000_rx_take(e, rxb)
+e1000_t *e;
+rxbuf_s_t *rxb;
+{
+    phys_bytes phys;
+    int r;
+
+    /*
+     * The client names its buffer by a grant. The card is only given
+     * the address the kernel finds for it, so the client can't make it
+     * write anywhere else.
+     */
+    if ((r = sys_umap_grant(e->client, rxb->rxb_grant, rxb->rxb_offset,
+			    DL_RXBUF_SIZE, &phys)) != 0)
+    {
+	printk("%s: bad receive buffer %d: %d\n", e->name, rxb->rxb_id, r);
+	return;
+    }
+    e->rx_free[e->rx_free_nr].id   = rxb->rxb_id;
+    e->rx_free[e->rx_free_nr].phys = phys;
+    e->rx_free_nr++;
+}
+
+/*===========================================================================*
+ *				e1000_rx_refill				     *
+ *===========================================================================*/
+static void e1000_rx_refill(e)
+e1000_t *e;
+{
+    int tail, cur, moved = FALSE;
+
+    /*
+     * Give empty descriptors after the tail a free client buffer and
+     * pass them to the card. Without buffers the tail stays behind and
+     * the card drops packets once it catches up.
+     */
+    tail = e1000_reg_read(e, E1000_REG_RDT);
+    cur  = (tail + 1) % e->rx_desc_count;
+
+    while (e->rx_buf_id[cur] < 0 && e->rx_free_nr > 0)
+    {
+	e->rx_free_nr--;
+	e->rx_buf_id[cur] = e->rx_free[e->rx_free_nr].id;
+	e->rx_desc[cur].buffer = e->rx_free[e->rx_free_nr].phys;
+	e->rx_desc[cur].status = 0;
+
+	tail  = cur;
+	cur   = (cur + 1) % e->rx_desc_count;
+	moved = TRUE;
+    }
+    if (moved)
+	e1000_reg_write(e, E1000_REG_RDT, tail);
+}
+
 /*===========================================================================*
  *				e1000_getstat_s				     *
  *===========================================================================*/
@@ -825,7 +1213,12 @@ kipc_msg_t *mp;
 		e1000_link_changed(e);
 
  	    if (cause & (E1000_REG_ICR_RXO | E1000_REG_ICR_RXT))
-		e1000_readv_s(&e->rx_message, TRUE);
+	    {
+		if (e->status & E1000_RXZC)
+		    e1000_readv_z(&e->rx_message, TRUE);
+		else
+		    e1000_readv_s(&e->rx_message, TRUE);
+	    }
 	
 	    if ((cause & E1000_REG_ICR_TXQE) ||
 	        (cause & E1000_REG_ICR_TXDW))
@@ -1228,22 +1621,35 @@ int may_block;
 	e->status & E1000_RECEIVED)
     {
 	msg.DL_STAT  = DL_PACK_RECV;
+	if (e->status & E1000_RECV_MORE)
+	    msg.DL_STAT |= DL_RECV_MORE;
 	msg.DL_COUNT = e->rx_size >= ETH_MIN_PACK_SIZE ?
 		       e->rx_size  : ETH_MIN_PACK_SIZE;
+	if (e->status & E1000_RXZC)
+	{
+	    msg.DL_COUNT = e->rx_pkt_nr;
+	    msg.DL_RXSEQ = e->rx_seq;
+	}
 
         /* Clear flags. */
-	e->status &= ~(E1000_READING | E1000_RECEIVED);
+	e->status &= ~(E1000_READING | E1000_RECEIVED | E1000_RECV_MORE);
     }
     /* Did we successfully transmit packet(s)? */
     if (e->status & E1000_TRANSMIT &&
         e->status & E1000_WRITING)
     {
-	msg.DL_STAT  = DL_PACK_SEND;
-	msg.DL_COUNT = 0;
+	/* Keep a packet received above, its buffer belongs to INET. */
+	msg.DL_STAT |= DL_PACK_SEND;
 	
 	/* Clear flags. */
 	e->status &= ~(E1000_WRITING | E1000_TRANSMIT);
     }
+    /* Did we take over the buffers of a zero-copy read? */
+    if (e->status & E1000_RXBUF_TAKEN)
+    {
+	msg.DL_STAT |= DL_RXBUF_TAKEN;
+	e->status &= ~E1000_RXBUF_TAKEN;
+    }
 
     /* Acknowledge to INET. */
     if ((r = send(e->client, &msg)) != 0)
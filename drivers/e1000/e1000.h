@@ -40,12 +40,18 @@
 /** Number of transmit descriptors per card. */
 #define E1000_TXDESC_NR 256
 
-/** Number of I/O vectors to use. */
-#define E1000_IOVEC_NR 16
+/** Number of I/O vectors to use. Large enough for a TSO frame. */
+#define E1000_IOVEC_NR 64
 
 /** Size of each I/O buffer per descriptor. */
 #define E1000_IOBUF_SIZE 2048
 
+/** Most client receive buffers held per card for zero-copy reads. */
+#define E1000_RXZC_NR 1024
+
+/** Most packets handed to the client per zero-copy read. */
+#define E1000_RXBATCH 32
+
 /** Debug verbosity. */
 #define E1000_VERBOSE 1
 
@@ -79,6 +85,15 @@
 /** Transmitted some packets on the card. */
 #define E1000_TRANSMIT (1 << 5)
 
+/** More received packets are ready after the current one. */
+#define E1000_RECV_MORE (1 << 6)
+
+/** The receive ring uses the client's buffers. */
+#define E1000_RXZC (1 << 7)
+
+/** Copied the buffer table of a zero-copy read request. */
+#define E1000_RXBUF_TAKEN (1 << 8)
+
 /**
  * @}
  */
@@ -137,6 +152,16 @@
  * @}
  */
 
+/**
+ * @brief Client receive buffer, not in the ring yet.
+ */
+typedef struct e1000_rxbuf
+{
+    int id;			  /**< Buffer number of the client. */
+    phys_bytes phys;		  /**< Physical address, found from its grant. */
+}
+e1000_rxbuf_t;
+
 /**
  * @brief Describes the state of an Intel Pro/1000 card.
  */
@@ -159,11 +184,20 @@ typedef struct e1000
     e1000_rx_desc_t *rx_desc;	  /**< Receive Descriptor table. */
     int rx_desc_count;		  /**< Number of Receive Descriptors. */
     char *rx_buffer;		  /**< Receive buffer returned by malloc(). */
+    phys_bytes rx_buffer_p;	  /**< Physical address of the receive buffer. */
     int rx_buffer_size;		  /**< Size of the receive buffer. */
+    int rx_buf_id[E1000_RXDESC_NR]; /**< Client buffer of each descriptor. */
+    e1000_rxbuf_t rx_free[E1000_RXZC_NR]; /**< Client buffers not in the ring. */
+    int rx_free_nr;		  /**< Number of entries in rx_free. */
+    int rx_next;		  /**< Next descriptor to read (zero-copy). */
+    rxpkt_s_t rx_pkt[E1000_RXBATCH]; /**< Packets of a zero-copy read. */
+    int rx_pkt_nr;		  /**< Number of entries in rx_pkt. */
+    u32_t rx_seq;		  /**< Last batch handed to the client. */
 
     e1000_tx_desc_t *tx_desc;	  /**< Transmit Descriptor table. */
     int tx_desc_count;		  /**< Number of Transmit Descriptors. */
     char *tx_buffer;		  /**< Transmit buffer returned by malloc(). */
+    phys_bytes tx_buffer_p;	  /**< Physical address of the transmit buffer. */
     int tx_buffer_size;		  /**< Size of the transmit buffer. */
 
     int client;                   /**< Process ID being served by e1000. */
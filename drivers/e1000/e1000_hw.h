@@ -56,6 +56,24 @@ typedef struct e1000_tx_desc
 }
 e1000_tx_desc_t;
 
+/**
+ * @brief Transmit Context Descriptor Format, for TCP segmentation.
+ */
+typedef struct e1000_context_desc
+{
+    u8_t  ip_css;	/**< IP Checksum Start. */
+    u8_t  ip_cso;	/**< IP Checksum Offset. */
+    u16_t ip_cse;	/**< IP Checksum Ending. */
+    u8_t  tu_css;	/**< TCP Checksum Start. */
+    u8_t  tu_cso;	/**< TCP Checksum Offset. */
+    u16_t tu_cse;	/**< TCP Checksum Ending (0 is end of packet). */
+    u32_t cmd_length;	/**< Payload length, type and command bits. */
+    u8_t  status;	/**< Status field. */
+    u8_t  hdr_len;	/**< Length of the headers of each segment. */
+    u16_t mss;		/**< Maximum segment size. */
+}
+e1000_context_desc_t;
+
 /**
  * @brief ICH GbE Flash Hardware Sequencing Flash Status Register bit breakdown.
  * @see http://gitweb.dragonflybsd.org
@@ -167,6 +185,42 @@ union ich8_hws_flash_regacc
 /** Report Status. */
 #define E1000_TX_CMD_RS		(1 << 3)
 
+/** TCP Segmentation Enable (extended descriptors). */
+#define E1000_TX_CMD_TSE	(1 << 2)
+
+/** Descriptor Extension. */
+#define E1000_TX_CMD_DEXT	(1 << 5)
+
+/**
+ * @}
+ */
+
+/**
+ * @name Transmit Segmentation Bits.
+ * @{
+ */
+
+/** Data Descriptor type, in the Checksum Offset field. */
+#define E1000_TX_DTYP_DATA	(1 << 4)
+
+/** Insert IP Checksum, in the Checksum Start field. */
+#define E1000_TX_POPTS_IXSM	(1 << 0)
+
+/** Insert TCP Checksum, in the Checksum Start field. */
+#define E1000_TX_POPTS_TXSM	(1 << 1)
+
+/** Context is for TCP. */
+#define E1000_TX_CTX_TCP	(1 << 24)
+
+/** Context is for IPv4. */
+#define E1000_TX_CTX_IP		(1 << 25)
+
+/** Context enables TCP segmentation. */
+#define E1000_TX_CTX_TSE	(1 << 26)
+
+/** Context Descriptor Extension. */
+#define E1000_TX_CTX_DEXT	(1 << 29)
+
 /**
  * @}
  */
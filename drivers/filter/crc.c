@@ -7,6 +7,9 @@
  */
 
 #include <nucleos/types.h>
+#include <asm/cpufeature.h>
+
+#include "crc.h"
 
 unsigned long crctab[] = {
   0x7fffffff,
@@ -86,3 +89,104 @@ unsigned long compute_crc( unsigned char *b, size_t n)
   return(s);
 }
 
+
+/* CRC32C (Castagnoli), the CRC computed by the SSE4.2 crc32 instruction.
+ * Unlike compute_crc() above it is a true CRC, so it can be computed eight
+ * bytes at a time: crc32c_tab[k][b] is the CRC of byte b followed by k zero
+ * bytes.
+ */
+#define CRC32C_POLY	0x82f63b78	/* reflected 0x1edc6f41 */
+
+static u32_t crc32c_tab[8][256];
+
+static u32_t (*crc32c_fn)(u32_t crc, unsigned char *b, size_t n);
+
+static u32_t crc32c_slice8(u32_t crc, unsigned char *b, size_t n)
+{
+  u32_t lo, hi;
+
+  while (n > 0 && ((unsigned long) b & 3)) {
+	crc = crc32c_tab[0][(crc ^ *b++) & 0xff] ^ (crc >> 8);
+	n--;
+  }
+
+  while (n >= 8) {
+	lo = *(u32_t *) b ^ crc;
+	hi = *(u32_t *) (b + 4);
+	crc = crc32c_tab[7][lo & 0xff] ^
+	      crc32c_tab[6][(lo >> 8) & 0xff] ^
+	      crc32c_tab[5][(lo >> 16) & 0xff] ^
+	      crc32c_tab[4][lo >> 24] ^
+	      crc32c_tab[3][hi & 0xff] ^
+	      crc32c_tab[2][(hi >> 8) & 0xff] ^
+	      crc32c_tab[1][(hi >> 16) & 0xff] ^
+	      crc32c_tab[0][hi >> 24];
+	b += 8;
+	n -= 8;
+  }
+
+  while (n-- > 0)
+	crc = crc32c_tab[0][(crc ^ *b++) & 0xff] ^ (crc >> 8);
+
+  return crc;
+}
+
+static u32_t crc32c_sse42(u32_t crc, unsigned char *b, size_t n)
+{
+  while (n > 0 && ((unsigned long) b & 3)) {
+	__asm__ ("crc32b %1, %0" : "+r" (crc) : "rm" (*b));
+	b++;
+	n--;
+  }
+
+  while (n >= 4) {
+	__asm__ ("crc32l %1, %0" : "+r" (crc) : "rm" (*(u32_t *) b));
+	b += 4;
+	n -= 4;
+  }
+
+  while (n-- > 0) {
+	__asm__ ("crc32b %1, %0" : "+r" (crc) : "rm" (*b));
+	b++;
+  }
+
+  return crc;
+}
+
+/*===========================================================================*
+ *				crc_init				     *
+ *===========================================================================*/
+void crc_init(void)
+{
+  /* Build the CRC32C tables and pick the fastest implementation. */
+  u32_t crc;
+  int i, j;
+
+  for (i = 0; i < 256; i++) {
+	crc = i;
+	for (j = 0; j < 8; j++)
+		crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+	crc32c_tab[0][i] = crc;
+  }
+
+  for (i = 0; i < 256; i++) {
+	crc = crc32c_tab[0][i];
+	for (j = 1; j < 8; j++) {
+		crc = crc32c_tab[0][crc & 0xff] ^ (crc >> 8);
+		crc32c_tab[j][i] = crc;
+	}
+  }
+
+  if (cpufeature(_CPUF_I386_SSE4_2))
+	crc32c_fn = crc32c_sse42;
+  else
+	crc32c_fn = crc32c_slice8;
+}
+
+/*===========================================================================*
+ *				compute_crc32c				     *
+ *===========================================================================*/
+u32_t compute_crc32c(unsigned char *b, size_t n)
+{
+  return ~crc32c_fn(~0, b, n);
+}
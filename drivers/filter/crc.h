@@ -2,5 +2,7 @@
 #define _CRC_H
 
 extern unsigned long compute_crc(unsigned char *b, size_t n);
+extern void crc_init(void);
+extern u32_t compute_crc32c(unsigned char *b, size_t n);
 
 #endif /* _CRC_H */
@@ -12,6 +12,8 @@ static struct {
   int error;		/* one of E*, only relevant if problem>0 */
   int retries;
   int kills;
+
+  u64_t head;		/* position right after the last transfer */
 } driver[2];
 
 /* State variables. */
@@ -21,6 +23,8 @@ static asynmsg_t amsgtable[2];
 static int size_known = 0;
 static u64_t disk_size;
 
+static int reader = DRIVER_MAIN;	/* driver serving FLT_READ requests */
+
 static int problem_stats[BD_LAST] = { 0 };
 
 /*===========================================================================*
@@ -224,6 +228,52 @@ u64_t get_raw_size(void)
 	return disk_size;
 }
 
+/*===========================================================================*
+ *				head_dist				     *
+ *===========================================================================*/
+static u64_t head_dist(int which, u64_t pos)
+{
+	/* Distance between the position of the last transfer of a driver and
+	 * the given position.
+	 */
+
+	if (cmp64(driver[which].head, pos) > 0)
+		return sub64(driver[which].head, pos);
+
+	return sub64(pos, driver[which].head);
+}
+
+/*===========================================================================*
+ *				choose_reader				     *
+ *===========================================================================*/
+void choose_reader(u64_t pos)
+{
+	/* Pick the driver that serves the plain reads of a transfer starting
+	 * at 'pos'. Both disks of a mirror hold the same data, so take the
+	 * one whose last transfer ended closest to 'pos'. A sequential stream
+	 * stays on one disk and keeps its readahead, random reads are spread
+	 * over both. All reads of one transfer, checksum sectors included,
+	 * go to the same disk so that a bad checksum blames the right one.
+	 */
+
+	reader = DRIVER_MAIN;
+
+	if (USE_MIRROR && driver[DRIVER_BACKUP].endpt != ENDPT_NONE &&
+		cmp64(head_dist(DRIVER_BACKUP, pos),
+		head_dist(DRIVER_MAIN, pos)) < 0)
+		reader = DRIVER_BACKUP;
+}
+
+/*===========================================================================*
+ *				get_reader				     *
+ *===========================================================================*/
+int get_reader(void)
+{
+	/* Return the driver that serves plain reads. */
+
+	return reader;
+}
+
 /*===========================================================================*
  *				reset_kills				     *
  *===========================================================================*/
@@ -753,24 +803,26 @@ static int do_sendrec_both(kipc_msg_t *m1, kipc_msg_t *m2)
 /*===========================================================================*
  *				do_sendrec_one				     *
  *===========================================================================*/
-static int do_sendrec_one(kipc_msg_t *m1, kipc_msg_t *m2)
+static int do_sendrec_one(kipc_msg_t *m1, kipc_msg_t *m2, int which)
 {
-	/* Only talk to the main driver. If something goes wrong, it will
+	/* Only talk to the given driver. If something goes wrong, it will
 	 * be fixed elsewhere.
 	 * This function will only return either 0 or RET_REDO.
 	 */
 
-    	return flt_sendrec(m1, DRIVER_MAIN);
+    	return flt_sendrec(m1, which);
 }
 
 /*===========================================================================*
  *				paired_sendrec				     *
  *===========================================================================*/
-static int paired_sendrec(kipc_msg_t *m1, kipc_msg_t *m2, int both)
+static int paired_sendrec(kipc_msg_t *m1, kipc_msg_t *m2, int both,
+	int which)
 {
 	/* Sendrec with the disk driver. If the disk driver is down, and was
 	 * restarted, redo the request, until the driver works fine, or can't
-	 * be restarted again.
+	 * be restarted again. Unless 'both' is set, 'which' is the driver
+	 * that gets 'm1'.
 	 */
 	int r;
 
@@ -783,7 +835,7 @@ static int paired_sendrec(kipc_msg_t *m1, kipc_msg_t *m2, int both)
 	if (both)
 		r = do_sendrec_both(m1, m2);
 	else
-		r = do_sendrec_one(m1, m2);
+		r = do_sendrec_one(m1, m2, which);
 
 #if DEBUG2
 	if (r != 0)
@@ -846,18 +898,21 @@ static int single_grant(endpoint_t endpt, vir_bytes buf, int access,
  *===========================================================================*/
 static int paired_grant(char *buf1, char *buf2, int request,
 	cp_grant_id_t *gids, iovec_s_t vectors[2][NR_IOREQS], size_t *sizes,
-	int both)
+	int both, int which)
 {
-	/* Create memory grants, either to one or to both drivers.
+	/* Create memory grants, either to one or to both drivers. Unless
+	 * 'both' is set, the grants for 'buf1' go to driver 'which'.
 	 */
-	cp_grant_id_t gid;
 	int count, access;
 
 	count = 0;
 	access = (request == FLT_WRITE) ? CPF_READ : CPF_WRITE;
 
-	if(driver[DRIVER_MAIN].endpt > 0) {
-		count = single_grant(driver[DRIVER_MAIN].endpt,
+	if (both)
+		which = DRIVER_MAIN;
+
+	if(driver[which].endpt > 0) {
+		count = single_grant(driver[which].endpt,
 			(vir_bytes) buf1, access, &gids[0], vectors[0],
 			&sizes[0]);
 	}
@@ -868,9 +923,11 @@ static int paired_grant(char *buf1, char *buf2, int request,
 				(vir_bytes) buf2, access, &gids[1],
 				vectors[1], &sizes[1]);
 		}
-		}
 	}
 
+	return count;
+}
+
 /*===========================================================================*
  *				single_revoke				     *
  *===========================================================================*/
@@ -916,17 +973,20 @@ int read_write(u64_t pos, char *bufa, char *bufb, size_t *sizep, int request)
 	kipc_msg_t m1, m2;
 	cp_grant_id_t gids[2];
 	size_t sizes[2];
-	int r, both, count;
+	int r, both, count, first;
 
 	gids[0] = gids[1] = GRANT_INVALID;
 	sizes[0] = sizes[1] = *sizep;
 
 	/* Send two requests only if mirroring is enabled and the given request
-	 * is either FLT_READ2 or FLT_WRITE.
+	 * is either FLT_READ2 or FLT_WRITE. A plain read goes to the driver
+	 * chosen by choose_reader().
 	 */
 	both = (USE_MIRROR && request != FLT_READ);
+	first = (request == FLT_READ) ? reader : DRIVER_MAIN;
 
-	count = paired_grant(bufa, bufb, request, gids, vectors, sizes, both);
+	count = paired_grant(bufa, bufb, request, gids, vectors, sizes, both,
+		first);
 
 	m1.m_type = (request == FLT_WRITE) ? DEV_SCATTER_S : DEV_GATHER_S;
 	m1.COUNT = count;
@@ -938,7 +998,7 @@ int read_write(u64_t pos, char *bufa, char *bufb, size_t *sizep, int request)
 	m1.IO_GRANT = (char *) gids[0];
 	m2.IO_GRANT = (char *) gids[1];
 
-	r = paired_sendrec(&m1, &m2, both);
+	r = paired_sendrec(&m1, &m2, both, first);
 
 	paired_revoke(gids, vectors, sizes, count, both);
 
@@ -951,15 +1011,17 @@ int read_write(u64_t pos, char *bufa, char *bufb, size_t *sizep, int request)
 	}
 
 	if (m1.m_type != KCNR_TASK_REPLY || m1.REP_STATUS != 0) {
-		printk("Filter: unexpected/invalid reply from main driver: "
-			"(%x, %d)\n", m1.m_type, m1.REP_STATUS);
+		printk("Filter: unexpected/invalid reply from %s driver: "
+			"(%x, %d)\n", first == DRIVER_MAIN ? "main" : "backup",
+			m1.m_type, m1.REP_STATUS);
 
-		return bad_driver(DRIVER_MAIN, BD_PROTO,
+		return bad_driver(first, BD_PROTO,
 			(m1.m_type == KCNR_TASK_REPLY) ? m1.REP_STATUS : -EFAULT);
 	}
 
 	if (sizes[0] != *sizep) {
-		printk("Filter: truncated reply from main driver\n");
+		printk("Filter: truncated reply from %s driver\n",
+			first == DRIVER_MAIN ? "main" : "backup");
 
 		/* If the driver returned a value *larger* than we requested,
 		 * OR if we did NOT exceed the disk size, then we should
@@ -967,7 +1029,7 @@ int read_write(u64_t pos, char *bufa, char *bufb, size_t *sizep, int request)
 		 */
 		if (sizes[0] < 0 || sizes[0] > *sizep ||
 			cmp64(add64u(pos, sizes[0]), disk_size) < 0)
-			return bad_driver(DRIVER_MAIN, BD_PROTO, -EFAULT);
+			return bad_driver(first, BD_PROTO, -EFAULT);
 
 		/* Return the actual size. */
 		*sizep = sizes[0];
@@ -996,7 +1058,11 @@ int read_write(u64_t pos, char *bufa, char *bufb, size_t *sizep, int request)
 			if (*sizep >= sizes[1])
 				*sizep = sizes[1];
 		}
+
+		driver[DRIVER_BACKUP].head = add64u(pos, *sizep);
 	}
 
+	driver[first].head = add64u(pos, *sizep);
+
 	return 0;
 }
@@ -20,6 +20,7 @@ enum {
   ST_NIL,		/* Zero checksums */
   ST_XOR,		/* XOR-based checksums */
   ST_CRC,		/* CRC32-based checksums */
+  ST_CRC32C,		/* CRC32C-based checksums */
   ST_MD5		/* MD5-based checksums */
 };
 
@@ -85,6 +86,8 @@ extern u64_t convert(u64_t size);
 extern void driver_init(void);
 extern void driver_shutdown(void);
 extern u64_t get_raw_size(void);
+extern void choose_reader(u64_t pos);
+extern int get_reader(void);
 extern void reset_kills(void);
 extern int check_driver(int which);
 extern int bad_driver(int which, int type, int error);
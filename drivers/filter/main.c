@@ -21,7 +21,7 @@ int BAD_SUM_ERROR = 1;	/* bad checksums are considered a driver error */
 int USE_SUM_LAYOUT = 0;	/* use checksumming layout on disk */
 int NR_SUM_SEC = 8;	/* number of checksums per checksum sector */
 
-int SUM_TYPE = ST_CRC;	/* use NIL, XOR, CRC, or MD5 */
+int SUM_TYPE = ST_CRC;	/* use NIL, XOR, CRC, CRC32C, or MD5 */
 int SUM_SIZE = 0;	/* size of the stored checksum */
 
 int NR_RETRIES = 3;	/* number of times the request will be retried (N) */
@@ -50,6 +50,7 @@ struct optset optset_table[] = {
   { "nil",	OPT_BOOL,	&SUM_TYPE,		ST_NIL		},
   { "xor",	OPT_BOOL,	&SUM_TYPE,		ST_XOR		},
   { "crc",	OPT_BOOL,	&SUM_TYPE,		ST_CRC		},
+  { "crc32c",	OPT_BOOL,	&SUM_TYPE,		ST_CRC32C	},
   { "md5",	OPT_BOOL,	&SUM_TYPE,		ST_MD5		},
   { "sumerr",	OPT_BOOL,	&BAD_SUM_ERROR,		1		},
   { "nosumerr",	OPT_BOOL,	&BAD_SUM_ERROR,		0		},
@@ -308,6 +309,7 @@ static int parse_arguments(int argc, char *argv[])
 		SUM_SIZE = 16;	/* compatibility */
 		break;
 	case ST_CRC:
+	case ST_CRC32C:
 		SUM_SIZE = 4;
 		break;
 	case ST_MD5:
@@ -336,6 +338,7 @@ static int parse_arguments(int argc, char *argv[])
 		case ST_NIL: printk("nil"); break;
 		case ST_XOR: printk("xor"); break;
 		case ST_CRC: printk("crc"); break;
+		case ST_CRC32C: printk("crc32c"); break;
 		case ST_MD5: printk("md5"); break;
 		}
 
@@ -37,12 +37,14 @@
    is possible they should be macros for speed, but I would be
    surprised if they were a performance bottleneck for MD5.  */
 
+#ifndef __i386__
 static uint32
 getu32 (const unsigned char *addr)
 {
 	return (((((unsigned long)addr[3] << 8) | addr[2]) << 8)
 		| addr[1]) << 8 | addr[0];
 }
+#endif
 
 static void
 putu32 (uint32 data, unsigned char *addr)
@@ -107,11 +109,10 @@ MD5Update (ctx, buf, len)
 		len -= t;
 	}
 
-	/* Process data in 64-byte chunks */
+	/* Process data in 64-byte chunks, straight from the caller's buffer */
 
 	while (len >= 64) {
-		memcpy(ctx->in, buf, 64);
-		MD5Transform (ctx->buf, ctx->in);
+		MD5Transform (ctx->buf, buf);
 		buf += 64;
 		len -= 64;
 	}
@@ -194,11 +195,16 @@ MD5Transform (buf, inraw)
      const unsigned char inraw[64];
 {
 	register uint32 a, b, c, d;
+#ifdef __i386__
+	/* The words are little-endian already and may be unaligned. */
+	const uint32 *in = (const uint32 *) inraw;
+#else
 	uint32 in[16];
 	int i;
 
 	for (i = 0; i < 16; ++i)
 		in[i] = getu32 (inraw + 4 * i);
+#endif
 
 	a = buf[0];
 	b = buf[1];
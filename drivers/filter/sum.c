@@ -29,71 +29,106 @@ void sum_init(void)
 
   if (ext_array == NULL || rb0_array == NULL || rb1_array == NULL)
 	panic(__FILE__, "no memory available", NO_NUM);
+
+  crc_init();
 }
 
 /*===========================================================================*
  *				calc_sum				     *
  *===========================================================================*/
-static void calc_sum(unsigned sector, char *data, char *sum)
+static void calc_sum(sector_t sector, char *data, char *sum, int count)
 {
-	/* Compute the checksum for a sector. The sector number must be part
-	 * of the checksum in some way.
+	/* Compute the checksums for 'count' consecutive sectors, starting at
+	 * sector number 'sector', and store them one after another at 'sum'.
+	 * The sector number must be part of each checksum in some way.
 	 */
 	unsigned long crc, *p, *q;
 	int i, j;
 	struct MD5Context ctx;
+	unsigned secnr;
+
+#define FOR_EACH_SECTOR \
+	for (; count > 0; count--, sector++, data += SECTOR_SIZE, \
+		sum += SUM_SIZE)
 
 	switch(SUM_TYPE) {
 	case ST_NIL:
 		/* No checksum at all */
 
-		q = (unsigned long *) sum;
-		*q = sector;
+		FOR_EACH_SECTOR {
+			q = (unsigned long *) sum;
+			*q = sector;
+		}
 
 		break;
 
 	case ST_XOR:
 		/* Basic XOR checksum */
-		p = (unsigned long *) data;
 
-		memset(sum, 0, SUM_SIZE);
-		for(i = 0; i < SECTOR_SIZE / SUM_SIZE; i++) {
-			q = (unsigned long *) sum;
-			for(j = 0; j < SUM_SIZE / sizeof(*p); j++) {
-				*q ^= *p;
-				q++;
-				p++;
+		FOR_EACH_SECTOR {
+			p = (unsigned long *) data;
+
+			memset(sum, 0, SUM_SIZE);
+			for(i = 0; i < SECTOR_SIZE / SUM_SIZE; i++) {
+				q = (unsigned long *) sum;
+				for(j = 0; j < SUM_SIZE / sizeof(*p); j++) {
+					*q ^= *p;
+					q++;
+					p++;
+				}
 			}
+			q = (unsigned long *) sum;
+			*q ^= sector;
 		}
-		q = (unsigned long *) sum;
-		*q ^= sector;
 
 		break;
 
 	case ST_CRC:
 		/* CRC32 checksum */
 
-		crc = compute_crc((unsigned char *) data, SECTOR_SIZE);
+		FOR_EACH_SECTOR {
+			crc = compute_crc((unsigned char *) data, SECTOR_SIZE);
 
-		q = (unsigned long *) sum;
+			q = (unsigned long *) sum;
 
-		*q = crc ^ sector;
+			*q = crc ^ sector;
+		}
+
+		break;
+
+	case ST_CRC32C:
+		/* CRC32C checksum */
+
+		FOR_EACH_SECTOR {
+			crc = compute_crc32c((unsigned char *) data,
+				SECTOR_SIZE);
+
+			q = (unsigned long *) sum;
+
+			*q = crc ^ sector;
+		}
 
 		break;
 
 	case ST_MD5:
 		/* MD5 checksum */
 
-		MD5Init(&ctx);
-		MD5Update(&ctx, (unsigned char *) data, SECTOR_SIZE);
-		MD5Update(&ctx, (unsigned char *) &sector, sizeof(sector));
-		MD5Final((unsigned char *) sum, &ctx);
+		FOR_EACH_SECTOR {
+			secnr = sector;
+			MD5Init(&ctx);
+			MD5Update(&ctx, (unsigned char *) data, SECTOR_SIZE);
+			MD5Update(&ctx, (unsigned char *) &secnr,
+				sizeof(secnr));
+			MD5Final((unsigned char *) sum, &ctx);
+		}
 
 		break;
 
 	default:
 		panic(__FILE__, "invalid checksum type", SUM_TYPE);
 	}
+
+#undef FOR_EACH_SECTOR
 }
 
 /*===========================================================================*
@@ -139,14 +174,7 @@ static void make_group_sum(char *bufp, char *sump, sector_t sector, int index,
 
 	sump += index * SUM_SIZE;
 
-	while (count--) {
-		calc_sum(sector, bufp, sump);
-
-		bufp += SECTOR_SIZE;
-
-		sump += SUM_SIZE;
-		sector++;
-	}
+	calc_sum(sector, bufp, sump, count);
 }
 
 /*===========================================================================*
@@ -160,21 +188,27 @@ static int check_group_sum(char *bufp, char *sump, sector_t sector, int index,
 	 * upon failure.
 	 */
 	char sum_buffer[SECTOR_SIZE];
+	char *p;
 
 	sump += index * SUM_SIZE;
 
-	while (count--) {
-		calc_sum(sector, bufp, sum_buffer);
+	/* Checksum the whole group at once, and look at the individual
+	 * sectors only if something does not match.
+	 */
+	calc_sum(sector, bufp, sum_buffer, count);
+
+	if (!memcmp(sum_buffer, sump, count * SUM_SIZE))
+		return 0;
 
-		if (memcmp(sum_buffer, sump, SUM_SIZE)) {
+	for (p = sum_buffer; count--; p += SUM_SIZE, sump += SUM_SIZE) {
+		if (memcmp(p, sump, SUM_SIZE)) {
 			printk("Filter: BAD CHECKSUM at sector %lu\n", sector);
 
 			if (BAD_SUM_ERROR)
-				return bad_driver(DRIVER_MAIN, BD_DATA, -EIO);
+				return bad_driver(get_reader(), BD_DATA,
+					-EIO);
 		}
 
-		bufp += SECTOR_SIZE;
-		sump += SUM_SIZE;
 		sector++;
 	}
 
@@ -500,8 +534,11 @@ int transfer(u64_t pos, char *buffer, size_t *sizep, int flag_rw)
 	/* If we don't use checksums or even checksum layout, simply pass on
 	 * the request to the drivers as is.
 	 */
-	if (!USE_SUM_LAYOUT)
+	if (!USE_SUM_LAYOUT) {
+		choose_reader(pos);
+
 		return read_write(pos, buffer, buffer, sizep, flag_rw);
+	}
 
 	/* The extended buffer (for checksumming) essentially looks like this:
 	 *
@@ -541,6 +578,8 @@ int transfer(u64_t pos, char *buffer, size_t *sizep, int flag_rw)
 	nr_sectors = *sizep / SECTOR_SIZE;
 	phys_pos = SEC2POS(LOG2PHYS(first_sector));
 
+	choose_reader(phys_pos);
+
 #if DEBUG2
 	printk("Filter: transfer: pos 0x%lx:0x%lx -> phys_pos 0x%lx:0x%lx\n",
 		ex64hi(pos), ex64lo(pos), ex64hi(phys_pos), ex64lo(phys_pos));
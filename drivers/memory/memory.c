@@ -35,6 +35,7 @@
 #include <kernel/types.h>
 #include <servers/vm/vm.h>
 #include <asm/servers/vm/vm.h>
+#include <nucleos/ramdisk.h>
 #include <assert.h>
 
 #ifndef CONFIG_BUILTIN_INITRD
@@ -62,10 +63,23 @@ extern int errno;			/* error number for PM calls */
 
 static int openct[NR_DEVS];
 
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+/* File server a RAM disk is mapped into, see MIOCRAMMAP. */
+static endpoint_t m_map_ep[NR_DEVS];
+static vir_bytes m_map_addr[NR_DEVS];
+
+static void m_unmap(int dev);
+#endif
+
+/* Pages of /dev/mem mapped at once. */
+#define MEM_WINDOW_PAGES	16
+
 static char *m_name(void);
 static struct device *m_prepare(int device);
 static int m_transfer(int proc_nr, int opcode,
 			u64_t position, iovec_t *iov, unsigned nr_req);
+static int m_vtransfer(int proc_nr, int opcode,
+			unsigned long position, iovec_t *iov, unsigned nr_req);
 static int m_do_open(struct driver *dp, kipc_msg_t *m_ptr);
 static int m_do_close(struct driver *dp, kipc_msg_t *m_ptr);
 static void m_init(void);
@@ -162,6 +176,10 @@ unsigned nr_req;		/* length of request vector */
 	return 0;	/* Beyond EOF */
   position= cv64ul(pos64);
 
+  /* Memory backed devices copy the whole vector at once. */
+  if (m_device != NULL_DEV && m_device != MEM_DEV && m_device != ZERO_DEV)
+	return m_vtransfer(proc_nr, opcode, position, iov, nr_req);
+
   /* Get minor device number and check for /dev/null. */
   dv = &m_geom[m_device];
   dv_size = cv64ul(dv->dv_size);
@@ -213,11 +231,11 @@ unsigned nr_req;		/* length of request vector */
 	case MEM_DEV:
 	{
 	    u32_t pagestart, page_off;
-	    static u32_t pagestart_mapped;
+	    static u32_t pagestart_mapped, mapped_len;
 	    static int any_mapped = 0;
 	    static char *vaddr;
 	    int r;
-	    u32_t subcount;
+	    u32_t subcount, len;
   	    phys_bytes mem_phys;
 
 	    if (position >= dv_size)
@@ -229,16 +247,25 @@ unsigned nr_req;		/* length of request vector */
 	    page_off = mem_phys % I386_PAGE_SIZE;
 	    pagestart = mem_phys - page_off; 
 
-	    /* All memory to the map call has to be page-aligned.
-	     * Don't have to map same page over and over.
+	    /* All memory to the map call has to be page-aligned. A window
+	     * of several pages is mapped at once, don't have to map it
+	     * over and over.
 	     */
-	    if(!any_mapped || pagestart_mapped != pagestart) {
+	    if(!any_mapped || mem_phys < pagestart_mapped ||
+		mem_phys - pagestart_mapped >= mapped_len) {
 	     if(any_mapped) {
-		if(vm_unmap_phys(ENDPT_SELF, vaddr, I386_PAGE_SIZE) != 0)
+		if(vm_unmap_phys(ENDPT_SELF, vaddr, mapped_len) != 0)
       			panic("MEM","vm_unmap_phys failed",NO_NUM);
 		any_mapped = 0;
 	     }
-	     vaddr = vm_map_phys(ENDPT_SELF, (void *) pagestart, I386_PAGE_SIZE);
+	     len = page_off + count;
+	     if(len % I386_PAGE_SIZE)
+		len += I386_PAGE_SIZE - len % I386_PAGE_SIZE;
+	     if(len > MEM_WINDOW_PAGES * I386_PAGE_SIZE)
+		len = MEM_WINDOW_PAGES * I386_PAGE_SIZE;
+	     if(len > 0xffffffff - pagestart + 1)
+		len = I386_PAGE_SIZE;	/* top of the address space */
+	     vaddr = vm_map_phys(ENDPT_SELF, (void *) pagestart, len);
 	     if(vaddr == MAP_FAILED) 
 		r = -ENOMEM;
 	     else
@@ -249,10 +276,12 @@ unsigned nr_req;		/* length of request vector */
 	     }
 	     any_mapped = 1;
 	     pagestart_mapped = pagestart;
+	     mapped_len = len;
 	   }
 
-	    /* how much to be done within this page. */
-	    subcount = I386_PAGE_SIZE-page_off;
+	    /* how much to be done within this window. */
+	    page_off = mem_phys - pagestart_mapped;
+	    subcount = mapped_len-page_off;
 	    if(subcount > count)
 		subcount = count;
 
@@ -297,6 +326,67 @@ unsigned nr_req;		/* length of request vector */
   return 0;
 }
 
+/*===========================================================================*
+ *				m_vtransfer				     *
+ *===========================================================================*/
+static int m_vtransfer(proc_nr, opcode, position, iov, nr_req)
+int proc_nr;			/* process doing the request */
+int opcode;			/* DEV_GATHER_S or DEV_SCATTER_S */
+unsigned long position;		/* offset on device to read or write */
+iovec_t *iov;			/* pointer to read or write request vector */
+unsigned nr_req;		/* length of request vector */
+{
+/* Read or write a device that is backed by our own memory. The whole request
+ * vector is handed to the kernel in one sys_vsafecopy() call.
+ */
+  static struct vscp_vec vec[SCPVEC_NR];
+  unsigned long dv_size;
+  vir_bytes dev_vaddr;
+  unsigned count;
+  int i, n, r;
+
+  /* Bogus number. */
+  if(m_device < 0 || m_device >= NR_DEVS) {
+	return(-EINVAL);
+  }
+  dev_vaddr = m_vaddrs[m_device];
+  if(!dev_vaddr || dev_vaddr == (vir_bytes) MAP_FAILED) {
+	printk("MEM: dev %d not initialized\n", m_device);
+	return -EIO;
+  }
+  dv_size = cv64ul(m_geom[m_device].dv_size);
+
+  while (nr_req > 0 && position < dv_size) {
+	for (n = 0; n < nr_req && n < SCPVEC_NR && position < dv_size; n++) {
+		count = iov[n].iov_size;
+		if (position + count > dv_size) count = dv_size - position;
+
+		if (opcode == DEV_GATHER_S) {
+			vec[n].v_from = ENDPT_SELF;
+			vec[n].v_to = proc_nr;
+		} else {
+			vec[n].v_from = proc_nr;
+			vec[n].v_to = ENDPT_SELF;
+		}
+		vec[n].v_gid = iov[n].iov_addr;
+		vec[n].v_offset = 0;
+		vec[n].v_addr = dev_vaddr + position;
+		vec[n].v_bytes = count;
+		position += count;
+	}
+
+	if ((r = sys_vsafecopy(vec, n)) != 0)
+		panic("MEM","I/O copy failed",r);
+
+	/* Book the number of bytes transferred. */
+	for (i = 0; i < n; i++)
+		iov[i].iov_size -= vec[i].v_bytes;
+	iov += n;
+	nr_req -= n;
+  }
+  return 0;
+}
+
 /*===========================================================================*
  *				m_do_open				     *
  *===========================================================================*/
@@ -348,6 +438,11 @@ kipc_msg_t *m_ptr;
   }
   openct[m_device]--;
 
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+  if(openct[m_device] == 0)
+	m_unmap(m_device);
+#endif
+
   return(0);
 }
 
@@ -459,6 +554,9 @@ kipc_msg_t *m_ptr;				/* pointer to control message */
 			panic("MEM","huge old ramdisk", NO_NUM);
 		}
 		size = ex64lo(dv->dv_size);
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+		m_unmap(dev);
+#endif
 		munmap((void *) m_vaddrs[dev], size);
 		m_vaddrs[dev] = (vir_bytes) NULL;
 	}
@@ -467,8 +565,13 @@ kipc_msg_t *m_ptr;				/* pointer to control message */
 	printk("MEM:%d: allocating ramdisk of size 0x%x\n", dev, ramdev_size);
 #endif
 
-	/* Try to allocate a piece of memory for the RAM disk. */
+	/* Try to allocate a piece of memory for the RAM disk. It has to be
+	 * shared to be mapped into a file server.
+	 */
 	if((mem = mmap(0, ramdev_size, PROT_READ|PROT_WRITE,
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+		MAP_SHARED|
+#endif
 		MAP_PREALLOC|MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
 	    printk("MEM: failed to get memory for ramdisk\n");
             return(-ENOMEM);
@@ -481,12 +584,77 @@ kipc_msg_t *m_ptr;				/* pointer to control message */
 	break;
     }
 
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+    case MIOCRAMMAP: {
+	/* A file server wants a RAM disk in its own address space. */
+	struct rammap rm;
+	endpoint_t ep;
+	void *addr;
+	int s, dev;
+
+	dev = m_ptr->DEVICE;
+	if((dev < RAM_DEV_FIRST || dev > RAM_DEV_LAST) && dev != RAM_DEV_OLD)
+		return(-EINVAL);
+	if ((dv = m_prepare(dev)) == NIL_DEV) return(-ENXIO);
+	if(!m_vaddrs[dev]) return(-ENXIO);
+
+	/* Only map into the caller itself, not someone it speaks for. */
+	ep = m_ptr->m_source;
+	if(m_ptr->IO_ENDPT != ep) return(-EPERM);
+
+	/* A RAM disk is mapped into one file server at a time. Taking it
+	 * away from the other one would leave it writing to unmapped memory;
+	 * the mapping is released when the device is closed.
+	 */
+	if(m_map_ep[dev] != 0 && m_map_ep[dev] != ep) return(-EBUSY);
+
+	if(m_map_ep[dev] != ep) {
+		addr = vm_remap(ep, MEM_PROC_NR, NULL, (void *) m_vaddrs[dev],
+			ex64lo(dv->dv_size));
+		if(addr == MAP_FAILED) {
+			printk("MEM: MIOCRAMMAP: vm_remap failed\n");
+			return(-ENOMEM);
+		}
+		m_map_ep[dev] = ep;
+		m_map_addr[dev] = (vir_bytes) addr;
+	}
+
+	rm.rm_base = m_map_addr[dev];
+	rm.rm_size = ex64lo(dv->dv_size);
+	s= sys_safecopyto(m_ptr->IO_ENDPT, (vir_bytes)m_ptr->IO_GRANT,
+		0, (vir_bytes)&rm, sizeof(rm), D);
+	if (s != 0)
+		return s;
+
+	break;
+    }
+#endif
+
     default:
   	return(do_diocntl(&m_dtab, m_ptr));
   }
   return 0;
 }
 
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+/*===========================================================================*
+ *				m_unmap					     *
+ *===========================================================================*/
+static void m_unmap(dev)
+int dev;
+{
+/* Take a RAM disk out of the file server it was mapped into. The file server
+ * may be gone already, so failure is not an error.
+ */
+  if(m_map_ep[dev] == 0)
+	return;
+
+  (void) vm_unmap(m_map_ep[dev], (void *) m_map_addr[dev]);
+  m_map_ep[dev] = 0;
+  m_map_addr[dev] = 0;
+}
+#endif
+
 /*===========================================================================*
  *				m_geometry				     *
  *===========================================================================*/
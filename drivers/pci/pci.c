@@ -28,6 +28,10 @@ Created:	Jan 2000 by Philip Homburg <philip@cs.vu.nl>
 #include <servers/rs/rs.h>
 #include <asm/servers/vm/vm.h>
 #include <asm/bootparam.h>
+#ifdef CONFIG_PCI_ECAM
+#include <nucleos/vm.h>
+#include <nucleos/mman.h>
+#endif
 
 #include "pci_amd.h"
 #include "pci_intel.h"
@@ -95,6 +99,62 @@ static struct pcidev
 
 static int nr_pcidev= 0;
 
+#ifdef CONFIG_PCI_ECAM
+/* Enhanced configuration access: the configuration space of every function
+ * is mapped into memory, 4 KB per function and 1 MB per bus. ACPI tells
+ * where in its MCFG table.
+ */
+#define ECAM_BUS_SHIFT	20
+#define ECAM_DEV_SHIFT	15
+#define ECAM_FUNC_SHIFT	12
+#define ECAM_BUS_SIZE	(1L << ECAM_BUS_SHIFT)
+
+#define BDA_EBDA_SEG	0x40E	/* segment of the extended BIOS data area */
+#define BASE_MEM_TOP	0x90000	/* lowest address sys_readbios allows above
+				 * the BDA
+				 */
+#define ACPI_ROM_BEGIN	0xE0000	/* where the RSDP may be in the BIOS ROM */
+#define ACPI_RSDP_SUMLEN 20	/* bytes covered by the RSDP checksum */
+#define ACPI_RANGE	0x100000 /* granularity of the memory asked for */
+#define MCFG_RESERVED	8	/* bytes between MCFG header and entries */
+
+struct acpi_rsdp
+{
+	char signature[8];	/* "RSD PTR " */
+	u8_t checksum;
+	char oemid[6];
+	u8_t revision;
+	u32_t rsdt_addr;
+} __attribute__((packed));
+
+struct acpi_sdt_hdr
+{
+	char signature[4];
+	u32_t length;
+	u8_t revision;
+	u8_t checksum;
+	char oemid[6];
+	char oem_table_id[8];
+	u32_t oem_revision;
+	u32_t creator_id;
+	u32_t creator_revision;
+} __attribute__((packed));
+
+struct acpi_mcfg_entry
+{
+	u32_t base_lo;		/* configuration space of bus 0 */
+	u32_t base_hi;
+	u16_t segment;
+	u8_t start_bus;
+	u8_t end_bus;
+	u32_t reserved;
+} __attribute__((packed));
+
+static phys_bytes ecam_base;
+static int ecam_start, ecam_end;
+static char *ecam_bus[256];	/* mapped buses, MAP_FAILED if unusable */
+#endif /* CONFIG_PCI_ECAM */
+
 static void pci_intel_init(void);
 static void probe_bus(int busind);
 static int is_duplicate(u8 busnr, u8 dev, u8 func);
@@ -141,6 +201,21 @@ static void pcii_wreg16(int busind, int devind, int port, u16 value);
 static void pcii_wreg32(int busind, int devind, int port, u32_t value);
 static u16_t pcii_rsts(int busind);
 static void pcii_wsts(int busind, u16 value);
+#ifdef CONFIG_PCI_ECAM
+static int acpi_read(phys_bytes addr, void *buf, size_t len);
+static int acpi_table(phys_bytes addr, char *sig, void *buf, size_t size);
+static phys_bytes acpi_find_rsdt(void);
+static int ecam_init(void);
+static volatile u8_t *ecam_reg(int busnr, int dev, int func, int port);
+static u8_t pcie_rreg8(int busind, int devind, int port);
+static u16_t pcie_rreg16(int busind, int devind, int port);
+static u32_t pcie_rreg32(int busind, int devind, int port);
+static void pcie_wreg8(int busind, int devind, int port, u8 value);
+static void pcie_wreg16(int busind, int devind, int port, u16 value);
+static void pcie_wreg32(int busind, int devind, int port, u32_t value);
+static u16_t pcie_rsts(int busind);
+static void pcie_wsts(int busind, u16 value);
+#endif
 static void print_capabilities(int devind);
 static int visible(struct rs_pci *aclp, int devind);
 static void print_hyper_cap(int devind, u8 capptr);
@@ -666,6 +741,22 @@ static void pci_intel_init()
 	pcibus[busind].pb_wreg32= pcii_wreg32;
 	pcibus[busind].pb_rsts= pcii_rsts;
 	pcibus[busind].pb_wsts= pcii_wsts;
+#ifdef CONFIG_PCI_ECAM
+	if (ecam_init())
+	{
+		/* Buses behind bridges inherit these. Ports are still
+		 * used for buses outside the MCFG range.
+		 */
+		pcibus[busind].pb_rreg8= pcie_rreg8;
+		pcibus[busind].pb_rreg16= pcie_rreg16;
+		pcibus[busind].pb_rreg32= pcie_rreg32;
+		pcibus[busind].pb_wreg8= pcie_wreg8;
+		pcibus[busind].pb_wreg16= pcie_wreg16;
+		pcibus[busind].pb_wreg32= pcie_wreg32;
+		pcibus[busind].pb_rsts= pcie_rsts;
+		pcibus[busind].pb_wsts= pcie_wsts;
+	}
+#endif
 
 	dstr= pci_dev_name(vid, did);
 	if (!dstr)
@@ -2444,6 +2535,384 @@ u16_t value;
 }
 
 
+#ifdef CONFIG_PCI_ECAM
+/*===========================================================================*
+ *				acpi_read				     *
+ *===========================================================================*/
+static int acpi_read(addr, buf, len)
+phys_bytes addr;
+void *buf;
+size_t len;
+{
+	/* Copy len bytes of physical memory at addr, an ACPI table, into
+	 * buf by mapping them for a moment.
+	 */
+	struct mem_range mr;
+	phys_bytes base;
+	size_t size;
+	char *p;
+	int r;
+
+	base= addr & ~(phys_bytes)(I386_PAGE_SIZE-1);
+	size= addr + len - base;
+
+	/* ACPI keeps its tables together. One range normally allows access
+	 * to all of them.
+	 */
+	if (sys_privquery_mem(ENDPT_SELF, base, size) != 0)
+	{
+		mr.mr_base= addr & ~(phys_bytes)(ACPI_RANGE-1);
+		mr.mr_limit= (addr + len - 1) | (ACPI_RANGE-1);
+		r= sys_privctl(ENDPT_SELF, SYS_PRIV_ADD_MEM, &mr);
+		if (r != 0)
+			return r;
+	}
+
+	p= vm_map_phys(ENDPT_SELF, (void *)base, size);
+	if (p == MAP_FAILED)
+		return -ENOMEM;
+	memcpy(buf, p + (addr - base), len);
+	vm_unmap_phys(ENDPT_SELF, p, size);
+	return 0;
+}
+
+/*===========================================================================*
+ *				acpi_table				     *
+ *===========================================================================*/
+static int acpi_table(addr, sig, buf, size)
+phys_bytes addr;
+char *sig;
+void *buf;
+size_t size;
+{
+	/* Read the ACPI table at addr into buf if it has the signature sig,
+	 * fits and has a good checksum. Returns its length or 0.
+	 */
+	struct acpi_sdt_hdr *hdr= buf;
+	u8_t sum, *p;
+	size_t i;
+
+	if (acpi_read(addr, hdr, sizeof(*hdr)) != 0)
+		return 0;
+	if (memcmp(hdr->signature, sig, sizeof(hdr->signature)) != 0)
+		return 0;
+	if (hdr->length < sizeof(*hdr) || hdr->length > size)
+	{
+		printk("PCI: ACPI table %.4s too big: %u\n", sig, hdr->length);
+		return 0;
+	}
+	if (acpi_read(addr, buf, hdr->length) != 0)
+		return 0;
+
+	for (i= 0, sum= 0, p= buf; i<hdr->length; i++)
+		sum += p[i];
+	if (sum != 0)
+	{
+		printk("PCI: bad checksum of ACPI table %.4s\n", sig);
+		return 0;
+	}
+	return hdr->length;
+}
+
+/*===========================================================================*
+ *				acpi_find_rsdt				     *
+ *===========================================================================*/
+static phys_bytes acpi_find_rsdt()
+{
+	/* Look for the root system description pointer in the first KB of
+	 * the extended BIOS data area and in the BIOS ROM.
+	 */
+	static u8_t buf[1024];
+	struct acpi_rsdp *rsdp;
+	phys_bytes addr, end;
+	u16_t ebda;
+	u8_t sum;
+	int i, off;
+
+	if (sys_readbios(BDA_EBDA_SEG, &ebda, sizeof(ebda)) != 0)
+		ebda= 0;
+
+	for (addr= (phys_bytes)ebda << 4; addr < 0x100000; addr= end)
+	{
+		end= addr + sizeof(buf);
+		if (addr < BASE_MEM_TOP)
+		{
+			/* No EBDA where we can read it, only the ROM */
+			addr= ACPI_ROM_BEGIN;
+			end= addr + sizeof(buf);
+		}
+		if (sys_readbios(addr, buf, sizeof(buf)) != 0)
+			return 0;
+
+		for (off= 0; off + sizeof(*rsdp) <= sizeof(buf); off += 16)
+		{
+			rsdp= (struct acpi_rsdp *)(buf + off);
+			if (memcmp(rsdp->signature, "RSD PTR ", 8) != 0)
+				continue;
+			for (i= 0, sum= 0; i<ACPI_RSDP_SUMLEN; i++)
+				sum += buf[off+i];
+			if (sum == 0)
+				return rsdp->rsdt_addr;
+		}
+
+		/* Continue in the ROM after the EBDA */
+		if (end < ACPI_ROM_BEGIN)
+			end= ACPI_ROM_BEGIN;
+	}
+	return 0;
+}
+
+/*===========================================================================*
+ *				ecam_init				     *
+ *===========================================================================*/
+static int ecam_init()
+{
+	/* Find the memory mapped configuration space of PCI segment 0 in the
+	 * MCFG table of ACPI. Returns whether there is one.
+	 */
+	static u32_t buf[1024/sizeof(u32_t)];
+	struct acpi_sdt_hdr *hdr= (struct acpi_sdt_hdr *)buf;
+	struct acpi_mcfg_entry *ent;
+	struct mem_range mr;
+	phys_bytes rsdt, mcfg;
+	int i, n, r, len;
+	long v;
+
+	v= 1;
+	env_parse("pci_ecam", "d", 0, &v, 0, 1);
+	if (!v)
+		return 0;
+
+	if ((rsdt= acpi_find_rsdt()) == 0)
+		return 0;
+	if ((len= acpi_table(rsdt, "RSDT", buf, sizeof(buf))) == 0)
+		return 0;
+
+	/* Search the table pointers following the RSDT header. */
+	n= (len - sizeof(*hdr)) / sizeof(u32_t);
+	mcfg= 0;
+	for (i= 0; i<n; i++)
+	{
+		mcfg= buf[sizeof(*hdr)/sizeof(u32_t) + i];
+		if ((len= acpi_table(mcfg, "MCFG", buf, sizeof(buf))) != 0)
+			break;
+		/* buf holds the RSDT only as long as nothing is found */
+		if ((len= acpi_table(rsdt, "RSDT", buf, sizeof(buf))) == 0)
+			return 0;
+	}
+	if (i == n)
+		return 0;
+
+	n= (len - sizeof(*hdr) - MCFG_RESERVED) / sizeof(*ent);
+	ent= (struct acpi_mcfg_entry *)((char *)buf + sizeof(*hdr) +
+		MCFG_RESERVED);
+	for (i= 0; i<n; i++, ent++)
+	{
+		if (ent->segment == 0 && ent->base_hi == 0 &&
+			ent->start_bus <= ent->end_bus)
+		{
+			break;
+		}
+	}
+	if (i == n)
+		return 0;
+
+	ecam_base= ent->base_lo;
+	ecam_start= ent->start_bus;
+	ecam_end= ent->end_bus;
+
+	mr.mr_base= ecam_base + ((phys_bytes)ecam_start << ECAM_BUS_SHIFT);
+	mr.mr_limit= ecam_base + ((phys_bytes)(ecam_end+1) << ECAM_BUS_SHIFT)
+		- 1;
+	if ((r= sys_privctl(ENDPT_SELF, SYS_PRIV_ADD_MEM, &mr)) != 0)
+	{
+		printk("PCI: unable to get access to ECAM: %d\n", r);
+		return 0;
+	}
+
+	if (debug)
+	{
+		printk("PCI: ECAM at 0x%lx for buses %d..%d\n",
+			(unsigned long)ecam_base, ecam_start, ecam_end);
+	}
+	return 1;
+}
+
+/*===========================================================================*
+ *				ecam_reg				     *
+ *===========================================================================*/
+static volatile u8_t *ecam_reg(busnr, dev, func, port)
+int busnr;
+int dev;
+int func;
+int port;
+{
+	/* Address of a register in the memory mapped configuration space.
+	 * A bus is mapped when it is first used. NULL means that the I/O
+	 * ports have to be used for it.
+	 */
+	char *p;
+
+	if (busnr < ecam_start || busnr > ecam_end)
+		return NULL;
+
+	if ((p= ecam_bus[busnr]) == NULL)
+	{
+		p= vm_map_phys(ENDPT_SELF,
+			(void *)(ecam_base + ((phys_bytes)busnr << ECAM_BUS_SHIFT)),
+			ECAM_BUS_SIZE);
+		if (p == MAP_FAILED)
+		{
+			printk("PCI: unable to map ECAM of bus %d\n", busnr);
+		}
+		ecam_bus[busnr]= p;
+	}
+	if (p == MAP_FAILED)
+		return NULL;
+
+	return (volatile u8_t *)p + (dev << ECAM_DEV_SHIFT) +
+		(func << ECAM_FUNC_SHIFT) + port;
+}
+
+/*===========================================================================*
+ *				pcie_rreg8				     *
+ *===========================================================================*/
+static u8_t pcie_rreg8(busind, devind, port)
+int busind;
+int devind;
+int port;
+{
+	volatile u8_t *p;
+
+	p= ecam_reg(pcibus[busind].pb_busnr,
+		pcidev[devind].pd_dev, pcidev[devind].pd_func, port);
+	if (p == NULL)
+		return pcii_rreg8(busind, devind, port);
+	return *p;
+}
+
+/*===========================================================================*
+ *				pcie_rreg16				     *
+ *===========================================================================*/
+static u16_t pcie_rreg16(busind, devind, port)
+int busind;
+int devind;
+int port;
+{
+	volatile u8_t *p;
+
+	p= ecam_reg(pcibus[busind].pb_busnr,
+		pcidev[devind].pd_dev, pcidev[devind].pd_func, port);
+	if (p == NULL || (port & 1))
+		return pcii_rreg16(busind, devind, port);
+	return *(volatile u16_t *)p;
+}
+
+/*===========================================================================*
+ *				pcie_rreg32				     *
+ *===========================================================================*/
+static u32_t pcie_rreg32(busind, devind, port)
+int busind;
+int devind;
+int port;
+{
+	volatile u8_t *p;
+
+	p= ecam_reg(pcibus[busind].pb_busnr,
+		pcidev[devind].pd_dev, pcidev[devind].pd_func, port);
+	if (p == NULL || (port & 3))
+		return pcii_rreg32(busind, devind, port);
+	return *(volatile u32_t *)p;
+}
+
+/*===========================================================================*
+ *				pcie_wreg8				     *
+ *===========================================================================*/
+static void pcie_wreg8(busind, devind, port, value)
+int busind;
+int devind;
+int port;
+u8_t value;
+{
+	volatile u8_t *p;
+
+	p= ecam_reg(pcibus[busind].pb_busnr,
+		pcidev[devind].pd_dev, pcidev[devind].pd_func, port);
+	if (p == NULL)
+		pcii_wreg8(busind, devind, port, value);
+	else
+		*p= value;
+}
+
+/*===========================================================================*
+ *				pcie_wreg16				     *
+ *===========================================================================*/
+static void pcie_wreg16(busind, devind, port, value)
+int busind;
+int devind;
+int port;
+u16_t value;
+{
+	volatile u8_t *p;
+
+	p= ecam_reg(pcibus[busind].pb_busnr,
+		pcidev[devind].pd_dev, pcidev[devind].pd_func, port);
+	if (p == NULL || (port & 1))
+		pcii_wreg16(busind, devind, port, value);
+	else
+		*(volatile u16_t *)p= value;
+}
+
+/*===========================================================================*
+ *				pcie_wreg32				     *
+ *===========================================================================*/
+static void pcie_wreg32(busind, devind, port, value)
+int busind;
+int devind;
+int port;
+u32_t value;
+{
+	volatile u8_t *p;
+
+	p= ecam_reg(pcibus[busind].pb_busnr,
+		pcidev[devind].pd_dev, pcidev[devind].pd_func, port);
+	if (p == NULL || (port & 3))
+		pcii_wreg32(busind, devind, port, value);
+	else
+		*(volatile u32_t *)p= value;
+}
+
+/*===========================================================================*
+ *				pcie_rsts				     *
+ *===========================================================================*/
+static u16_t pcie_rsts(busind)
+int busind;
+{
+	volatile u8_t *p;
+
+	p= ecam_reg(pcibus[busind].pb_busnr, 0, 0, PCI_SR);
+	if (p == NULL)
+		return pcii_rsts(busind);
+	return *(volatile u16_t *)p;
+}
+
+/*===========================================================================*
+ *				pcie_wsts				     *
+ *===========================================================================*/
+static void pcie_wsts(busind, value)
+int busind;
+u16_t value;
+{
+	volatile u8_t *p;
+
+	p= ecam_reg(pcibus[busind].pb_busnr, 0, 0, PCI_SR);
+	if (p == NULL)
+		pcii_wsts(busind, value);
+	else
+		*(volatile u16_t *)p= value;
+}
+#endif /* CONFIG_PCI_ECAM */
+
 /*===========================================================================*
  *				print_capabilities			     *
  *===========================================================================*/
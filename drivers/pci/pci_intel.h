@@ -36,22 +36,37 @@ Created:	Jan 2000 by Philip Homburg <philip@cs.vu.nl>
 #define PCII_RREG8_(bus, dev, func, reg) \
 	(pci_outl(PCII_CONFADD, PCII_SELREG_(bus, dev, func, reg)), \
 	pci_inb(PCII_CONFDATA+((reg)&3)))
+/* Aligned words and dwords take one data port access, others are put
+ * together from smaller ones.
+ */
 #define PCII_RREG16_(bus, dev, func, reg) \
+	(((reg) & 1) ? \
 	(PCII_RREG8_(bus, dev, func, reg) | \
-	(PCII_RREG8_(bus, dev, func, reg+1) << 8))
+	(PCII_RREG8_(bus, dev, func, reg+1) << 8)) : \
+	(pci_outl(PCII_CONFADD, PCII_SELREG_(bus, dev, func, reg)), \
+	pci_inw(PCII_CONFDATA+((reg)&2))))
 #define PCII_RREG32_(bus, dev, func, reg) \
+	(((reg) & 3) ? \
 	(PCII_RREG16_(bus, dev, func, reg) | \
-	(PCII_RREG16_(bus, dev, func, reg+2) << 16))
+	(PCII_RREG16_(bus, dev, func, reg+2) << 16)) : \
+	(pci_outl(PCII_CONFADD, PCII_SELREG_(bus, dev, func, reg)), \
+	pci_inl(PCII_CONFDATA)))
 
 #define PCII_WREG8_(bus, dev, func, reg, val) \
 	(pci_outl(PCII_CONFADD, PCII_SELREG_(bus, dev, func, reg)), \
 	pci_outb(PCII_CONFDATA+((reg)&3), (val)))
 #define PCII_WREG16_(bus, dev, func, reg, val) \
+	(((reg) & 1) ? \
 	(PCII_WREG8_(bus, dev, func, reg, (val)), \
-	(PCII_WREG8_(bus, dev, func, reg+1, (val) >> 8)))
+	(PCII_WREG8_(bus, dev, func, reg+1, (val) >> 8))) : \
+	(pci_outl(PCII_CONFADD, PCII_SELREG_(bus, dev, func, reg)), \
+	pci_outw(PCII_CONFDATA+((reg)&2), (val))))
 #define PCII_WREG32_(bus, dev, func, reg, val) \
+	(((reg) & 3) ? \
 	(PCII_WREG16_(bus, dev, func, reg, (val)), \
-	(PCII_WREG16_(bus, dev, func, reg+2, (val) >> 16)))
+	(PCII_WREG16_(bus, dev, func, reg+2, (val) >> 16))) : \
+	(pci_outl(PCII_CONFADD, PCII_SELREG_(bus, dev, func, reg)), \
+	pci_outl(PCII_CONFDATA, (val))))
 
 /* PIIX configuration registers */
 #define PIIX_PIRQRCA	0x60
@@ -82,4 +82,14 @@ void cipherDecryptUpdateRounds(rd_keyinstance *key,
 
 #endif /* INTERMEDIATE_VALUE_KAT */
 
+/* AES-256 encryption with the AES-NI instructions (aesni.S). The caller
+ * checks that the cpu has them.
+ */
+#define AESNI_SCHED_SIZE	(15*AES_BLOCKSIZE)
+
+void aesni_setkey(void *_sched, const void *_key);
+
+void aesni_ctr(const void *_sched, u32_t _ctr[2], void *_out,
+	size_t _nblocks);
+
 #endif /* _CRYPTO__RIJNDAEL_H */
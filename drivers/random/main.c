@@ -60,7 +60,7 @@ static struct driver r_dtab = {
 };
 
 /* Buffer for the /dev/random number generator. */
-#define RANDOM_BUF_SIZE 		1024
+#define RANDOM_BUF_SIZE 		16384	/* most output per key */
 static char random_buf[RANDOM_BUF_SIZE];
 
 /*===========================================================================*
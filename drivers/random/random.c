@@ -18,6 +18,7 @@ that data into a seed for a psuedo random number generator.
 
 #include <nucleos/drivers.h>
 #include <kernel/const.h>
+#include <asm/cpufeature.h>
 #include "assert.h"
 #include "random.h"
 #include "sha2.h"
@@ -37,9 +38,11 @@ static int got_seeded= 0;
 static u8_t random_key[2*AES_BLOCKSIZE];
 static u32_t count_lo, count_hi;
 static u32_t reseed_count;
+static int use_aesni;
+static u8_t aesni_sched[AESNI_SCHED_SIZE];
 
 static void add_sample(int source, unsigned long sample);
-static void data_block(rd_keyinstance *keyp, void *data);
+static void data_blocks(rd_keyinstance *keyp, void *data, size_t n);
 static void reseed(void);
 
 void random_init()
@@ -60,6 +63,9 @@ void random_init()
 	count_lo= 0;
 	count_hi= 0;
 	reseed_count= 0;
+
+	/* Both ciphers produce the same output, the AES-NI one is faster. */
+	use_aesni= cpufeature(_CPUF_I386_AES);
 }
 
 int random_isseeded()
@@ -90,34 +96,32 @@ void random_getbytes(buf, size)
 void *buf;
 size_t size;
 {
-	int n, r;
-	u8_t *cp;
+	int r;
+	size_t n;
 	rd_keyinstance key;
 	u8_t output[AES_BLOCKSIZE];
 
-	r= rijndael_makekey(&key, sizeof(random_key), random_key);
-	assert(r == 0);
+	if (use_aesni)
+		aesni_setkey(aesni_sched, random_key);
+	else
+	{
+		r= rijndael_makekey(&key, sizeof(random_key), random_key);
+		assert(r == 0);
+	}
 
-	cp= buf;
-	while (size > 0)
+	/* Whole blocks go straight to the buffer. */
+	n= size / AES_BLOCKSIZE;
+	data_blocks(&key, buf, n);
+	if (size % AES_BLOCKSIZE != 0)
 	{
-		n= AES_BLOCKSIZE;
-		if (n > size)
-		{
-			n= size;
-			data_block(&key, output);
-			memcpy(cp, output, n);
-		}
-		else
-			data_block(&key, cp);
-		cp += n;
-		size -= n;
+		data_blocks(&key, output, 1);
+		memcpy((u8_t *)buf + n*AES_BLOCKSIZE, output,
+			size % AES_BLOCKSIZE);
 	}
 
 	/* Generate new key */
 	assert(sizeof(random_key) == 2*AES_BLOCKSIZE);
-	data_block(&key, random_key);
-	data_block(&key, random_key+AES_BLOCKSIZE);
+	data_blocks(&key, random_key, 2);
 }
 
 void random_putbytes(buf, size)
@@ -186,29 +190,45 @@ unsigned long sample;
 	pool_ind[source]= pool_nr;
 }
 
-static void data_block(keyp, data)
+static void data_blocks(keyp, data, n)
 rd_keyinstance *keyp;
 void *data;
+size_t n;
 {
 	int r;
+	u8_t *cp;
+	u32_t count[2];
 	u8_t input[AES_BLOCKSIZE];
 
-	memset(input, '\0', sizeof(input));
-
 	/* Do we want the output of the random numbers to be portable 
 	 * across platforms (for example for RSA signatures)? At the moment
 	 * we don't do anything special. Encrypt the counter with the AES
-	 * key.
+	 * key, n blocks in a row. The key is expanded for the AES-NI cipher
+	 * in aesni_sched, otherwise in keyp.
 	 */
+	if (use_aesni)
+	{
+		count[0]= count_lo;
+		count[1]= count_hi;
+		aesni_ctr(aesni_sched, count, data, n);
+		count_lo= count[0];
+		count_hi= count[1];
+		return;
+	}
+
+	memset(input, '\0', sizeof(input));
 	assert(sizeof(count_lo)+sizeof(count_hi) <= AES_BLOCKSIZE);
-	memcpy(input, &count_lo, sizeof(count_lo));
-	memcpy(input+sizeof(count_lo), &count_hi, sizeof(count_hi));
-	r= rijndael_ecb_encrypt(keyp, input, data, AES_BLOCKSIZE, NULL);
-	assert(r == AES_BLOCKSIZE);
-
-	count_lo++;
-	if (count_lo == 0)
-		count_hi++;
+	for (cp= data; n > 0; cp += AES_BLOCKSIZE, n--)
+	{
+		memcpy(input, &count_lo, sizeof(count_lo));
+		memcpy(input+sizeof(count_lo), &count_hi, sizeof(count_hi));
+		r= rijndael_ecb_encrypt(keyp, input, cp, AES_BLOCKSIZE, NULL);
+		assert(r == AES_BLOCKSIZE);
+
+		count_lo++;
+		if (count_lo == 0)
+			count_hi++;
+	}
 }
 
 static void reseed()
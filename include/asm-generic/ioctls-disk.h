@@ -22,5 +22,7 @@
 #define DIOCEJECT	_IO ('d', 5)
 #define DIOCTIMEOUT	_IORW('d', 6, int)
 #define DIOCOPENCT	_IOR('d', 7, int)
+#define DIOCGETPOLL	_IOR('d', 8, struct dpoll_info)
+#define DIOCSETPOLL	_IOW('d', 9, struct dpoll_info)
 
 #endif /* __ASM_GENERIC_IOCTLS_DISK_H */
@@ -21,5 +21,6 @@
 #define MIOCRAMSIZE	_IOW('m', 3, u32_t)
 #define MIOCMAP		_IOW('m', 4, struct mapreq)
 #define MIOCUNMAP	_IOW('m', 5, struct mapreq)
+#define MIOCRAMMAP	_IOR('m', 6, struct rammap)
 
 #endif /* __ASM_GENERIC_IOCTLS_MEMORY_H */
@@ -35,6 +35,10 @@
 #define unset_sys_bit(map,bit) \
 	( MAP_CHUNK(map.chunk,bit) &= ~(1 << CHUNK_OFFSET(bit) )
 #define NR_SYS_CHUNKS	BITMAP_CHUNKS(NR_SYS_PROCS)
+
+#ifndef CONFIG_SMP
+#define CONFIG_MAX_CPUS	1	/* one set of run queues on UP */
+#endif
 #endif /* !(__KERNEL__ || __UKERNEL__) */
 
 #ifdef __KERNEL__
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#ifndef __KERNEL_IPCTRACE_H
+#define __KERNEL_IPCTRACE_H
+
+#include <nucleos/ipctrace.h>
+
+#ifdef __KERNEL__
+
+#ifdef CONFIG_DEBUG_KERNEL_IPC_TRACE
+
+struct proc;
+
+extern struct ipct_stats ipct_stats[NR_TASKS + NR_PROCS];
+extern struct ipct_trace ipct_trace;
+
+void ipct_call(struct proc *caller, int call_type);
+void ipct_call_end(void);
+void ipct_deliver(endpoint_t src_e, struct proc *dst);
+void ipct_block(struct proc *caller, endpoint_t dst_e);
+void ipct_unblock(struct proc *sender);
+void ipct_deadlock(struct proc *caller, int found);
+void ipct_clear(struct proc *rp);
+
+#else /* !CONFIG_DEBUG_KERNEL_IPC_TRACE */
+
+#define ipct_call(caller, call_type)	do { } while(0)
+#define ipct_call_end()			do { } while(0)
+#define ipct_deliver(src_e, dst)	do { } while(0)
+#define ipct_block(caller, dst_e)	do { } while(0)
+#define ipct_unblock(sender)		do { } while(0)
+#define ipct_deadlock(caller, found)	do { } while(0)
+#define ipct_clear(rp)			do { } while(0)
+
+#endif /* CONFIG_DEBUG_KERNEL_IPC_TRACE */
+
+#endif /* __KERNEL__ */
+#endif /* __KERNEL_IPCTRACE_H */
@@ -53,6 +53,9 @@ struct proc {
 	clock_t p_prof_left;         /* number of ticks left on profile timer */
 
 	struct proc *p_nextready;	/* pointer to next ready process */
+	u8_t p_cpu;			/* cpu whose run queue it is on, the
+					 * last one it ran on (affinity hint) */
+	unsigned p_sched_period;	/* last aging period applied */
 	struct proc *p_caller_q;	/* head of list of procs wishing to send */
 	struct proc *p_q_link;		/* link to next proc wishing to send */
 	int p_getfrom_e;		/* from whom does process want to receive? */
@@ -297,8 +300,27 @@ struct proc {
  * with sizeof(struct proc) to determine the address. 
  */
 extern struct proc proc[];		/* process table */
-extern struct proc *rdy_head[];		/* ptrs to ready list headers */
-extern struct proc *rdy_tail[];		/* ptrs to ready list tails */
+
+/* Run queues of one CPU. Bit q of rdy_map is set iff rdy_head[q] is not
+ * empty, so the highest priority ready process is found without scanning.
+ */
+struct runqueue {
+	struct proc *rdy_head[NR_SCHED_QUEUES];	/* ptrs to ready list headers */
+	struct proc *rdy_tail[NR_SCHED_QUEUES];	/* ptrs to ready list tails */
+	unsigned rdy_map;			/* non-empty queues */
+	unsigned nr_ready;			/* processes on the queues */
+};
+
+extern struct runqueue runqueue[CONFIG_MAX_CPUS];
+
+#define cpu_rq(cpu)	(&runqueue[(cpu)])
+
+#ifdef CONFIG_SMP
+int arch_cpuid(void);
+#define this_cpu()	arch_cpuid()
+#else
+#define this_cpu()	0
+#endif
 
 #endif /* __ASSEMBLY__ */
 #endif /* !(__KERNEL__ || __UKERNEL__) */
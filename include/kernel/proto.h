@@ -91,6 +91,9 @@ int disable_irq(irq_hook_t *hook);
 void cons_setc(int pos, int c);
 void cons_seth(int pos, int n);
 
+/* system/do_irqctl.c */
+void irq_coalesce_expire(clock_t now);
+
 /* debug.c */
 #ifdef CONFIG_DEBUG_KERNEL_SCHED_CHECK
 #define CHECK_RUNQUEUES check_runqueues_f(__FILE__, __LINE__)
@@ -110,6 +113,7 @@ int do_sysctl(kipc_msg_t *m);
 /* profile.c */
 void init_profile_clock(u32_t);
 void stop_profile_clock(void);
+void sprof_reset(void);
 #endif
 
 /* functions defined in architecture-dependent files. */
@@ -47,6 +47,11 @@ typedef struct irq_hook {
   int proc_nr_e;			/* (endpoint) ENDPT_NONE if not in use */
   irq_id_t notify_id;			/* id to return on interrupt */
   irq_policy_t policy;			/* bit mask for policy */
+  clock_t coalesce_ticks;		/* min. ticks between notifications */
+  unsigned deferred;			/* interrupts not notified yet */
+  clock_t notify_tm;			/* time of the last notification */
+  unsigned long nr_intr;		/* interrupts taken */
+  unsigned long nr_notify;		/* notifications delivered */
 } irq_hook_t;
 
 typedef int (*irq_handler_t)(struct irq_hook *);
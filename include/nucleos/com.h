@@ -291,6 +291,7 @@
 #define DL_WRITEV_S	(DL_RQ_BASE +11)
 #define DL_READV_S	(DL_RQ_BASE +12)
 #define DL_GETSTAT_S	(DL_RQ_BASE +13)
+#define DL_READV_Z	(DL_RQ_BASE +14)	/* receive into client buffers */
 
 /* Message type for data link layer replies. */
 #define DL_CONF_REPLY	(DL_RS_BASE + 20)
@@ -308,11 +309,22 @@
 #define DL_STAT		m_data4
 #define DL_GRANT	m_data5
 #define DL_NAME		m_data1
+#define DL_MSS		m_data6	/* DL_WRITEV_S: segment size for TSO */
+#define DL_RXGRANT	m_data6	/* DL_READV_Z: grant for received packets */
+#define DL_RXMAX	m_data7	/* DL_READV_Z: room in the DL_RXGRANT table */
+#define DL_RXSEQ	m_data8	/* DL_READV_Z: last batch consumed, reply:
+				 * batch in the DL_RXGRANT table
+				 */
 
 /* Bits in 'DL_STAT' field of DL replies. */
 #  define DL_PACK_SEND		0x01
 #  define DL_PACK_RECV		0x02
 #  define DL_READ_IP		0x04
+#  define DL_RECV_MORE		0x08	/* more received packets are ready */
+#  define DL_RXBUF_TAKEN	0x10	/* DL_READV_Z buffer table copied */
+
+/* Size of each client buffer handed to the driver with DL_READV_Z. */
+#define DL_RXBUF_SIZE	2048
 
 /* Bits in 'DL_MODE' field of DL requests. */
 #  define DL_NOMODE		0x0
@@ -457,6 +469,7 @@
 #  define IRQ_RMPOLICY      2	/* remove a slot of the IRQ table */
 #  define IRQ_ENABLE        3	/* enable interrupts */
 #  define IRQ_DISABLE       4	/* disable interrupts */
+#  define IRQ_COALESCE      5	/* min. interval between notifications */
 #define IRQ_VECTOR	m_data2   /* irq vector */
 #define IRQ_POLICY	m_data3   /* options for IRQCTL request */
 #  define IRQ_REENABLE  0x001	/* reenable IRQ line after interrupt */
@@ -464,6 +477,7 @@
 #  define IRQ_WORD      0x200	/* word values */
 #  define IRQ_LONG      0x400	/* long values */
 #define IRQ_HOOK_ID	m_data7   /* id of irq hook at kernel */
+#define IRQ_TICKS	m_data5   /* min. ticks between notifications */
 
 /* Field names for SYS_SEGCTL. */
 #define SEG_SELECT	m_data1   /* segment selector returned */ 
@@ -492,6 +506,7 @@
 #define CP_DST_ENDPT	m_data4	/* process to copy to */
 #define CP_DST_ADDR	m_data6	/* address where data go to */
 #define CP_NR_BYTES	m_data7	/* number of bytes to copy */
+#define CP_GRANT_OFFSET	m_data4	/* offset within grant (SYS_UMAP) */
 
 /* Field names for SYS_VCOPY and SYS_VVIRCOPY. */
 #define VCP_NR_OK	m_data2	/* number of successfull copies */
@@ -523,6 +538,8 @@
 #   define GET_IDLETSC	  20	/* get cumulative idle time stamp counter */
 #   define GET_AOUTHEADER 21	/* get a.out headers from the boot image */
 #   define GET_BOOTPARAM  22	/* get boot params */
+#   define GET_IPCSTATS   23	/* get per process IPC statistics */
+#   define GET_IPCTRACE   24	/* get IPC event trace */
 #define I_ENDPT      m_data4	/* calling process */
 #define I_VAL_PTR      m_data5	/* virtual address at caller */ 
 #define I_VAL_LEN      m_data1	/* max length of value */
@@ -615,6 +632,15 @@
 #define SEL_ERRORFDS   m_data5
 #define SEL_TIMEOUT    m_data6
 
+/* Field names for EPOLL_CREATE, _CTL, _WAIT (VFS_PROC_NR). */
+#define EP_FD		m_data1	/* epoll handle */
+#define EP_OP		m_data2	/* EPOLL_CTL_* */
+#define EP_TFD		m_data3	/* target file descriptor */
+#define EP_EVENT	m_data4	/* struct epoll_event for epoll_ctl */
+#define EP_MAXEVENTS	m_data2	/* size of the event array */
+#define EP_TIMEOUT	m_data3	/* ms, -1 blocks forever */
+#define EP_EVENTS	m_data4	/* event array for epoll_wait */
+
 /* Field names for SYS_SPROF, _CPROF, _PROFBUF. */
 #define PROF_ACTION    m_data1    /* start/stop/reset/get */
 #define PROF_MEM_SIZE  m_data2    /* available memory for data */ 
@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#ifndef _NUCLEOS_DPOLL_H
+#define _NUCLEOS_DPOLL_H
+
+/*
+ * Hybrid completion for block devices. While the average completion time of
+ * a device stays below a limit, its driver busy-polls the controller instead
+ * of waiting for the interrupt. DIOCGETPOLL returns a struct dpoll_info,
+ * DIOCSETPOLL sets the limit from its dpi_limit field (at most DPOLL_MAX).
+ */
+#include <nucleos/types.h>
+
+struct dpoll_info {
+	unsigned dpi_limit;		/* poll below this many us, 0 never */
+	unsigned dpi_avg;		/* average completion time in us */
+	unsigned long dpi_polled;	/* completions found by polling */
+	unsigned long dpi_intr;		/* completions signalled by interrupt */
+};
+
+#if defined(__KERNEL__) || defined(__UKERNEL__)
+#include <nucleos/kipc.h>
+
+#define DPOLL_SHIFT	3		/* moving average weight is 1/8 */
+#define DPOLL_PROBE	64		/* poll once per so many interrupts */
+#define DPOLL_MAX	10000		/* largest limit in us */
+
+/* Per device state, kept by the driver. */
+struct dpoll {
+	unsigned dp_limit_us;		/* limit in us */
+	u32_t dp_limit;			/* limit in tsc cycles */
+	u32_t dp_avg;			/* average completion time, tsc cycles */
+	unsigned dp_probe;		/* interrupts since the last poll */
+	unsigned long dp_polled;
+	unsigned long dp_intr;
+};
+
+void dpoll_setlimit(struct dpoll *dp, unsigned micros);
+int dpoll_want(struct dpoll *dp, u32_t *spinp);
+void dpoll_done(struct dpoll *dp, u64_t start, int polled);
+int dpoll_ioctl(struct dpoll *dp, kipc_msg_t *m_ptr);
+#endif
+
+#endif /* _NUCLEOS_DPOLL_H */
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#ifndef _NUCLEOS_EPOLL_H
+#define _NUCLEOS_EPOLL_H
+
+/*
+ * Persistent interest lists for processes watching many file descriptors.
+ * The descriptors are registered once with epoll_ctl() and epoll_wait()
+ * returns only those that became ready. An epoll handle is not a file
+ * descriptor: it belongs to the process that created it, is not inherited
+ * across fork() and is released with epoll_close() or on exit.
+ */
+#include <nucleos/types.h>
+
+/* Events */
+#define EPOLLIN		0x001		/* ready for reading */
+#define EPOLLOUT	0x004		/* ready for writing */
+#define EPOLLERR	0x008		/* error condition, always reported */
+
+/* Flags */
+#define EPOLLONESHOT	(1U << 30)	/* disable the item after one event */
+#define EPOLLET		(1U << 31)	/* edge triggered */
+
+/* Operations for epoll_ctl() */
+#define EPOLL_CTL_ADD	1		/* register a file descriptor */
+#define EPOLL_CTL_DEL	2		/* deregister a file descriptor */
+#define EPOLL_CTL_MOD	3		/* change the registered events */
+#define EPOLL_CTL_CLOSE	4		/* release the handle (epoll_close) */
+
+typedef union epoll_data {
+	void *ptr;
+	int fd;
+	__u32 u32;
+	__u64 u64;
+} epoll_data_t;
+
+struct epoll_event {
+	__u32 events;			/* EPOLL* events and flags */
+	epoll_data_t data;		/* returned with the event */
+};
+
+#if defined(__KERNEL__) || defined(__UKERNEL__)
+
+int epoll_create(int size);
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+int epoll_close(int epfd);
+#endif
+
+#endif /* _NUCLEOS_EPOLL_H */
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#ifndef _NUCLEOS_IPCTRACE_H
+#define _NUCLEOS_IPCTRACE_H
+
+/*
+ * Types relating to IPC tracing. The kernel keeps a struct ipct_stats for
+ * every process slot (GET_IPCSTATS) and optionally a ring of raw IPC
+ * events (GET_IPCTRACE).
+ */
+#include <nucleos/types.h>
+#include <nucleos/kipc.h>
+
+#ifdef CONFIG_DEBUG_KERNEL_IPC_TRACE
+
+#define IPCT_DST_SLOTS		8	/* (dst, m_type) pairs per process */
+#define IPCT_HIST_BUCKETS	16	/* blocking time histogram buckets */
+#define IPCT_HIST_SHIFT		8	/* bucket 0 holds < 2^9 cycles */
+
+#define IPCT_RING_SIZE		CONFIG_DEBUG_KERNEL_IPC_TRACE_RING
+
+/* Message counter for one (dst, m_type) pair of a sender. */
+struct ipct_dst {
+  endpoint_t dst;			/* destination endpoint */
+  int m_type;				/* message type */
+  unsigned long count;			/* nr of messages delivered */
+};
+
+/* Per process IPC statistics, indexed like the process table. */
+struct ipct_stats {
+  unsigned long calls[KIPC_SERVICES_COUNT + 1];	/* kipc calls by type */
+  unsigned long delivered;		/* messages delivered from this proc */
+  unsigned long other;			/* deliveries not fitting into dst[] */
+  struct ipct_dst dst[IPCT_DST_SLOTS];	/* most frequent destinations */
+  unsigned long blocked;		/* times queued in a p_caller_q */
+  unsigned long block_hist[IPCT_HIST_BUCKETS];	/* log2 cycles queued */
+  u64_t block_start;			/* tsc when queued, 0 if not */
+};
+
+/* Raw IPC events. */
+#define IPCT_EV_DELIVER		1	/* message copied to destination */
+#define IPCT_EV_BLOCK		2	/* sender queued at destination */
+#define IPCT_EV_DEADLOCK	3	/* deadlock detected */
+
+struct ipct_event {
+  u32_t seq;				/* event sequence number */
+  u32_t tsc;				/* low 32 bits of tsc */
+  u8_t event;				/* IPCT_EV_* */
+  u8_t call;				/* kipc call being executed */
+  endpoint_t src;			/* source endpoint */
+  endpoint_t dst;			/* destination endpoint */
+  int m_type;				/* message type if delivered */
+};
+
+/* What GET_IPCTRACE returns. */
+struct ipct_trace {
+  unsigned long deadlock_checks;	/* nr of deadlock() runs */
+  unsigned long deadlocks;		/* nr of deadlocks found */
+  u32_t seq;				/* last event sequence number */
+#if IPCT_RING_SIZE > 0
+  struct ipct_event ring[IPCT_RING_SIZE];	/* slot is seq % size */
+#endif
+};
+
+#endif /* CONFIG_DEBUG_KERNEL_IPC_TRACE */
+
+#endif /* _NUCLEOS_IPCTRACE_H */
@@ -15,6 +15,8 @@
  * statistical profiling and call profiling.
  */
 
+#include <nucleos/types.h>
+
 #ifdef CONFIG_DEBUG_KERNEL_STATS_PROFILE
 
 #define PROF_START       0    /* start statistical profiling */
@@ -27,19 +29,38 @@ struct sprof_info_s {
   int idle_samples;
   int system_samples;
   int user_samples;
+  int nr_slots;			/* nr of slots in the sample ring */
 } sprof_info_inst;
 
-/* What a profiling sample looks like (used for sizeof()). */
-struct {
-  char name[8];
-  int pc;
+#define SPROF_PROCNAME_LEN	8	/* len of proc name field */
+#define SPROF_STACK_DEPTH	8	/* max. nr of return addresses */
+
+/* Sample flags. */
+#define SPROF_IDLE		0x1	/* idle process was interrupted */
+#define SPROF_SYSTEM		0x2	/* system process (server/driver) */
+#define SPROF_KERNEL		0x4	/* kernel task */
+#define SPROF_STACK_TRUNC	0x8	/* call stack did not fit */
+
+/* The profiling memory of the collecting process is used as a ring of
+ * samples. The kernel writes each sample into slot (seq - 1) % nr_slots
+ * with a single copy and never waits for the collector, so profiling can
+ * run for an unlimited time. The collector keeps the sequence number it
+ * expects next: a slot holding a smaller number has not been written yet,
+ * a larger number means the kernel lapped the collector and samples were
+ * lost. Sequence number 0 is never used so zeroed memory reads as empty.
+ */
+struct sprof_sample_s {
+  u32_t seq;				/* sample sequence number */
+  endpoint_t endpt;			/* endpoint of sampled process */
+  char name[SPROF_PROCNAME_LEN];	/* process name */
+  u32_t pc;				/* program counter */
+  u16_t flags;				/* SPROF_* flags */
+  u16_t depth;				/* nr of valid entries in stack */
+  u32_t stack[SPROF_STACK_DEPTH];	/* return addresses, innermost first */
 } sprof_sample;
 
 #endif /* CONFIG_DEBUG_KERNEL_STATS_PROFILE */
 
-
-#include <nucleos/types.h>
-
 #  define PROF_GET         2    /* get call profiling tables */
 #  define PROF_RESET       3    /* reset call profiling tables */
 
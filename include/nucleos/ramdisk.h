@@ -0,0 +1,21 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#ifndef _NUCLEOS_RAMDISK_H
+#define _NUCLEOS_RAMDISK_H
+
+#include <nucleos/types.h>
+
+/* Where MIOCRAMMAP mapped a RAM disk into the caller's address space. */
+struct rammap {
+	vir_bytes rm_base;		/* start of the mapping */
+	size_t rm_size;			/* size of the RAM disk */
+};
+
+#endif /* _NUCLEOS_RAMDISK_H */
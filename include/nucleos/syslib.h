@@ -110,6 +110,7 @@ int sys_vtimer(endpoint_t proc_nr, int which, clock_t *newval, clock_t *oldval);
     sys_irqctl(IRQ_RMPOLICY, 0, 0, hook_id)
 
 int sys_irqctl(int request, int irq_vec, int policy, int *irq_hook_id);
+int sys_irqcoalesce(int *irq_hook_id, clock_t ticks);
 
 /* Shorthands for sys_vircopy() and sys_physcopy() system calls. */
 #define sys_biosin(bios_vir, dst_vir, bytes) \
@@ -152,6 +153,8 @@ int sys_physvcopy(phys_cp_req *vec_ptr,int vec_size,int *nr_ok);
 
 int sys_umap(endpoint_t proc_ep, int seg, vir_bytes vir_addr, vir_bytes bytes,
 	     phys_bytes *phys_addr);
+int sys_umap_grant(endpoint_t proc_ep, cp_grant_id_t grant, vir_bytes offset,
+		   vir_bytes bytes, phys_bytes *phys_addr);
 int sys_umap_data_fb(endpoint_t proc_ep, vir_bytes vir_addr, vir_bytes bytes,
 		     phys_bytes *phys_addr);
 int sys_segctl(int *index, u16_t *seg, vir_bytes *off, phys_bytes phys, vir_bytes size);
@@ -176,6 +179,8 @@ int sys_segctl(int *index, u16_t *seg, vir_bytes *off, phys_bytes phys, vir_byte
 #define sys_getidletsc(dst)	sys_getinfo(GET_IDLETSC, dst, 0,0,0)
 #define sys_getaoutheader(dst,nr) sys_getinfo(GET_AOUTHEADER, dst, 0,0,nr)
 #define sys_getbootparam(dst)	sys_getinfo(GET_BOOTPARAM, dst, 0,0,0)
+#define sys_getipcstats(dst)	sys_getinfo(GET_IPCSTATS, dst, 0,0,0)
+#define sys_getipctrace(dst)	sys_getinfo(GET_IPCTRACE, dst, 0,0,0)
 
 int sys_getinfo(int request, void *val_ptr, int val_len, void *val_ptr2, int val_len2);
 
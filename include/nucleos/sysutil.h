@@ -67,6 +67,8 @@ void util_nstrcat(char *str, unsigned long n);
 void util_stacktrace_strcat(char *);
 int micro_delay(u32_t micros);
 u32_t micros_to_ticks(u32_t micros);
+u32_t micros_to_tsc(u32_t micros);
+u32_t tsc_to_micros(u32_t tsc);
 void ser_putc(char c);
 void get_randomness(struct k_randomness *, int);
 
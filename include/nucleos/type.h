@@ -61,6 +61,19 @@ typedef struct {
 	vir_bytes iov_size;		/* sizeof an I/O buffer */
 } iovec_s_t;
 
+/* Receive buffer lent to an ethernet driver (DL_READV_Z) */
+typedef struct {
+	int rxb_id;			/* buffer number of the client */
+	int rxb_grant;			/* grant that covers the buffer */
+	vir_bytes rxb_offset;		/* offset of the buffer in the grant */
+} rxbuf_s_t;
+
+/* Packet an ethernet driver received into a client buffer (DL_READV_Z) */
+typedef struct {
+	int rxp_id;			/* buffer number of the client */
+	int rxp_len;			/* length of the packet */
+} rxpkt_s_t;
+
 /* PM passes the address of a structure of this type to KERNEL when
  * sys_sigsend() is invoked as part of the signal catching mechanism.
  * The structure contain all the information that KERNEL needs to build
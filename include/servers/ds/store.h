@@ -19,6 +19,8 @@
 
 /* Constants for the Data Store Server. */
 #define NR_DS_KEYS               64	/* reserve space for so many items */
+#define NR_DS_CHUNKS             16	/* grow by NR_DS_KEYS up to so many times */
+#define NR_DS_HASH              256	/* key hash chains, power of 2 */
 #define NR_DS_SUBS   (4*NR_SYS_PROCS)	/* .. and so many subscriptions */
 
 /* Types. */
@@ -33,12 +35,31 @@ struct data_store {
 
   /* out of date subscribers. */
   bitchunk_t ds_old_subs[BITMAP_CHUNKS(NR_DS_SUBS)];	
+
+  struct data_store *ds_hnext;	/* next item in the key hash chain */
 };
 
+/* How a subscription matches keys. The literal part of the pattern (up to
+ * the first regex operator) places the subscription in a prefix trie, so
+ * only subscriptions along the path of a key are ever considered.
+ */
+#define DS_SUB_EXACT	1	/* pattern is literal, key must be equal */
+#define DS_SUB_PREFIX	2	/* pattern is "literal.*" */
+#define DS_SUB_REGEX	3	/* anything else, regexec() decides */
+
 struct subscription {
   int sub_flags;		/* flags for this subscription */
   regex_t sub_regex;		/* regular expression agains keys */
   endpoint_t sub_owner;		/* who is subscribed */
+  int sub_match;		/* DS_SUB_* */
+  int sub_next;			/* next subscription in the same trie node */
+};
+
+struct sub_node {
+  char sn_char;			/* next character of the literal prefix */
+  struct sub_node *sn_child;	/* first longer prefix */
+  struct sub_node *sn_sibling;	/* next prefix of the same length */
+  int sn_subs;			/* first subscription here, -1 if none */
 };
 
 #endif /* __SERVERS_DS_STORE_H */
@@ -0,0 +1,23 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#ifndef __SERVERS_FS_PIPE_H
+#define __SERVERS_FS_PIPE_H
+
+#include <asm/page_types.h>
+
+/* Capacity of a pipe. PIPE_BUF (limits.h) is only the size up to which
+ * writes are atomic. The data is kept in a ring in pipefs: VFS hands out
+ * read and write positions, the byte at position p is stored at offset
+ * p % PIPE_SIZE. The write position is never more than PIPE_SIZE ahead of
+ * the read position, and VFS keeps both below 2 * PIPE_SIZE.
+ */
+#define PIPE_SIZE	(CONFIG_VFS_PIPE_PAGES << PAGE_SHIFT)
+
+#endif /* __SERVERS_FS_PIPE_H */
@@ -15,6 +15,8 @@
 #define NR_LOCKS           8	/* # slots in the file locking table */
 #define NR_MNTS             8	/* # slots in mount table */
 #define NR_VNODES         512	/* # slots in vnode table */
+#define NR_EPOLLS          16	/* # slots in epoll instance table */
+#define NR_EPITEMS        512	/* # epoll items (watched fds) */
 
 /* Miscellaneous constants */
 #define SU_UID 	 ((uid_t) 0)	/* super_user's uid_t */
@@ -30,6 +32,7 @@
 #define FP_BLOCKED_ON_DOPEN	5 /* susp'd on device open */
 #define FP_BLOCKED_ON_OTHER	6 /* blocked on other process, check 
 				     fp_task to find out */
+#define FP_BLOCKED_ON_EPOLL	7 /* susp'd on epoll_wait */
 
 /* test if the process is blocked on something */
 #define fp_is_blocked(fp)	((fp)->fp_blocked_on != FP_BLOCKED_ON_NONE)
@@ -26,6 +26,7 @@
 #define RS_CRASHED      0x040    /* service crashed */
 #define RS_LATEREPLY	0x080	/* no reply sent to RS_DOWN caller yet */
 #define RS_SIGNALED     0x100    /* service crashed */
+#define RS_WAITING	0x200	/* not started until its dependencies run */
 
 /* Sys flag values. */
 #define SF_CORE_PROC	0x001	/* set for core system processes
@@ -36,11 +37,14 @@
 				 */
 #define SF_NEED_COPY	0x004	/* set when process needs copy to restart */
 #define SF_USE_COPY	0x008	/* set when process has a copy in memory */
+#define SF_STANDBY	0x010	/* keep a hot standby to replace the process */
 
 /* Constants determining RS period and binary exponential backoff. */
 #define RS_DELTA_T	60			/* check every T ticks */
+#define RS_STANDBY_DELTA_T (RS_DELTA_T/4)	/* when standbys are kept */
 #define BACKOFF_BITS	(sizeof(long)*8)	/* bits in backoff field */
 #define MAX_BACKOFF	30			/* max backoff in RS_DELTA_T */
+#define RS_WAIT_T	(30*RS_DELTA_T)		/* max wait for dependencies */
 
 /* Magic process table addresses. */
 #define BEG_RPROC_ADDR	(&rproc[0])
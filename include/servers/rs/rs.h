@@ -22,6 +22,7 @@
 #define RSS_NR_PCI_CLASS	 4
 #define RSS_NR_SYSTEM		 2
 #define RSS_NR_CONTROL		 8
+#define RSS_NR_DEPEND		 8
 
 /* Labels are copied over separately. */
 struct rss_label
@@ -58,6 +59,8 @@ struct rs_start
 	bitchunk_t rss_vm[RSS_VM_CALL_SIZE];
 	int rss_nr_control;
 	struct rss_label rss_control[RSS_NR_CONTROL];
+	int rss_nr_depend;
+	struct rss_label rss_depend[RSS_NR_DEPEND];
 };
 
 int minix_rs_lookup(const char *name, endpoint_t *value);
@@ -67,6 +70,7 @@ int minix_rs_lookup(const char *name, endpoint_t *value);
 				 */
 #define RF_IPC_VALID	0x02	/* rss_ipc and rss_ipclen are valid */
 #define RF_REUSE	0x04	/* Try to reuse previously copied binary */
+#define RF_STANDBY	0x08	/* Keep a hot standby, requires RF_COPY */
 
 #define RSP_LABEL_SIZE	16
 #define RSP_NR_DEVICE	32
@@ -78,6 +78,12 @@ struct rproc {
 	bitchunk_t r_vm[RSS_VM_CALL_SIZE];
 	int r_nr_control;
 	char r_control[RSS_NR_CONTROL][MAX_LABEL_LEN];
+	int r_nr_depend;		/* services that must run first */
+	char r_depend[RSS_NR_DEPEND][MAX_LABEL_LEN];
+	clock_t r_up_tm;		/* timestamp of the RS_UP request */
+
+	endpoint_t r_spare_e;		/* endpoint of the hot standby */
+	pid_t r_spare_pid;		/* its pid, -1 if there is no standby */
 };
 
 #endif /* __SERVERS_RS_TYPE_H */
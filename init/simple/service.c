@@ -114,7 +114,7 @@ static void print_usage(char *app_name, char *problem)
   fprintf(stderr, "Warning, %s\n", problem);
   fprintf(stderr, "Usage:\n");
   fprintf(stderr,
-  "    %s [-c] (up|run) <binary> [%s <args>] [%s <special>] [%s <ticks>]\n", 
+  "    %s [-c] [-s] (up|run) <binary> [%s <args>] [%s <special>] [%s <ticks>]\n", 
 	app_name, ARG_ARGS, ARG_DEV, ARG_PERIOD);
   fprintf(stderr, "    %s down label\n", app_name);
   fprintf(stderr, "    %s refresh label\n", app_name);
@@ -142,11 +142,12 @@ static int parse_arguments(int argc, char **argv)
   char *hz;
   int req_nr;
   int c, i;
-  int c_flag, r_flag;
+  int c_flag, r_flag, s_flag;
 
   c_flag = 0;
   r_flag = 0;
-  while (c= getopt(argc, argv, "rci?"), c != -1)
+  s_flag = 0;
+  while (c= getopt(argc, argv, "rcsi?"), c != -1)
   {
 	switch(c)
 	{
@@ -160,6 +161,10 @@ static int parse_arguments(int argc, char **argv)
 	        c_flag = 1; /* -r implies -c */
 		r_flag = 1;
 		break;
+	case 's':
+		c_flag = 1; /* -s implies -c */
+		s_flag = 1;
+		break;
 	case 'i':
 		/* Legacy - remove later */
 		fputs("WARNING: obsolete -i flag passed to service(8)\n",
@@ -204,6 +209,9 @@ static int parse_arguments(int argc, char **argv)
 
       if(r_flag)
         rs_start.rss_flags |= RF_REUSE;
+
+      if (s_flag)
+	rs_start.rss_flags |= RF_STANDBY;
         
       if (do_run)
       {
@@ -332,6 +340,7 @@ static void fatal(char *fmt, ...)
 #define KW_IPC		"ipc"
 #define KW_VM		"vm"
 #define KW_CONTROL	"control"
+#define KW_DEPENDS	"depends"
 
 static void do_module(config_t *cpe, config_t *config);
 
@@ -882,6 +891,36 @@ static void do_control(config_t *cpe)
 	}
 }
 
+static void do_depends(config_t *cpe)
+{
+	int nr_depend = 0;
+
+	/* Process a list of labels of services that must run first. */
+	for (; cpe; cpe= cpe->next)
+	{
+		if (cpe->flags & CFG_SUBLIST)
+		{
+			fatal("do_depends: unexpected sublist at %s:%d",
+				cpe->file, cpe->line);
+		}
+		if (cpe->flags & CFG_STRING)
+		{
+			fatal("do_depends: unexpected string at %s:%d",
+				cpe->file, cpe->line);
+		}
+		if (nr_depend >= RSS_NR_DEPEND)
+		{
+			fatal(
+			"do_depends: RSS_NR_DEPEND is too small (%d needed)",
+				nr_depend+1);
+		}
+
+		rs_start.rss_depend[nr_depend].l_addr = (char *) cpe->word;
+		rs_start.rss_depend[nr_depend].l_len = strlen(cpe->word);
+		rs_start.rss_nr_depend = ++nr_depend;
+	}
+}
+
 static void do_module(config_t *cpe, config_t *config)
 {
 	config_t *cp;
@@ -967,6 +1006,11 @@ static void do_module(config_t *cpe, config_t *config)
 			do_control(cpe->next);
 			continue;
 		}
+		if (strcmp(cpe->word, KW_DEPENDS) == 0)
+		{
+			do_depends(cpe->next);
+			continue;
+		}
 	}
 }
 
@@ -69,8 +69,7 @@ static void init_clock(void)
 static void load_update(void)
 {
 	u16_t slot;
-	int enqueued = 0, q;
-	struct proc *p;
+	int enqueued = 0, cpu;
 
 	/* Load average data is stored as a list of numbers in a circular
 	 * buffer. Each slot accumulates _LOAD_UNIT_SECS of samples of
@@ -85,9 +84,8 @@ static void load_update(void)
 	}
 
 	/* Cumulation. How many processes are ready now? */
-	for(q = 0; q < NR_SCHED_QUEUES; q++)
-		for(p = rdy_head[q]; p != NIL_PROC; p = p->p_nextready)
-			enqueued++;
+	for(cpu = 0; cpu < CONFIG_MAX_CPUS; cpu++)
+		enqueued += cpu_rq(cpu)->nr_ready;
 
 	kloadinfo.proc_load_history[slot] += enqueued;
 
@@ -153,6 +151,11 @@ int bsp_timer_int_handler(void)
 
 	ap_timer_int_handler();
 
+#if USE_IRQCTL
+	/* send interrupt notifications held back by coalescing */
+	irq_coalesce_expire(realtime);
+#endif
+
 	/* if a timer expired, notify the clock task */
 	if ((next_timeout <= realtime)) {
 		mini_notify(proc_addr(HARDWARE), CLOCK); /* send notification */
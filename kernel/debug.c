@@ -25,7 +25,7 @@
 void
 check_runqueues_f(char *file, int line)
 {
-  int q, l = 0;
+  int q, cpu, l = 0;
   register struct proc *xp;
 
   if(!intr_disabled()) {
@@ -44,20 +44,27 @@ check_runqueues_f(char *file, int line)
 	if (l++ > MAX_LOOP) {  MYPANIC("check error"); }
   }
 
-  for (q=l=0; q < NR_SCHED_QUEUES; q++) {
-    if (rdy_head[q] && !rdy_tail[q]) {
+  for (cpu=l=0; cpu < CONFIG_MAX_CPUS; cpu++) {
+   struct runqueue *rq = cpu_rq(cpu);
+
+   for (q=0; q < NR_SCHED_QUEUES; q++) {
+    if (!rq->rdy_head[q] != !(rq->rdy_map & (1 << q))) {
+	printk("map bit wrong for %d on cpu %d\n", q, cpu);
+		 MYPANIC("scheduling error");
+    }
+    if (rq->rdy_head[q] && !rq->rdy_tail[q]) {
 	printk("head but no tail in %d\n", q);
 		 MYPANIC("scheduling error");
     }
-    if (!rdy_head[q] && rdy_tail[q]) {
+    if (!rq->rdy_head[q] && rq->rdy_tail[q]) {
 	printk("tail but no head in %d\n", q);
 		 MYPANIC("scheduling error");
     }
-    if (rdy_tail[q] && rdy_tail[q]->p_nextready != NIL_PROC) {
+    if (rq->rdy_tail[q] && rq->rdy_tail[q]->p_nextready != NIL_PROC) {
 	printk("tail and tail->next not null in %d\n", q);
 		 MYPANIC("scheduling error");
     }
-    for(xp = rdy_head[q]; xp != NIL_PROC; xp = xp->p_nextready) {
+    for(xp = rq->rdy_head[q]; xp != NIL_PROC; xp = xp->p_nextready) {
 	vir_bytes vxp = (vir_bytes) xp, dxp;
 	if(vxp < (vir_bytes) BEG_PROC_ADDR || vxp >= (vir_bytes) END_PROC_ADDR) {
   		MYPANIC("xp out of range");
@@ -84,20 +91,26 @@ check_runqueues_f(char *file, int line)
 			q, xp->p_nr, xp->p_endpoint, xp->p_name);
 		MYPANIC("wrong priority");
 	}
+	if (xp->p_cpu != cpu) {
+		printk("scheduling error: proc %d on cpu %d queue, p_cpu %d\n",
+			xp->p_nr, cpu, xp->p_cpu);
+		MYPANIC("proc on wrong cpu queue");
+	}
 	if (xp->p_found) {
 		printk("scheduling error: double sched q %d proc %d\n",
 			q, xp->p_nr);
 		MYPANIC("proc more than once on scheduling queue");
 	}
 	xp->p_found = 1;
-	if (xp->p_nextready == NIL_PROC && rdy_tail[q] != xp) {
+	if (xp->p_nextready == NIL_PROC && rq->rdy_tail[q] != xp) {
 		printk("sched err: last element not tail q %d proc %d\n",
 			q, xp->p_nr);
 		MYPANIC("scheduling error");
 	}
 	if (l++ > MAX_LOOP) MYPANIC("loop in schedule queue?");
     }
-  }	
+   }
+  }
 
   l = 0;
   for (xp = BEG_PROC_ADDR; xp < END_PROC_ADDR; ++xp) {
@@ -86,6 +86,9 @@ void rm_irq_handler( irq_hook_t* hook ) {
 	irq_actids[hook->irq] |= hook->id;
 	hw_intr_mask(hook->irq);
 
+	/* drop a notification held back by coalescing */
+	hook->deferred = 0;
+
 	/* remove the hook.  */
 	line = &irq_handlers[irq];
 
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+/*
+ * This file contains the IPC trace facility. The hooks are called from
+ * kipc_call() and the message passing primitives in proc.c and collect
+ *   - the number of kipc calls of each type per process,
+ *   - per (src, dst, m_type) message counts, kept at the sender,
+ *   - a log2 histogram of the time senders spend in a p_caller_q,
+ *   - the number of deadlock() runs and detected deadlocks,
+ *   - optionally a ring of raw events, overwritten when it wraps.
+ * Everything is readable through sys_getinfo(GET_IPCSTATS/GET_IPCTRACE).
+ */
+#include <nucleos/string.h>
+#include <nucleos/u64.h>
+#include <nucleos/endpoint.h>
+#include <kernel/kernel.h>
+#include <kernel/proc.h>
+#include <kernel/ipctrace.h>
+
+struct ipct_stats ipct_stats[NR_TASKS + NR_PROCS];
+struct ipct_trace ipct_trace;
+
+/* Kipc call currently being executed, zero for deliveries made outside
+ * of a kipc call (e.g. notifications from interrupt handlers).
+ */
+static u8_t ipct_cur_call;
+
+#define ipct_of(rp)	(&ipct_stats[proc_nr(rp) + NR_TASKS])
+
+static void ipct_event(int event, endpoint_t src, endpoint_t dst, int m_type)
+{
+#if IPCT_RING_SIZE > 0
+	struct ipct_event *ev;
+	u32_t hi;
+
+	ev = &ipct_trace.ring[++ipct_trace.seq % IPCT_RING_SIZE];
+	ev->seq = ipct_trace.seq;
+	read_tsc(&hi, &ev->tsc);
+	ev->event = event;
+	ev->call = ipct_cur_call;
+	ev->src = src;
+	ev->dst = dst;
+	ev->m_type = m_type;
+#endif
+}
+
+void ipct_call(struct proc *caller, int call_type)
+{
+	ipct_of(caller)->calls[call_type]++;
+	ipct_cur_call = call_type;
+}
+
+void ipct_call_end(void)
+{
+	ipct_cur_call = 0;
+}
+
+void ipct_deliver(endpoint_t src_e, struct proc *dst)
+{
+	struct ipct_stats *st;
+	struct ipct_dst *d, *free_d = NULL;
+	int m_type = dst->p_delivermsg.m_type;
+
+	st = &ipct_stats[_ENDPOINT_P(src_e) + NR_TASKS];
+	st->delivered++;
+
+	ipct_event(IPCT_EV_DELIVER, src_e, dst->p_endpoint, m_type);
+
+	for (d = &st->dst[0]; d < &st->dst[IPCT_DST_SLOTS]; d++) {
+		if (!d->count) {
+			if (!free_d)
+				free_d = d;
+			continue;
+		}
+
+		if (d->dst == dst->p_endpoint && d->m_type == m_type) {
+			d->count++;
+			return;
+		}
+	}
+
+	if (!free_d) {
+		st->other++;
+		return;
+	}
+
+	free_d->dst = dst->p_endpoint;
+	free_d->m_type = m_type;
+	free_d->count = 1;
+}
+
+void ipct_block(struct proc *caller, endpoint_t dst_e)
+{
+	struct ipct_stats *st = ipct_of(caller);
+
+	st->blocked++;
+	read_tsc_64(&st->block_start);
+
+	ipct_event(IPCT_EV_BLOCK, caller->p_endpoint, dst_e, 0);
+}
+
+void ipct_unblock(struct proc *sender)
+{
+	struct ipct_stats *st = ipct_of(sender);
+	u64_t now, delta;
+	unsigned long v;
+	int bucket;
+
+	if (!cmp64ul(st->block_start, 0))
+		return;
+
+	read_tsc_64(&now);
+	delta = sub64(now, st->block_start);
+	st->block_start = cvu64(0);
+
+	/* bucket = log2(delta) - IPCT_HIST_SHIFT */
+	if ((v = ex64hi(delta)) != 0) {
+		bucket = 32;
+	} else {
+		v = ex64lo(delta);
+		bucket = 0;
+	}
+
+	while (v >>= 1)
+		bucket++;
+
+	bucket -= IPCT_HIST_SHIFT;
+
+	if (bucket < 0)
+		bucket = 0;
+	else if (bucket >= IPCT_HIST_BUCKETS)
+		bucket = IPCT_HIST_BUCKETS - 1;
+
+	st->block_hist[bucket]++;
+}
+
+void ipct_deadlock(struct proc *caller, int found)
+{
+	ipct_trace.deadlock_checks++;
+
+	if (found) {
+		ipct_trace.deadlocks++;
+		ipct_event(IPCT_EV_DEADLOCK, caller->p_endpoint,
+			   ENDPT_NONE, 0);
+	}
+}
+
+void ipct_clear(struct proc *rp)
+{
+	memset(ipct_of(rp), 0, sizeof(struct ipct_stats));
+}
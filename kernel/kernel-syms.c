@@ -155,8 +155,7 @@ u64_t idle_tsc;
  * with sizeof(struct proc) to determine the address.
  */
 struct proc proc[NR_TASKS + NR_PROCS];	/* process table */
-struct proc *rdy_head[NR_SCHED_QUEUES];	/* ptrs to ready list headers */
-struct proc *rdy_tail[NR_SCHED_QUEUES];	/* ptrs to ready list tails */
+struct runqueue runqueue[CONFIG_MAX_CPUS];	/* run queues of each cpu */
 
 /* The system structures table and pointers to individual table slots. The
  * pointers allow faster access because now a process entry can be found by
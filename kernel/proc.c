@@ -52,6 +52,8 @@
 #include <kernel/kernel.h>
 #include <kernel/proc.h>
 #include <kernel/vm.h>
+#include <kernel/ipctrace.h>
+#include <asm/bitops.h>
 
 /* Scheduling and message passing functions. The functions are available to 
  * other parts of the kernel through lock_...(). The lock temporarily disables 
@@ -109,6 +111,8 @@ static int QueueMess(endpoint_t ep, vir_bytes msg_lin, struct proc *dst)
 	dst->p_delivermsg.m_source = ep;
 	dst->p_misc_flags |= MF_DELIVERMSG;
 
+	ipct_deliver(ep, dst);
+
 	return 0;
 }
 
@@ -376,7 +380,9 @@ static int mini_send(struct proc *caller_ptr, int dst_e, kipc_msg_t *m_ptr, u32
 			return(-ENOTREADY);
 
 		/* Check for a possible deadlock before actually blocking. */
-		if (deadlock(KIPC_SEND, caller_ptr, dst_p))
+		r = deadlock(KIPC_SEND, caller_ptr, dst_p);
+		ipct_deadlock(caller_ptr, r);
+		if (r)
 			return(-ELOCKED);
 
 
@@ -400,6 +406,8 @@ static int mini_send(struct proc *caller_ptr, int dst_e, kipc_msg_t *m_ptr, u32
 
 		*xpp = caller_ptr;			/* add caller to end */
 		caller_ptr->p_q_link = NIL_PROC;	/* mark new end of list */
+
+		ipct_block(caller_ptr, dst_e);
 	}
 
 	return 0;
@@ -526,6 +534,8 @@ static int mini_receive(struct proc *caller_ptr, int src_e, kipc_msg_t *m_ptr, u
 
 				RTS_UNSET(*xpp, RTS_SENDING);
 
+				ipct_unblock(*xpp);
+
 				*xpp = (*xpp)->p_q_link;	/* remove from queue */
 
 				return(0);			/* report success */
@@ -551,7 +561,9 @@ static int mini_receive(struct proc *caller_ptr, int src_e, kipc_msg_t *m_ptr, u
 	 */
 	if (!(flags & KIPC_FLG_NONBLOCK)) {
 		/* Check for a possible deadlock before actually blocking. */
-		if (deadlock(KIPC_RECEIVE, caller_ptr, src_p))
+		r = deadlock(KIPC_RECEIVE, caller_ptr, src_p);
+		ipct_deadlock(caller_ptr, r);
+		if (r)
 			return(-ELOCKED);
 
 		caller_ptr->p_getfrom_e = src_e;
@@ -975,6 +987,87 @@ int lock_notify(int src_e, int dst_e)
 	return(result);
 }
 
+/* Link 'rp' into queue 'q' of 'rq', at the front or the back. */
+static void rq_insert(struct runqueue *rq, struct proc *rp, int q, int front)
+{
+	if (rq->rdy_head[q] == NIL_PROC) {	/* add to empty queue */
+		rq->rdy_head[q] = rq->rdy_tail[q] = rp;	/* create a new queue */
+		rp->p_nextready = NIL_PROC;	/* mark new end */
+		rq->rdy_map |= 1 << q;
+	} else if (front) {			/* add to head of queue */
+		rp->p_nextready = rq->rdy_head[q];	/* chain head of queue */
+		rq->rdy_head[q] = rp;		/* set new queue head */
+	} else {				/* add to tail of queue */
+		rq->rdy_tail[q]->p_nextready = rp;	/* chain tail of queue */
+		rq->rdy_tail[q] = rp;		/* set new queue tail */
+		rp->p_nextready = NIL_PROC;	/* mark new end */
+	}
+
+	rq->nr_ready++;
+}
+
+/* Unlink 'rp' from queue 'q' of 'rq'. Returns 0 if it was not there. */
+static int rq_remove(struct runqueue *rq, struct proc *rp, int q)
+{
+	register struct proc **xpp;		/* iterate over queue */
+	register struct proc *prev_xp;
+
+	prev_xp = NIL_PROC;
+
+	for (xpp = &rq->rdy_head[q]; *xpp != NIL_PROC; xpp = &(*xpp)->p_nextready) {
+		if (*xpp == rp) {			/* found process to remove */
+			*xpp = (*xpp)->p_nextready;	/* replace with next chain */
+
+			if (rp == rq->rdy_tail[q])	/* queue tail removed */
+				rq->rdy_tail[q] = prev_xp;	/* set new tail */
+
+			if (rq->rdy_head[q] == NIL_PROC)
+				rq->rdy_map &= ~(1 << q);
+
+			rq->nr_ready--;
+			return 1;
+		}
+		prev_xp = *xpp;				/* save previous in chain */
+	}
+
+	return 0;
+}
+
+/* Number of the aging period, advanced by balance_queues(). */
+static unsigned sched_period;
+
+/**
+ * Apply the aging periods a process missed
+ * @param rp  process to age
+ *
+ * In each period a process below its maximum priority is raised by one
+ * queue, a process at its maximum priority gets a new quantum. Blocked
+ * processes are not visited by balance_queues(), they catch up here when
+ * they become ready again.
+ */
+static void age_proc(struct proc *rp)
+{
+	unsigned periods = sched_period - rp->p_sched_period;
+	unsigned raise;
+
+	if (!periods)
+		return;
+
+	rp->p_sched_period = sched_period;
+
+	raise = rp->p_priority - rp->p_max_priority;
+	if (rp->p_priority < rp->p_max_priority)
+		raise = 0;
+
+	if (periods <= raise) {
+		rp->p_priority -= periods;
+		return;
+	}
+
+	rp->p_priority -= raise;
+	rp->p_ticks_left = rp->p_quantum_size;
+}
+
 /**
  * Add to one of the queues of runnable processes
  * @param rp  this process is now runnable
@@ -984,7 +1077,8 @@ void enqueue(struct proc *rp)
 	/* Add 'rp' to one of the queues of runnable processes.  This function is 
 	 * responsible for inserting a process into one of the scheduling queues. 
 	 * The mechanism is implemented here.   The actual scheduling policy is
-	 * defined in sched() and pick_proc().
+	 * defined in sched() and pick_proc(). The process goes to the run queue
+	 * of the cpu it ran on last.
 	 */
 	int q;		/* scheduling queue to use */
 	int front;	/* add to front or back */
@@ -999,22 +1093,13 @@ void enqueue(struct proc *rp)
 #endif
 
 	/* Determine where to insert to process. */
+	age_proc(rp);
 	sched(rp, &q, &front);
 
 	vmassert(q >= 0);
 
 	/* Now add the process to the queue. */
-	if (rdy_head[q] == NIL_PROC) {		/* add to empty queue */
-		rdy_head[q] = rdy_tail[q] = rp;	/* create a new queue */
-		rp->p_nextready = NIL_PROC;	/* mark new end */
-	} else if (front) {			/* add to head of queue */
-		rp->p_nextready = rdy_head[q];	/* chain head of queue */
-		rdy_head[q] = rp;		/* set new queue head */
-	} else {				/* add to tail of queue */
-		rdy_tail[q]->p_nextready = rp;	/* chain tail of queue */
-		rdy_tail[q] = rp;		/* set new queue tail */
-		rp->p_nextready = NIL_PROC;	/* mark new end */
-	}
+	rq_insert(cpu_rq(rp->p_cpu), rp, q, front);
 
 #ifdef CONFIG_DEBUG_KERNEL_SCHED_CHECK
 	rp->p_ready = 1;
@@ -1028,7 +1113,8 @@ void enqueue(struct proc *rp)
 	 */
 	vmassert(proc_ptr);
 
-	if ((proc_ptr->p_priority > rp->p_priority) && (priv(proc_ptr)->s_flags & PREEMPTIBLE))
+	if (rp->p_cpu == this_cpu() && (proc_ptr->p_priority > rp->p_priority) &&
+	    (priv(proc_ptr)->s_flags & PREEMPTIBLE))
 		RTS_SET(proc_ptr, RTS_PREEMPTED);	/* calls dequeue() */
 
 #ifdef CONFIG_DEBUG_KERNEL_SCHED_CHECK
@@ -1062,18 +1148,12 @@ static void enqueue_head(struct proc *rp)
 	 */
 	vmassert(rp->p_ticks_left);
 
-	vmassert(q >= 0);
-
 	q = rp->p_priority;
 
-	/* Now add the process to the queue. */
-	if (rdy_head[q] == NIL_PROC) {		/* add to empty queue */
-		rdy_head[q] = rdy_tail[q] = rp;	/* create a new queue */
-		rp->p_nextready = NIL_PROC;	/* mark new end */
-	} else					/* add to head of queue */
-		rp->p_nextready = rdy_head[q];	/* chain head of queue */
+	vmassert(q >= 0);
 
-	rdy_head[q] = rp;			/* set new queue head */
+	/* Now add the process to the queue. */
+	rq_insert(cpu_rq(rp->p_cpu), rp, q, 1);
 
 #ifdef CONFIG_DEBUG_KERNEL_SCHED_CHECK
 	rp->p_ready = 1;
@@ -1092,8 +1172,6 @@ void dequeue(struct proc *rp)
 	 * is picked to run by calling pick_proc().
 	 */
 	register int q = rp->p_priority;	/* queue to use */
-	register struct proc **xpp;		/* iterate over queue */
-	register struct proc *prev_xp;
 
 #if DEBUG_STACK_CHECK
 	/* Side-effect for kernel: check if the task's stack still is ok? */
@@ -1115,22 +1193,10 @@ void dequeue(struct proc *rp)
 	 * process if it is found. A process can be made unready even if it is not 
 	 * running by being sent a signal that kills it.
 	 */
-	prev_xp = NIL_PROC;
-
-	for (xpp = &rdy_head[q]; *xpp != NIL_PROC; xpp = &(*xpp)->p_nextready) {
-		if (*xpp == rp) {			/* found process to remove */
-			*xpp = (*xpp)->p_nextready;	/* replace with next chain */
-
-			if (rp == rdy_tail[q])		/* queue tail removed */
-				rdy_tail[q] = prev_xp;	/* set new tail */
-
+	if (rq_remove(cpu_rq(rp->p_cpu), rp, q)) {
 #ifdef CONFIG_DEBUG_KERNEL_SCHED_CHECK
-			rp->p_ready = 0;
-			CHECK_RUNQUEUES;
+		rp->p_ready = 0;
 #endif
-			break;
-		}
-		prev_xp = *xpp;				/* save previous in chain */
 	}
 
 #ifdef CONFIG_DEBUG_KERNEL_SCHED_CHECK
@@ -1181,76 +1247,81 @@ static struct proc *pick_proc(void)
 	 * clock task can tell who to bill for system time.
 	*/
 	register struct proc *rp;	/* process to run */
+	struct runqueue *rq;
+	unsigned cpu = this_cpu();
 	int q;				/* iterate over queues */
 
-	/* Check each of the scheduling queues for ready processes. The number of
-	 * queues is defined in proc.h, and priorities are set in the task table.
-	 * The lowest queue contains IDLE, which is always ready.
+	/* The lowest bit set in the map of this cpu's queues is the highest
+	 * priority ready queue. The number of queues is defined in proc.h, and
+	 * priorities are set in the task table.
 	 */
-	for (q=0; q < NR_SCHED_QUEUES; q++) {
-		if(!(rp = rdy_head[q])) {
-			TRACE(VF_PICKPROC, printk("queue %d empty\n", q););
-			continue;
-		}
-
-		TRACE(VF_PICKPROC, printk("found %s / %d on queue %d\n",
-		      rp->p_name, rp->p_endpoint, q););
+	rq = cpu_rq(cpu);
+	if (!rq->rdy_map) {
+		TRACE(VF_PICKPROC, printk("run queues empty\n"););
+		return NULL;
+	}
+	q = fls(rq->rdy_map & -rq->rdy_map) - 1;
+	rp = rq->rdy_head[q];
 
-		vmassert(!proc_is_runnable(rp));
+	TRACE(VF_PICKPROC, printk("found %s / %d on queue %d\n",
+	      rp->p_name, rp->p_endpoint, q););
 
-		if (priv(rp)->s_flags & BILLABLE)
-			bill_ptr = rp;		/* bill for system time */
+	vmassert(!proc_is_runnable(rp));
 
-		return rp;
-	}
+	if (priv(rp)->s_flags & BILLABLE)
+		bill_ptr = rp;		/* bill for system time */
 
-	return NULL;
+	return rp;
 }
 
 #define Q_BALANCE_TICKS		100
 /**
- * Check entire process table and give all process a higher priority
+ * Start a new aging period and apply it to all ready processes
  * @param tp  watchdog timer pointer
  */
 void balance_queues(timer_t *tp)
 {
-	/* Check entire process table and give all process a higher priority. This
-	 * effectively means giving a new quantum. If a process already is at its 
-	 * maximum priority, its quantum will be renewed.
+	/* Give all ready processes a higher priority. This effectively means
+	 * giving a new quantum. If a process already is at its maximum priority,
+	 * its quantum will be renewed. Only the run queues are walked, blocked
+	 * processes are aged by enqueue() when they become ready.
 	 */
 	static timer_t queue_timer;	/* timer structure to use */
-	register struct proc* rp;	/* process table pointer  */
-	clock_t next_period;		/* time of next period  */
-	int ticks_added = 0;		/* total time added */
+	register struct proc *rp, *next;	/* process table pointer  */
+	struct runqueue *rq;
+	unsigned cpu;
+	int q;
 
 	vmassert(!intr_disabled());
 
 	lock;
 
-	for (rp=BEG_PROC_ADDR; rp<END_PROC_ADDR; rp++) {
-		if (! isemptyp(rp)) {		/* check slot use */
-			if (rp->p_priority > rp->p_max_priority) {	/* update priority? */
-				if (proc_is_runnable(rp)) dequeue(rp);	/* take off queue */
-					ticks_added += rp->p_quantum_size;	/* do accounting */
+	sched_period++;
 
-				rp->p_priority -= 1;	/* raise priority */
+	for (cpu = 0; cpu < CONFIG_MAX_CPUS; cpu++) {
+		rq = cpu_rq(cpu);
+
+		/* A raised process moves one queue up, to a queue already
+		 * visited, so each one is aged only once.
+		 */
+		for (q = 0; q < NR_SCHED_QUEUES; q++) {
+			for (rp = rq->rdy_head[q]; rp != NIL_PROC; rp = next) {
+				next = rp->p_nextready;
 
-				if (proc_is_runnable(rp))
-					enqueue(rp);	/* put on queue */
-			} else {
-				ticks_added += rp->p_quantum_size - rp->p_ticks_left;
-				rp->p_ticks_left = rp->p_quantum_size;	/* give new quantum */
+				age_proc(rp);
+				if (rp->p_priority == q)
+					continue;
+
+				rq_remove(rq, rp, q);
+				rq_insert(rq, rp, rp->p_priority, 0);
 			}
 		}
 	}
 
 	unlock;
 
-	/* Now schedule a new watchdog timer to balance the queues again.  The 
-	 * period depends on the total amount of quantum ticks added.
-	 */
-	next_period = MAX(Q_BALANCE_TICKS, ticks_added);	/* calculate next */
-	set_timer(&queue_timer, get_uptime() + next_period, balance_queues);
+	/* Now schedule a new watchdog timer to balance the queues again. */
+	set_timer(&queue_timer, get_uptime() + Q_BALANCE_TICKS, balance_queues);
 }
 
 int lock_send(dst_e, m_ptr)
@@ -1466,6 +1537,8 @@ int kipc_call(u8 call_type, u32 flags, endpoint_t endpt, void *msg)
 	return(-ETRAPDENIED);		/* trap denied by mask or kernel */
 	}
 
+	ipct_call(caller_ptr, call_type);
+
 	/* Get and check the size of the argument in bytes.
 	 * Normally this is just the size of a regular message, but in the
 	 * case of SENDA the argument is a table.
@@ -1517,6 +1590,8 @@ int kipc_call(u8 call_type, u32 flags, endpoint_t endpt, void *msg)
 		result = -EBADCALL;			/* illegal system call */
 	}
 
+	ipct_call_end();
+
 	/* Now, return the result of the system call to the caller. */
 	return(result);
 }
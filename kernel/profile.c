@@ -12,7 +12,9 @@
  * profiling.
  *
  * Statistical Profiling:
- *   The interrupt handler for profiling clock. 
+ *   The interrupt handler for profiling clock. Every process is sampled,
+ *   including its frame pointer call stack, into a ring in the memory of
+ *   the collecting process (see struct sprof_sample_s).
  *
  * Call Profiling:
  *   The table used for profiling data and a function to get its size.
@@ -32,57 +34,152 @@
 
 #ifdef CONFIG_DEBUG_KERNEL_STATS_PROFILE
 
+int sprofiling;				/* whether profiling is running */
+int sprof_mem_size;			/* available user memory for data */
+struct sprof_info_s sprof_info;		/* profiling info for user program */
+vir_bytes sprof_data_addr_vir;		/* user address to write data */
+endpoint_t sprof_ep;			/* user process */
+
 /* A hook for the profiling clock interrupt handler. */
 static irq_hook_t profile_clock_hook;
 
+/* Sample being assembled, copied out as a whole. */
+static struct sprof_sample_s sprof_cur;
+static u32_t sprof_seq;			/* last sequence number written */
+
+/* Find the stack of a kernel task, from its guard word up to the initial
+ * stack pointer. Tasks without a stack of their own have none.
+ */
+static int sprof_kstack(struct proc *rp, reg_t *lo, reg_t *hi)
+{
+	int i;
+
+	for (i = 0; i < NR_TASKS; i++) {
+		if (image[i].proc_nr != proc_nr(rp))
+			continue;
+
+		if (!image[i].stksize || !priv(rp)->s_stack_guard)
+			return 0;
+
+		*lo = (reg_t) priv(rp)->s_stack_guard;
+		*hi = *lo + image[i].stksize;
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Walk the frame pointer chain of a process and record return addresses.
+ * Frames must grow towards higher addresses, anything else ends the walk.
+ * Kernel frames are read directly, so they must also lie within the stack
+ * of the task.
+ */
+static void sprof_stack(struct proc *rp, struct sprof_sample_s *s)
+{
+	reg_t fp, next_fp, ret;
+	reg_t lo = 0, hi = 0;
+	int iskernel = iskernelp(rp);
+
+	fp = rp->p_reg.fp;
+	s->depth = 0;
+
+	if (iskernel && !sprof_kstack(rp, &lo, &hi))
+		return;
+
+	while (fp && !(fp & (sizeof(reg_t) - 1))) {
+		if (s->depth == SPROF_STACK_DEPTH) {
+			s->flags |= SPROF_STACK_TRUNC;
+			break;
+		}
+
+		if (iskernel) {
+			if (fp < lo || fp > hi - 2 * sizeof(reg_t))
+				break;
+
+			next_fp = ((reg_t *) fp)[0];
+			ret = ((reg_t *) fp)[1];
+		} else if (data_copy(rp->p_endpoint, fp, SYSTEM,
+				     (vir_bytes) &next_fp, sizeof(next_fp)) != 0 ||
+			   data_copy(rp->p_endpoint, fp + sizeof(reg_t), SYSTEM,
+				     (vir_bytes) &ret, sizeof(ret)) != 0) {
+			break;
+		}
+
+		if (!ret)
+			break;
+
+		s->stack[s->depth++] = ret;
+
+		if (next_fp <= fp)
+			break;
+
+		fp = next_fp;
+	}
+}
+
 static int profile_clock_handler(irq_hook_t *hook)
 {
+	struct sprof_sample_s *s = &sprof_cur;
+	int slot;
+
 	/* This executes on every tick of the CMOS timer. */
 
-	/* Are we profiling, and profiling memory not full? */
-	if (!sprofiling || sprof_info.mem_used == -1)
+	/* Are we profiling? */
+	if (!sprofiling || !sprof_info.nr_slots)
 		return (1);
 
-	/* Check if enough memory available before writing sample. */
-	if (sprof_info.mem_used + sizeof(sprof_info) > sprof_mem_size) {
-		sprof_info.mem_used = -1;
-		return(1);
-	}
-
-	/* All is OK */
+	/* Note: k_reenter is always 0 here. */
+	s->endpt = proc_ptr->p_endpoint;
+	s->pc = proc_ptr->p_reg.pc;
+	s->flags = 0;
+	s->depth = 0;
+	strncpy(s->name, proc_ptr->p_name, SPROF_PROCNAME_LEN);
 
 	/* Idle process? */
 	if (priv(proc_ptr)->s_proc_nr == IDLE) {
+		s->flags |= SPROF_IDLE;
 		sprof_info.idle_samples++;
-	} else
-		/* Runnable system process? */
-		if (priv(proc_ptr)->s_flags & SYS_PROC && proc_is_runnable(proc_ptr)) {
-			/* Note: k_reenter is always 0 here. */
-
-			/* Store sample (process name and program counter). */
-			data_copy(SYSTEM, (vir_bytes) proc_ptr->p_name, sprof_ep,
-				  sprof_data_addr_vir + sprof_info.mem_used,
-				  strlen(proc_ptr->p_name));
-
-			data_copy(SYSTEM, (vir_bytes) &proc_ptr->p_reg.pc, sprof_ep,
-				  (vir_bytes) (sprof_data_addr_vir + sprof_info.mem_used +
-				  sizeof(proc_ptr->p_name)),
-				  (vir_bytes) sizeof(proc_ptr->p_reg.pc));
-
-			sprof_info.mem_used += sizeof(sprof_sample);
+	} else {
+		if (iskernelp(proc_ptr))
+			s->flags |= SPROF_KERNEL;
 
+		if (priv(proc_ptr)->s_flags & SYS_PROC) {
+			s->flags |= SPROF_SYSTEM;
 			sprof_info.system_samples++;
 		} else {
 			/* User process. */
 			sprof_info.user_samples++;
 		}
 
-		sprof_info.total_samples++;
+		sprof_stack(proc_ptr, s);
+	}
+
+	/* Publish the sample. The sequence number is part of the same copy,
+	 * so the collector never sees a half written slot.
+	 */
+	s->seq = ++sprof_seq;
+	if (!s->seq)
+		s->seq = ++sprof_seq;
+
+	slot = (s->seq - 1) % sprof_info.nr_slots;
+	data_copy(SYSTEM, (vir_bytes) s, sprof_ep,
+		  sprof_data_addr_vir + slot * sizeof(*s), sizeof(*s));
 
-		/* Acknowledge interrupt if necessary. */
-		arch_ack_profile_clock();
+	if (sprof_info.mem_used < sprof_info.nr_slots * (int)sizeof(*s))
+		sprof_info.mem_used += sizeof(*s);
 
-		return(1);	/* reenable interrupts */
+	sprof_info.total_samples++;
+
+	/* Acknowledge interrupt if necessary. */
+	arch_ack_profile_clock();
+
+	return(1);	/* reenable interrupts */
+}
+
+void sprof_reset(void)
+{
+	sprof_seq = 0;
+	sprof_info.nr_slots = sprof_mem_size / sizeof(struct sprof_sample_s);
 }
 
 void init_profile_clock(u32_t freq)
@@ -44,6 +44,7 @@
 #include <kernel/proc.h>
 #include <nucleos/kipc.h>
 #include <kernel/vm.h>
+#include <kernel/ipctrace.h>
 #include <stdlib.h>
 #include <nucleos/signal.h>
 #include <nucleos/unistd.h>
@@ -547,12 +548,16 @@ register struct proc *rc;		/* slot of process to clean up */
 	  rp->p_sendto_e == rc->p_endpoint) {
           rp->p_reg.retreg = -EDSTDIED;		/* report destination died */
 	  RTS_LOCK_UNSET(rp, RTS_SENDING);
+	  ipct_unblock(rp);
 #ifdef CONFIG_DEBUG_KERNEL_IPC_WARNINGS
 	  printk("endpoint %d / %s send to dying dst ep %d (%s)\n",
 		rp->p_endpoint, rp->p_name, rc->p_endpoint, rc->p_name);
 #endif
       } 
   }
+
+  /* Start with clean IPC statistics when the slot is reused. */
+  ipct_clear(rc);
 }
 
 /*===========================================================================*
@@ -21,6 +21,7 @@
 #include <nucleos/endpoint.h>
 #include <kernel/system.h>
 #include <kernel/vm.h>
+#include <kernel/ipctrace.h>
 #include <asm/bootparam.h>
 
 #if USE_GETINFO
@@ -151,6 +152,17 @@ register kipc_msg_t *m_ptr;	/* pointer to request message */
 		length = sizeof(timingdata);
 		src_vir = (vir_bytes) timingdata;
 		break;
+#endif
+#ifdef CONFIG_DEBUG_KERNEL_IPC_TRACE
+	case GET_IPCSTATS:
+		length = sizeof(ipct_stats);
+		src_vir = (vir_bytes) ipct_stats;
+		break;
+
+	case GET_IPCTRACE:
+		length = sizeof(ipct_trace);
+		src_vir = (vir_bytes) &ipct_trace;
+		break;
 #endif
 	case GET_IRQACTIDS:
 		length = sizeof(irq_actids);
@@ -14,6 +14,7 @@
  *    m_data1:	IRQ_REQUEST	(control operation to perform)	
  *    m_data2:	IRQ_VECTOR	(irq line that must be controlled)
  *    m_data3:	IRQ_POLICY	(irq policy allows reenabling interrupts)
+ *    m_data5:	IRQ_TICKS	(minimum ticks between notifications)
  *    m_data7:	IRQ_HOOK_ID	(provides index to be returned on interrupt)
  *      ,,          ,,          (returns index of irq hook assigned at kernel)
  */
@@ -25,6 +26,9 @@
 #if USE_IRQCTL
 
 static int generic_handler(irq_hook_t *hook);
+static void irq_notify(irq_hook_t *hook, int proc_nr);
+
+static int irq_deferred;	/* there may be deferred notifications */
 
 /*===========================================================================*
  *				do_irqctl				     *
@@ -113,12 +117,36 @@ register kipc_msg_t *m_ptr;	/* pointer to request message */
       hook_ptr->proc_nr_e = m_ptr->m_source;	/* process to notify */   	
       hook_ptr->notify_id = notify_id;		/* identifier to pass */   	
       hook_ptr->policy = m_ptr->IRQ_POLICY;	/* policy for interrupts */
+      hook_ptr->coalesce_ticks = 0;		/* notify every interrupt */
+      hook_ptr->deferred = 0;
+      hook_ptr->notify_tm = 0;
+      hook_ptr->nr_intr = 0;
+      hook_ptr->nr_notify = 0;
       put_irq_handler(hook_ptr, irq_vec, generic_handler);
 
       /* Return index of the IRQ hook in use. */
       m_ptr->IRQ_HOOK_ID = irq_hook_id + 1;
       break;
 
+  /* Set a minimum interval between the notifications of a hook. An
+   * interrupt that comes less than IRQ_TICKS ticks after the previous
+   * notification is held back, and the clock sends it once the interval
+   * is over. Only hooks whose policy does not reenable the line may do
+   * this: the line stays masked until the driver has serviced the device,
+   * so at most one interrupt is ever pending and the driver picks up all
+   * the work the device queued meanwhile. An IRQ_REENABLE line would keep
+   * interrupting unserviced. IRQ_TICKS 0 turns the interval off.
+   */
+  case IRQ_COALESCE:
+      if (irq_hook_id >= NR_IRQ_HOOKS || irq_hook_id < 0 ||
+          irq_hooks[irq_hook_id].proc_nr_e == ENDPT_NONE) return(-EINVAL);
+      if (irq_hooks[irq_hook_id].proc_nr_e != m_ptr->m_source) return(-EPERM);
+      if (m_ptr->IRQ_TICKS < 0) return(-EINVAL);
+      if (m_ptr->IRQ_TICKS > 0 &&
+          (irq_hooks[irq_hook_id].policy & IRQ_REENABLE)) return(-EINVAL);
+      irq_hooks[irq_hook_id].coalesce_ticks = m_ptr->IRQ_TICKS;
+      break;
+
   case IRQ_RMPOLICY:
       if (irq_hook_id < 0 || irq_hook_id >= NR_IRQ_HOOKS ||
                irq_hooks[irq_hook_id].proc_nr_e == ENDPT_NONE) {
@@ -162,16 +190,68 @@ irq_hook_t *hook;
   if(!isokendpt(hook->proc_nr_e, &proc_nr))
      kernel_panic("invalid interrupt handler", hook->proc_nr_e);
 
+  hook->nr_intr++;
+  hook->deferred++;
+
+  /* Hold the notification back if the last one is too recent. */
+  if (hook->coalesce_ticks != 0 &&
+      get_uptime() - hook->notify_tm < hook->coalesce_ticks) {
+      irq_deferred = 1;
+      return(hook->policy & IRQ_REENABLE);
+  }
+
+  irq_notify(hook, proc_nr);
+  return(hook->policy & IRQ_REENABLE);
+}
+
+/*===========================================================================*
+ *			       irq_notify				     *
+ *===========================================================================*/
+static void irq_notify(hook, proc_nr)
+irq_hook_t *hook;
+int proc_nr;
+{
   /* Add a bit for this interrupt to the process' pending interrupts. When 
    * sending the notification message, this bit map will be magically set
    * as an argument. 
    */
   priv(proc_addr(proc_nr))->s_int_pending |= (1 << hook->notify_id);
 
-  /* Build notification message and return. */
+  hook->deferred = 0;
+  hook->notify_tm = get_uptime();
+  hook->nr_notify++;
+
+  /* Build notification message. */
   vmassert(intr_disabled());
   mini_notify(proc_addr(HARDWARE), hook->proc_nr_e);
-  return(hook->policy & IRQ_REENABLE);
+}
+
+/*===========================================================================*
+ *			       irq_coalesce_expire			     *
+ *===========================================================================*/
+void irq_coalesce_expire(now)
+clock_t now;
+{
+/* Called by the clock interrupt handler. Send the notifications that were
+ * held back for longer than their hook allows.
+ */
+  irq_hook_t *hook;
+  int proc_nr;
+
+  if (!irq_deferred)
+      return;
+
+  irq_deferred = 0;
+  for (hook = irq_hooks; hook < &irq_hooks[NR_IRQ_HOOKS]; hook++) {
+      if (hook->proc_nr_e == ENDPT_NONE || hook->deferred == 0)
+          continue;
+      if (now - hook->notify_tm < hook->coalesce_ticks) {
+          irq_deferred = 1;		/* look again next tick */
+          continue;
+      }
+      if (isokendpt(hook->proc_nr_e, &proc_nr))
+          irq_notify(hook, proc_nr);
+  }
 }
 
 #endif /* USE_IRQCTL */
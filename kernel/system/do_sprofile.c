@@ -45,8 +45,8 @@ register kipc_msg_t *m_ptr;    /* pointer to request message */
 	/* Starting profiling.
 	 *
 	 * Check if profiling is not already running.  Calculate physical
-	 * addresses of user pointers.  Reset counters.  Start CMOS timer.
-	 * Turn on profiling.
+	 * addresses of user pointers.  Reset counters and the sample ring.
+	 * Start CMOS timer.  Turn on profiling.
 	 */
 	if (sprofiling) {
 		printk("SYSTEM: start s-profiling: already started\n");
@@ -69,6 +69,10 @@ register kipc_msg_t *m_ptr;    /* pointer to request message */
 	sprof_info.user_samples = 0;
 
 	sprof_mem_size = m_ptr->PROF_MEM_SIZE;
+	sprof_reset();
+
+	if (!sprof_info.nr_slots)
+		return -EINVAL;
 
 	init_profile_clock(m_ptr->PROF_FREQ);
 	
@@ -16,6 +16,7 @@
  *    m_data5:	CP_SRC_ADDR	(virtual address)	
  *    m_data6:	CP_DST_ADDR	(returns physical address)	
  *    m_data7:	CP_NR_BYTES	(size of datastructure) 	
+ *    m_data4:	CP_GRANT_OFFSET	(offset within grant, VM_GRANT only)
  */
 
 #include <kernel/system.h>
@@ -34,6 +35,7 @@ register kipc_msg_t *m_ptr;	/* pointer to request message */
   int seg_index = m_ptr->CP_SRC_SPACE & SEGMENT_INDEX;
   vir_bytes offset = m_ptr->CP_SRC_ADDR;
   int count = m_ptr->CP_NR_BYTES;
+  vir_bytes grant_offset = m_ptr->CP_GRANT_OFFSET;
   int endpt = (int) m_ptr->CP_SRC_ENDPT;
   int proc_nr, r;
   int naughty = 0;
@@ -70,7 +72,8 @@ register kipc_msg_t *m_ptr;	/* pointer to request message */
 	endpoint_t newep;
 	int new_proc_nr;
 
-        if(verify_grant(targetpr->p_endpoint, ENDPT_ANY, offset, count, 0, 0,
+        if(verify_grant(targetpr->p_endpoint, ENDPT_ANY, offset, count, 0,
+                grant_offset,
                 &newoffset, &newep) != 0) {
                 printk("SYSTEM: do_umap: verify_grant in %s, grant %d, bytes 0x%lx, failed, caller %s\n", targetpr->p_name, offset, count, caller->p_name);
 		proc_stacktrace(caller);
@@ -112,10 +115,9 @@ register kipc_msg_t *m_ptr;	/* pointer to request message */
       phys_addr = lin_addr;
   }
 
-  if(vm_running && !vm_contiguous(targetpr, lin_addr, count)) {
-	printk("SYSTEM:do_umap: not contiguous\n");
+  /* Not an error as such, drivers map such buffers page by page. */
+  if(vm_running && !vm_contiguous(targetpr, lin_addr, count))
 	return -EFAULT;
-  }
 
   m_ptr->CP_DST_ADDR = phys_addr;
   if(naughty || phys_addr == 0) {
@@ -18,187 +18,281 @@
 #include <stdlib.h>
 #include <nucleos/string.h>
 #include <nucleos/errno.h>
+#include <nucleos/mman.h>
 #include <assert.h>
 
 #define	ptrint		int
 
 #define BRKSIZE		4096
+#define PAGESIZE	4096
 #define	PTRSIZE		((int) sizeof(void *))
 #define Align(x,a)	(((x) + (a - 1)) & ~(a - 1))
-#define NextSlot(p)	(* (void **) ((p) - PTRSIZE))
-#define NextFree(p)	(* (void **) (p))
 
 /*
  * A short explanation of the data structure and algorithms.
- * An area returned by malloc() is called a slot. Each slot
- * contains the number of bytes requested, but preceeded by
- * an extra pointer to the next the slot in memory.
- * '_bottom' and '_top' point to the first/last slot.
- * More memory is asked for using brk() and appended to top.
- * The list of free slots is maintained to keep malloc() fast.
- * '_empty' points the the first free slot. Free slots are
- * linked together by a pointer at the start of the
- * user visable part, so just after the next-slot pointer.
- * Free slots are merged together by free().
+ * Every area returned by malloc() is preceeded by a header of
+ * two words. The first word tells how the area was allocated,
+ * the second one is a magic number checked when DEBUG is on
+ * (it also keeps the areas aligned to 8 bytes).
+ *
+ * Small areas (up to SMALL_MAX bytes with the header) are rounded
+ * up to one of the size classes: steps of 16 bytes up to 128 and
+ * four classes per power of two above that. Each class has its own
+ * list of free areas, linked by a pointer at the start of the user
+ * visible part, so both malloc() and free() take a constant time.
+ * An empty class takes a new area from the arena, the memory between
+ * '_arena' and '_arena_end' obtained with brk(). Free areas are not
+ * merged, they are only reused by the same class.
+ *
+ * Larger areas are mapped with mmap() and given back to VM by free().
+ * If the mapping fails (e.g. a process started before VM runs) they
+ * come from the arena as well and are kept on the '_big' list.
  */
 
+#define SMALL_MIN	16
+#define SMALL_MAX	65536
+#define NCLASSES	(8 + 4 * 9)	/* 16..128, 160..65536 */
+
+#define M_SMALL		1		/* class index << 2 */
+#define M_MMAP		2		/* mapped length */
+#define M_BIG		3		/* arena length */
+#define M_TYPE		3
+#define M_MAGIC		0x6d616c6c
+
+struct mhdr {
+  size_t info;			/* M_* type and class or length */
+  size_t magic;			/* M_MAGIC while allocated */
+};
+
+#define HDRSIZE		((int) sizeof(struct mhdr))
+#define Hdr(p)		((struct mhdr *) ((char *) (p) - HDRSIZE))
+#define NextFree(p)	(* (void **) (p))
+
 extern void *sbrk(int);
 extern int brk(void *);
-static void *_bottom, *_top, *_empty;
 
-static int grow(size_t len)
+static char *_arena, *_arena_end;
+static void *_free[NCLASSES];
+static void *_big;
+static size_t _class_size[NCLASSES];
+
+static void init_classes(void)
 {
-  register char *p;
+  size_t size, step;
+  int i;
 
-  assert(NextSlot((char *)_top) == 0);
-  if ((char *) _top + len < (char *) _top
-      || (p = (char *)Align((ptrint)_top + len, BRKSIZE)) < (char *) _top ) {
-	errno = ENOMEM;
-	return(0);
+  for (i = 0, size = SMALL_MIN; size <= 128; i++, size += 16)
+	_class_size[i] = size;
+  for (step = 32, size = 160; i < NCLASSES; i++, size += step) {
+	_class_size[i] = size;
+	if ((size & (size - 1)) == 0)
+		step = size / 4;
   }
-  if (brk(p) != 0)
-	return(0);
-  NextSlot((char *)_top) = p;
-  NextSlot(p) = 0;
-  free(_top);
-  _top = p;
-  return 1;
+  assert(_class_size[NCLASSES - 1] == SMALL_MAX);
 }
 
-void *
-malloc(size_t size)
+/* Size class of an area of 'len' bytes, header included. */
+static int size_class(size_t len)
 {
-  register char *prev, *p, *next, *new;
-  register unsigned len, ntries;
+  int shift, i;
 
-  if (size == 0)
-	return NULL;
+  if (len <= 128)
+	return len <= SMALL_MIN ? 0 : (len - 1) / 16;
 
-  for (ntries = 0; ntries < 2; ntries++) {
-	if ((len = Align(size, PTRSIZE) + PTRSIZE) < 2 * PTRSIZE) {
+  /* 2^shift < len <= 2^(shift + 1), four classes in between */
+  for (shift = 7; (len - 1) >> (shift + 1); shift++)
+	;
+  i = 8 + 4 * (shift - 7) + (((len - 1) >> (shift - 2)) & 3);
+  assert(_class_size[i] >= len && (i == 0 || _class_size[i - 1] < len));
+  return i;
+}
+
+/* Take 'len' bytes from the end of the arena, growing it if needed. */
+static char *arena_alloc(size_t len)
+{
+  char *p, *brkp;
+  size_t left, incr;
+
+  left = _arena_end - _arena;
+  if (left < len) {
+	/* Only grow by what the free tail of the arena lacks. */
+	incr = Align(len - left, BRKSIZE);
+	if (incr < len - left || (int) incr < 0) {
 		errno = ENOMEM;
 		return NULL;
 	}
-	if (_bottom == 0) {
-		if ((p = sbrk(2 * PTRSIZE)) == (char *) -1)
-			return NULL;
-		p = (char *) Align((ptrint)p, PTRSIZE);
-		p += PTRSIZE;
-		_top = _bottom = p;
-		NextSlot(p) = 0;
-	}
-#ifdef SLOWDEBUG
-	for (p = _bottom; (next = NextSlot(p)) != 0; p = next)
-		assert(next > p);
-	assert(p == _top);
-#endif
-	for (prev = 0, p = _empty; p != 0; prev = p, p = NextFree(p)) {
-		next = NextSlot(p);
-		new = p + len;	/* easily overflows!! */
-		if (new > next || new <= p)
-			continue;		/* too small */
-		if (new + PTRSIZE < next) {	/* too big, so split */
-			/* + PTRSIZE avoids tiny slots on free list */
-			NextSlot(new) = next;
-			NextSlot(p) = new;
-			NextFree(new) = NextFree(p);
-			NextFree(p) = new;
+	if ((brkp = sbrk(incr)) == (char *) -1)
+		return NULL;
+	if (brkp != _arena_end) {
+		/* Someone else moved the break, start a new arena. The
+		 * rest of the old one is lost.
+		 */
+		_arena = (char *) Align((ptrint) brkp, 2 * PTRSIZE);
+		_arena_end = brkp + incr;
+		left = _arena_end - _arena;
+		if (left < len) {
+			incr = Align(len - left, BRKSIZE);
+			if ((int) incr < 0 || sbrk(incr) == (char *) -1)
+				return NULL;
+			_arena_end += incr;
 		}
-		if (prev)
-			NextFree(prev) = NextFree(p);
-		else
-			_empty = NextFree(p);
+	} else {
+		_arena_end += incr;
+	}
+  }
+  p = _arena;
+  _arena += len;
+  return p;
+}
+
+static void *big_alloc(size_t len)
+{
+  struct mhdr *h;
+  void **prev, *p;
+
+  len = Align(len, PAGESIZE);
+  if (len < SMALL_MAX) {
+	errno = ENOMEM;
+	return NULL;
+  }
+
+  h = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (h != MAP_FAILED) {
+	h->info = len | M_MMAP;
+	h->magic = M_MAGIC;
+	return h + 1;
+  }
+
+  /* No VM to map from, reuse or carve an arena area. */
+  for (prev = &_big; (p = *prev) != 0; prev = &NextFree(p)) {
+	if ((Hdr(p)->info & ~M_TYPE) >= len) {
+		*prev = NextFree(p);
+		Hdr(p)->magic = M_MAGIC;
 		return p;
 	}
-	if (grow(len) == 0)
-		break;
   }
-  assert(ntries != 2);
-  return NULL;
+  if ((h = (struct mhdr *) arena_alloc(len)) == NULL)
+	return NULL;
+  h->info = len | M_BIG;
+  h->magic = M_MAGIC;
+  return h + 1;
+}
+
+void *
+malloc(size_t size)
+{
+  struct mhdr *h;
+  size_t len;
+  void *p;
+  int i;
+
+  if (size == 0)
+	return NULL;
+
+  if ((len = Align(size, 2 * PTRSIZE) + HDRSIZE) < size) {
+	errno = ENOMEM;
+	return NULL;
+  }
+  if (len > SMALL_MAX)
+	return big_alloc(len);
+
+  if (_class_size[0] == 0)
+	init_classes();
+
+  i = size_class(len);
+  if ((p = _free[i]) != 0) {
+	_free[i] = NextFree(p);
+	assert(Hdr(p)->info == ((i << 2) | M_SMALL));
+	assert(Hdr(p)->magic != M_MAGIC);
+	Hdr(p)->magic = M_MAGIC;
+	return p;
+  }
+
+  if ((h = (struct mhdr *) arena_alloc(_class_size[i])) == NULL)
+	return NULL;
+  h->info = (i << 2) | M_SMALL;
+  h->magic = M_MAGIC;
+  return h + 1;
+}
+
+/* Usable size of an allocated area. */
+static size_t usable_size(void *p)
+{
+  size_t info = Hdr(p)->info;
+
+  if ((info & M_TYPE) == M_SMALL)
+	return _class_size[info >> 2] - HDRSIZE;
+  return (info & ~M_TYPE) - HDRSIZE;
 }
 
 void *
 realloc(void *oldp, size_t size)
 {
-  register char *prev, *p, *next, *new;
-  char *old = oldp;
-  register size_t len, n;
+  size_t n, len;
+  void *new;
 
-  if (old == 0)
+  if (oldp == 0)
 	return malloc(size);
   if (size == 0) {
-	free(old);
+	free(oldp);
 	return NULL;
   }
-  len = Align(size, PTRSIZE) + PTRSIZE;
-  next = NextSlot(old);
-  n = (int)(next - old);			/* old length */
-  /*
-   * extend old if there is any free space just behind it
-   */
-  for (prev = 0, p = _empty; p != 0; prev = p, p = NextFree(p)) {
-	if (p > next)
-		break;
-	if (p == next) {	/* 'next' is a free slot: merge */
-		NextSlot(old) = NextSlot(p);
-		if (prev)
-			NextFree(prev) = NextFree(p);
-		else
-			_empty = NextFree(p);
-		next = NextSlot(old);
-		break;
-	}
-  }
-  new = old + len;
-  /*
-   * Can we use the old, possibly extended slot?
+  assert(Hdr(oldp)->magic == M_MAGIC);
+
+  /* Keep the area as long as it fits and is not more than twice as big
+   * as needed.
    */
-  if (new <= next && new >= old) {		/* it does fit */
-	if (new + PTRSIZE < next) {		/* too big, so split */
-		/* + PTRSIZE avoids tiny slots on free list */
-		NextSlot(new) = next;
-		NextSlot(old) = new;
-		free(new);
-	}
-	return old;
-  }
-  if ((new = malloc(size)) == NULL)		/* it didn't fit */
+  n = usable_size(oldp);
+  len = Align(size, 2 * PTRSIZE);
+  if (len >= size && len <= n && len + HDRSIZE > (n + HDRSIZE) / 2)
+	return oldp;
+
+  if ((new = malloc(size)) == NULL)
 	return NULL;
-  memcpy(new, old, n);				/* n < size */
-  free(old);
+  memcpy(new, oldp, n < size ? n : size);
+  free(oldp);
   return new;
 }
 
 void
 free(void *ptr)
 {
-  register char *prev, *next;
-  char *p = ptr;
+  struct mhdr *h;
+  int i;
 
-  if (p == 0)
+  if (ptr == 0)
 	return;
 
-  assert(NextSlot(p) > p);
-  for (prev = 0, next = _empty; next != 0; prev = next, next = NextFree(next))
-	if (p < next)
-		break;
-  NextFree(p) = next;
-  if (prev)
-	NextFree(prev) = p;
-  else
-	_empty = p;
-  if (next) {
-	assert(NextSlot(p) <= next);
-	if (NextSlot(p) == next) {		/* merge p and next */
-		NextSlot(p) = NextSlot(next);
-		NextFree(p) = NextFree(next);
-	}
-  }
-  if (prev) {
-	assert(NextSlot(prev) <= p);
-	if (NextSlot(prev) == p) {		/* merge prev and p */
-		NextSlot(prev) = NextSlot(p);
-		NextFree(prev) = NextFree(p);
+  h = Hdr(ptr);
+  assert(h->magic == M_MAGIC);
+  h->magic = 0;
+
+  switch (h->info & M_TYPE) {
+  case M_SMALL:
+	i = h->info >> 2;
+	assert(i < NCLASSES);
+#ifdef SLOWDEBUG
+	{
+		void *p;
+
+		for (p = _free[i]; p != 0; p = NextFree(p))
+			assert(p != ptr);
 	}
+#endif
+	NextFree(ptr) = _free[i];
+	_free[i] = ptr;
+	break;
+  case M_MMAP:
+	if (munmap(h, h->info & ~M_TYPE) == 0)
+		break;
+	/* Cannot unmap it (yet), keep it for later use. */
+	h->info = (h->info & ~M_TYPE) | M_BIG;
+	/* fall through */
+  case M_BIG:
+	NextFree(ptr) = _big;
+	_big = ptr;
+	break;
+  default:
+	assert(0);
   }
 }
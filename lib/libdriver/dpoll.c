@@ -0,0 +1,106 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+/* Hybrid polled/interrupt completion for block drivers. The driver calls
+ * dpoll_want() after it started a command. If the device usually completes
+ * within the limit, the driver spins on the controller for up to the returned
+ * number of tsc cycles and waits for the interrupt only if that fails. Either
+ * way dpoll_done() adds the completion time to the moving average.
+ */
+#include <nucleos/driver.h>
+#include <nucleos/dpoll.h>
+#include <asm/ioctls.h>
+
+/*===========================================================================*
+ *				dpoll_setlimit				     *
+ *===========================================================================*/
+void dpoll_setlimit(struct dpoll *dp, unsigned micros)
+{
+	dp->dp_limit_us = micros;
+	dp->dp_limit = micros ? micros_to_tsc(micros) : 0;
+	dp->dp_avg = 0;
+	dp->dp_probe = 0;
+}
+
+/*===========================================================================*
+ *				dpoll_want				     *
+ *===========================================================================*/
+int dpoll_want(struct dpoll *dp, u32_t *spinp)
+{
+	if (dp->dp_limit == 0)
+		return 0;
+
+	/* A slow device is still tried now and then, it may have become
+	 * faster (or it is only slow when seeking).
+	 */
+	if (dp->dp_avg >= dp->dp_limit && ++dp->dp_probe < DPOLL_PROBE)
+		return 0;
+
+	dp->dp_probe = 0;
+
+	/* Give up when it takes twice as long as expected. */
+	*spinp = 2 * dp->dp_limit;
+	return 1;
+}
+
+/*===========================================================================*
+ *				dpoll_done				     *
+ *===========================================================================*/
+void dpoll_done(struct dpoll *dp, u64_t start, int polled)
+{
+	u64_t now;
+	u32_t t;
+
+	read_tsc_64(&now);
+	now = sub64(now, start);
+	t = ex64hi(now) ? 0xffffffff : ex64lo(now);
+
+	dp->dp_avg += (t >> DPOLL_SHIFT) - (dp->dp_avg >> DPOLL_SHIFT);
+
+	if (polled)
+		dp->dp_polled++;
+	else
+		dp->dp_intr++;
+}
+
+/*===========================================================================*
+ *				dpoll_ioctl				     *
+ *===========================================================================*/
+int dpoll_ioctl(struct dpoll *dp, kipc_msg_t *m_ptr)
+{
+	struct dpoll_info info;
+	int r;
+
+	if (m_ptr->REQUEST == DIOCSETPOLL) {
+		r = sys_safecopyfrom(m_ptr->IO_ENDPT, (vir_bytes)m_ptr->IO_GRANT,
+			0, (vir_bytes)&info, sizeof(info), D);
+		if (r != 0)
+			return r;
+
+		/* Longer limits would overflow the tsc value and spin the
+		 * driver for good.
+		 */
+		if (info.dpi_limit > DPOLL_MAX)
+			return -EINVAL;
+
+		dpoll_setlimit(dp, info.dpi_limit);
+		return 0;
+	}
+
+	if (m_ptr->REQUEST != DIOCGETPOLL)
+		return -EINVAL;
+
+	info.dpi_limit = dp->dp_limit_us;
+	info.dpi_avg = dp->dp_avg ? tsc_to_micros(dp->dp_avg) : 0;
+	info.dpi_polled = dp->dp_polled;
+	info.dpi_intr = dp->dp_intr;
+
+	return sys_safecopyto(m_ptr->IO_ENDPT, (vir_bytes)m_ptr->IO_GRANT,
+		0, (vir_bytes)&info, sizeof(info), D);
+}
@@ -0,0 +1,32 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#include <nucleos/unistd.h>
+#include <nucleos/epoll.h>
+#include <asm/syscall.h>
+
+int epoll_create(int size)
+{
+	return INLINE_SYSCALL(epoll_create, 1, size);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+	return INLINE_SYSCALL(epoll_ctl, 4, epfd, op, fd, event);
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+	return INLINE_SYSCALL(epoll_wait, 4, epfd, events, maxevents, timeout);
+}
+
+int epoll_close(int epfd)
+{
+	return INLINE_SYSCALL(epoll_ctl, 4, epfd, EPOLL_CTL_CLOSE, -1, 0);
+}
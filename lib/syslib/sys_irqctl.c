@@ -33,3 +33,20 @@ int *hook_id;				/* ID of IRQ hook at kernel */
 }
 
 
+
+/*===========================================================================*
+ *                               sys_irqcoalesce			     *
+ *===========================================================================*/
+int sys_irqcoalesce(hook_id, ticks)
+int *hook_id;				/* ID of IRQ hook at kernel */
+clock_t ticks;				/* min. ticks between notifications */
+{
+    kipc_msg_t m_irq;
+
+    m_irq.m_type = SYS_IRQCTL;
+    m_irq.IRQ_REQUEST = IRQ_COALESCE;
+    m_irq.IRQ_HOOK_ID = *hook_id;
+    m_irq.IRQ_TICKS = ticks;
+
+    return(ktaskcall(SYSTASK, SYS_IRQCTL, &m_irq));
+}
@@ -26,9 +26,37 @@ phys_bytes *phys_addr;			/* placeholder for result */
     m.CP_SRC_SPACE = seg;
     m.CP_SRC_ADDR = vir_addr;
     m.CP_NR_BYTES = bytes;
+    m.CP_GRANT_OFFSET = 0;
 
     result = ktaskcall(SYSTASK, SYS_UMAP, &m);
     *phys_addr = m.CP_DST_ADDR;
     return(result);
 }
 
+
+/*===========================================================================*
+ *                                sys_umap_grant			     *
+ *===========================================================================*/
+int sys_umap_grant(proc_ep, grant, offset, bytes, phys_addr)
+endpoint_t proc_ep;			/* process that granted the memory */
+cp_grant_id_t grant;			/* grant id */
+vir_bytes offset;			/* offset within the grant */
+vir_bytes bytes;			/* number of bytes to be mapped */
+phys_bytes *phys_addr;			/* placeholder for result */
+{
+/* Like sys_umap(proc_ep, VM_GRANT, ...) but starting at an offset within
+ * the grant, so that a large grant can be mapped piecewise.
+ */
+    kipc_msg_t m;
+    int result;
+
+    m.CP_SRC_ENDPT = proc_ep;
+    m.CP_SRC_SPACE = VM_GRANT;
+    m.CP_SRC_ADDR = grant;
+    m.CP_NR_BYTES = bytes;
+    m.CP_GRANT_OFFSET = offset;
+
+    result = ktaskcall(SYSTASK, SYS_UMAP, &m);
+    *phys_addr = m.CP_DST_ADDR;
+    return(result);
+}
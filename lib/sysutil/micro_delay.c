@@ -102,3 +102,21 @@ micro_delay(u32_t micros)
 	return 0;
 }
 
+
+u32_t
+micros_to_tsc(u32_t micros)
+{
+	CALIBRATE;
+
+	return div64u(mul64u(calib_tsc, micros * Hz / CALIBRATE_TICKS(Hz)),
+		MICROHZ);
+}
+
+u32_t
+tsc_to_micros(u32_t tsc)
+{
+	CALIBRATE;
+
+	return div64u(mul64u(tsc, MICROHZ / (Hz / CALIBRATE_TICKS(Hz))),
+		calib_tsc);
+}
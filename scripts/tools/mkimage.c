@@ -26,6 +26,20 @@
 #define MAX_NAMELEN	32
 #define SECTOR_SIZE	512
 
+/* Compressed text and data, see arch/x86/boot/bootimage.c. The descriptor
+ * follows the (long) a.out header in the header sector.
+ */
+#define LZ4_OFFSET	0x70
+#define LZ4_MAGIC	0x34345a4cUL	/* "LZ44" */
+#define LZ4_BLOCK	4096
+#define LZ4_STORED	0x80000000UL
+
+#define LZ4_HASH_BITS	12
+#define LZ4_MINMATCH	4
+#define LZ4_LASTLITERALS 5		/* the last bytes are always literals */
+#define LZ4_MFLIMIT	12		/* no match starts closer to the end */
+#define LZ4_MAX_OFFSET	65535
+
 FILE * fout;
 
 static int write_bytes(char *b, size_t bytes, off_t off)
@@ -64,14 +78,144 @@ static int write_name(char *str, off_t off)
 	return 0;
 }
 
+static void put_le32(unsigned char *p, unsigned long v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static unsigned int lz4_hash(const unsigned char *p)
+{
+	unsigned long v = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+
+	return ((v * 2654435761UL) & 0xffffffffUL) >> (32 - LZ4_HASH_BITS);
+}
+
+static unsigned char *lz4_put_len(unsigned char *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+
+	return op;
+}
+
+static unsigned char *lz4_sequence(unsigned char *op, const unsigned char *lit,
+				   size_t nlit, size_t off, size_t mlen)
+{
+	unsigned char *token = op++;
+
+	*token = (nlit >= 15 ? 15 : nlit) << 4;
+	if (nlit >= 15)
+		op = lz4_put_len(op, nlit - 15);
+	memcpy(op, lit, nlit);
+	op += nlit;
+
+	/* The last sequence has literals only. */
+	if (!mlen)
+		return op;
+
+	*op++ = off;
+	*op++ = off >> 8;
+
+	mlen -= LZ4_MINMATCH;
+	*token |= mlen >= 15 ? 15 : mlen;
+	if (mlen >= 15)
+		op = lz4_put_len(op, mlen - 15);
+
+	return op;
+}
+
+/* Compress one block with a greedy LZ4 matcher. Returns the compressed size,
+ * or 0 if the block doesn't get smaller.
+ */
+static size_t lz4_compress(const unsigned char *src, size_t n, unsigned char *dst)
+{
+	const unsigned char *ip = src, *anchor = src, *end = src + n, *match;
+	unsigned char *op = dst;
+	long table[1 << LZ4_HASH_BITS];
+	size_t len, nlit;
+	unsigned int h;
+	int i;
+
+	for (i = 0; i < (1 << LZ4_HASH_BITS); i++)
+		table[i] = -1;
+
+	while (n >= LZ4_MFLIMIT && ip < end - LZ4_MFLIMIT) {
+		h = lz4_hash(ip);
+		match = src + table[h];
+		table[h] = ip - src;
+
+		if (match < src || ip - match > LZ4_MAX_OFFSET ||
+		    memcmp(match, ip, LZ4_MINMATCH)) {
+			ip++;
+			continue;
+		}
+
+		len = LZ4_MINMATCH;
+		while (ip + len < end - LZ4_LASTLITERALS && ip[len] == match[len])
+			len++;
+
+		nlit = ip - anchor;
+		if (op + nlit + nlit / 255 + len / 255 + 8 >= dst + n)
+			return 0;
+
+		op = lz4_sequence(op, anchor, nlit, ip - match, len);
+		ip += len;
+		anchor = ip;
+	}
+
+	nlit = end - anchor;
+	if (op + nlit + nlit / 255 + 2 >= dst + n)
+		return 0;
+
+	op = lz4_sequence(op, anchor, nlit, 0, 0);
+
+	return op - dst;
+}
+
+/* Write the rest of fin as a stream of LZ4 blocks, returns its size. */
+static long write_lz4(FILE *fin, off_t off)
+{
+	unsigned char in[LZ4_BLOCK], out[LZ4_BLOCK + 4];
+	size_t bytes, n;
+	long size = 0;
+
+	while ((bytes = fread(in, 1, LZ4_BLOCK, fin))) {
+		n = lz4_compress(in, bytes, out + 4);
+		if (n) {
+			put_le32(out, n);
+		} else {
+			n = bytes;
+			put_le32(out, n | LZ4_STORED);
+			memcpy(out + 4, in, n);
+		}
+
+		if (write_bytes((char *)out, n + 4, off + size))
+			return -1;
+		size += n + 4;
+	}
+
+	return size;
+}
+
 int main(int argc, char ** argv)
 {
 	int i;
 	char buff[BUF_SIZE];
 	unsigned int osz = 0;
+	int lz4 = 0;
+
+	if (argc > 1 && !strcmp(argv[1], "-z")) {
+		lz4 = 1;
+		argc--;
+		argv++;
+	}
 
 	if (argc < 3) {
-		printf("usage <fout> <files in ...>\n");
+		printf("usage [-z] <fout> <files in ...>\n");
 		return -1;
 	}
 
@@ -88,6 +232,7 @@ int main(int argc, char ** argv)
 	{
 		FILE * fin;
 		size_t bytes = 0;
+		unsigned int start = osz;
 #if CONFIG_VERBOSE
 		printf("\t%s (0x%x)\n", argv[i], osz);
 #endif
@@ -123,6 +268,31 @@ int main(int argc, char ** argv)
 		if (write_bytes(buff, bytes, osz))
 			return -1;
 
+		if (lz4) {
+			unsigned char desc[8];
+			long size;
+
+			osz += bytes;
+			if ((size = write_lz4(fin, osz)) < 0)
+				return -1;
+
+			put_le32(desc, LZ4_MAGIC);
+			put_le32(desc + 4, size);
+			if (write_bytes((char *)desc, sizeof(desc), start + LZ4_OFFSET))
+				return -1;
+
+			/* The next header starts at a sector again. */
+			osz += size;
+			bytes = (SECTOR_SIZE - (osz & (SECTOR_SIZE - 1))) & (SECTOR_SIZE - 1);
+			memset(buff, 0, bytes);
+			if (write_bytes(buff, bytes, osz))
+				return -1;
+			osz += bytes;
+
+			fclose(fin);
+			continue;
+		}
+
 		osz += bytes;
 
 		while ((bytes = fread(buff, 1, BUF_SIZE, fin))) {
@@ -0,0 +1,249 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+
+/*
+ * Convert samples of the statistical profiler into the folded stack format
+ * consumed by flame graph tools. Each output line has the form
+ *
+ *	name[endpoint];0xcaller;...;0xcallee;0xpc count
+ *
+ * so every endpoint gets its own tower in the graph. The input is a dump
+ * of the sample ring (or a concatenation of several dumps); samples are
+ * deduplicated by their sequence number, empty slots are skipped.
+ */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Must match struct sprof_sample_s in include/nucleos/profile.h. */
+#define SPROF_PROCNAME_LEN	8
+#define SPROF_STACK_DEPTH	8
+
+#define SPROF_IDLE		0x1
+
+struct sprof_sample_s {
+	uint32_t seq;
+	int32_t endpt;
+	char name[SPROF_PROCNAME_LEN];
+	uint32_t pc;
+	uint16_t flags;
+	uint16_t depth;
+	uint32_t stack[SPROF_STACK_DEPTH];
+};
+
+#define HASH_SIZE	4096
+
+struct stack_ent {
+	struct stack_ent *next;
+	struct sprof_sample_s s;	/* representative sample */
+	unsigned long count;
+};
+
+char *progname;
+static struct stack_ent *hash_tab[HASH_SIZE];
+
+static void fatal(char *fmt, ...);
+static void usage(void);
+
+static unsigned hash_sample(struct sprof_sample_s *s)
+{
+	unsigned h = (unsigned)s->endpt * 31 + s->pc;
+	int i;
+
+	for (i = 0; i < s->depth; i++)
+		h = h * 31 + s->stack[i];
+
+	return h % HASH_SIZE;
+}
+
+static int same_stack(struct sprof_sample_s *a, struct sprof_sample_s *b)
+{
+	return a->endpt == b->endpt && a->pc == b->pc &&
+	       a->depth == b->depth &&
+	       !strncmp(a->name, b->name, SPROF_PROCNAME_LEN) &&
+	       !memcmp(a->stack, b->stack, a->depth * sizeof(a->stack[0]));
+}
+
+static void add_sample(struct sprof_sample_s *s)
+{
+	unsigned h = hash_sample(s);
+	struct stack_ent *e;
+
+	for (e = hash_tab[h]; e; e = e->next) {
+		if (same_stack(&e->s, s)) {
+			e->count++;
+			return;
+		}
+	}
+
+	if (!(e = malloc(sizeof(*e))))
+		fatal("out of memory\n");
+
+	e->s = *s;
+	e->count = 1;
+	e->next = hash_tab[h];
+	hash_tab[h] = e;
+}
+
+static int cmp_seq(const void *a, const void *b)
+{
+	const struct sprof_sample_s *sa = a, *sb = b;
+
+	return sa->seq < sb->seq ? -1 : sa->seq > sb->seq;
+}
+
+int main(int argc, char *argv[])
+{
+	int c, i, j;
+	FILE *file_in = stdin, *file_out = stdout;
+	char *in_name = 0;
+	char *out_name = 0;
+	int keep_idle = 0;
+	long endpt = 0;
+	int filter = 0;
+	struct sprof_sample_s *samples = 0;
+	size_t nr = 0, alloc = 0;
+	unsigned long lost = 0;
+	struct stack_ent *e;
+
+	(progname=strrchr(argv[0],'/')) ? progname++ : (progname=argv[0]);
+
+	while (c= getopt(argc, argv, "hi:o:e:I"), c != -1)
+	{
+		switch(c)
+		{
+		case 'h':
+			usage();
+			exit(0);
+
+		case 'i':
+			in_name = optarg;
+			break;
+
+		case 'o':
+			out_name= optarg;
+			break;
+
+		case 'e':
+			/* only this endpoint */
+			endpt = strtol(optarg, 0, 0);
+			filter = 1;
+			break;
+
+		case 'I':
+			/* emit idle samples too */
+			keep_idle = 1;
+			break;
+
+		default:
+			fatal("getopt failed: '%c'\n", c);
+		}
+	}
+
+	if (in_name && !(file_in = fopen(in_name, "rb")))
+		fatal("can't open %s: %s\n", in_name, strerror(errno));
+
+	for (;;) {
+		if (nr == alloc) {
+			alloc = alloc ? alloc * 2 : 1024;
+			samples = realloc(samples, alloc * sizeof(*samples));
+			if (!samples)
+				fatal("out of memory\n");
+		}
+
+		if (fread(&samples[nr], sizeof(*samples), 1, file_in) != 1)
+			break;
+
+		/* empty slot */
+		if (!samples[nr].seq)
+			continue;
+
+		if (samples[nr].depth > SPROF_STACK_DEPTH)
+			fatal("corrupted sample %u\n", samples[nr].seq);
+
+		nr++;
+	}
+
+	if (ferror(file_in))
+		fatal("can't read input: %s\n", strerror(errno));
+
+	qsort(samples, nr, sizeof(*samples), cmp_seq);
+
+	for (i = 0; i < nr; i++) {
+		/* duplicate from overlapping dumps */
+		if (i && samples[i].seq == samples[i-1].seq)
+			continue;
+
+		if (i && samples[i].seq != samples[i-1].seq + 1)
+			lost += samples[i].seq - samples[i-1].seq - 1;
+
+		if (filter && samples[i].endpt != endpt)
+			continue;
+
+		if ((samples[i].flags & SPROF_IDLE) && !keep_idle)
+			continue;
+
+		add_sample(&samples[i]);
+	}
+
+	if (out_name && !(file_out = fopen(out_name, "w")))
+		fatal("can't open %s: %s\n", out_name, strerror(errno));
+
+	for (i = 0; i < HASH_SIZE; i++) {
+		for (e = hash_tab[i]; e; e = e->next) {
+			fprintf(file_out, "%.*s[%d]", SPROF_PROCNAME_LEN,
+				e->s.name, e->s.endpt);
+
+			/* outermost frame first */
+			for (j = e->s.depth - 1; j >= 0; j--)
+				fprintf(file_out, ";0x%x", e->s.stack[j]);
+
+			fprintf(file_out, ";0x%x %lu\n", e->s.pc, e->count);
+		}
+	}
+
+	if (lost)
+		fprintf(stderr, "%s: %lu samples lost\n", progname, lost);
+
+	if (file_out != stdout)
+		fclose(file_out);
+
+	if (file_in != stdin)
+		fclose(file_in);
+
+	return 0;
+}
+
+static void fatal(char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(stderr, "%s: ", progname);
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+
+	exit(1);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: %s [-h] [-I] [-e endpoint] [-i samples] [-o output]\n", progname);
+	fprintf(stderr, "  -h: print this help\n");
+	fprintf(stderr, "  -I: include samples of the idle process\n");
+	fprintf(stderr, "  -e: only samples of the given endpoint\n");
+	fprintf(stderr, "  -i: sample ring dump (default stdin)\n");
+	fprintf(stderr, "  -o: folded stacks output (default stdout)\n");
+}
@@ -11,12 +11,23 @@
 
 #include "inc.h"
 
-/* Allocate space for the data store. */
+/* Allocate space for the data store. The first chunk of slots is static,
+ * more chunks are allocated as the store fills up. Slots are never freed.
+ */
 static struct data_store ds_store[NR_DS_KEYS];
+static struct data_store *ds_chunks[NR_DS_CHUNKS] = { ds_store };
+static struct data_store *ds_hash[NR_DS_HASH];
 static struct subscription ds_subs[NR_DS_SUBS];
+static struct sub_node ds_sub_root;
 static int nr_in_use;
 
+#define ds_slot(i)	(&ds_chunks[(i) / NR_DS_KEYS][(i) % NR_DS_KEYS])
+
+static unsigned hash_key(char *key);
 static int find_key(char *key, struct data_store **dsp, int t);
+static struct data_store *new_key(char *key, int flags);
+static int sub_literal(char *pattern, int *match);
+static struct sub_node *sub_node(char *prefix, int len);
 static int set_owner(struct data_store *dsp, int auth);
 static int is_authorized(struct data_store *dsp, int auth);
 static void check_subscribers(struct data_store *dsp);
@@ -39,6 +50,10 @@ void ds_init(void)
 	}
 	for(i = 0; i < NR_DS_SUBS; i++)
 		ds_subs[i].sub_flags = 0;
+	for(i = 0; i < NR_DS_HASH; i++)
+		ds_hash[i] = NULL;
+	ds_sub_root.sn_child = NULL;
+	ds_sub_root.sn_subs = -1;
 
 	return;
 }
@@ -60,19 +75,31 @@ int ap;						/* authorization value */
 }
 
 
+static unsigned hash_key(key_name)
+char *key_name;
+{
+  unsigned h = 0;
+
+  while (*key_name)
+	h = h * 31 + (unsigned char) *key_name++;
+
+  return(h & (NR_DS_HASH - 1));
+}
+
+
 static int find_key(key_name, dsp, type)
 char *key_name;					/* key to look up */
 struct data_store **dsp;			/* store pointer here */
 int type;					/* type info */
 {
-  register int i;
+  register struct data_store *p;
 
+  /* Only slots in use are hashed. */
   *dsp = NULL;
-  for (i=0; i<NR_DS_KEYS; i++) {
-      if ((ds_store[i].ds_flags & DS_IN_USE)		/* valid slot? */
-      &&  ((ds_store[i].ds_flags & type) == type)	/* right type? */
-      && !strcmp(ds_store[i].ds_key, key_name)) {	/* matching name? */
-          *dsp = &ds_store[i];
+  for (p = ds_hash[hash_key(key_name)]; p != NULL; p = p->ds_hnext) {
+      if (((p->ds_flags & type) == type)		/* right type? */
+      && !strcmp(p->ds_key, key_name)) {		/* matching name? */
+          *dsp = p;
           return(TRUE);                         /* report success */
       }
   }
@@ -81,6 +108,35 @@ int type;					/* type info */
 }
 
 
+static struct data_store *new_key(key_name, flags)
+char *key_name;					/* key of the new item */
+int flags;					/* its flags */
+{
+  struct data_store *dsp, **head;
+  int c = nr_in_use / NR_DS_KEYS;
+
+  /* Allocate the next chunk of slots if the last one is full. */
+  if (c >= NR_DS_CHUNKS) return(NULL);
+  if (ds_chunks[c] == NULL) {
+	ds_chunks[c] = malloc(NR_DS_KEYS * sizeof(struct data_store));
+	if (ds_chunks[c] == NULL) return(NULL);
+	memset(ds_chunks[c], 0, NR_DS_KEYS * sizeof(struct data_store));
+  }
+
+  dsp = ds_slot(nr_in_use);
+  nr_in_use++;
+
+  strcpy(dsp->ds_key, key_name);
+  dsp->ds_flags = DS_IN_USE | flags;
+
+  head = &ds_hash[hash_key(key_name)];
+  dsp->ds_hnext = *head;
+  *head = dsp;
+
+  return(dsp);
+}
+
+
 int do_publish(m_ptr)
 kipc_msg_t *m_ptr;					/* request message */
 {
@@ -118,14 +174,8 @@ kipc_msg_t *m_ptr;					/* request message */
 
   /* See if it already exists. */
   if (!find_key(key_name, &dsp, type)) {		/* look up key */
-      if (nr_in_use >= NR_DS_KEYS) {
+      if ((dsp = new_key(key_name, m_ptr->DS_FLAGS)) == NULL)
           return(-EAGAIN);                               /* store is full */
-      } else {
-          dsp = &ds_store[nr_in_use];                   /* new slot found */
-	  strcpy(dsp->ds_key, key_name);
-	  dsp->ds_flags = DS_IN_USE | m_ptr->DS_FLAGS;	/* initialize slot */
-          nr_in_use ++;
-      }
   }
 
   /* At this point we have a data store pointer and know the caller is 
@@ -244,51 +294,47 @@ kipc_msg_t *m_ptr;					/* request message */
 			continue;
 		if(m_ptr->m_source != ds_subs[s].sub_owner)
 			continue;
-		for(d = 0;  d < NR_DS_KEYS; d++) {
-			
-			/* No match if this is no value, it's
-			 * not flagged, or the type is wrong.
-			 */
+		for(d = 0;  d < nr_in_use; d++) {
+			dsp = ds_slot(d);
 
-			if(!(ds_store[d].ds_flags & DS_IN_USE))
-				continue;
-			if(!GET_BIT(ds_store[d].ds_old_subs, s))
+			/* No match if it's not flagged, or the type
+			 * is wrong.
+			 */
+			if(!GET_BIT(dsp->ds_old_subs, s))
 				continue;
-			if(type != (ds_store[d].ds_flags & DS_TYPE_MASK))
+			if(type != (dsp->ds_flags & DS_TYPE_MASK))
 				continue;
 
 			/* We have a match. Unflag it for this
 			 * subscription.
 			 */
-			UNSET_BIT(ds_store[d].ds_old_subs, s);
-			len = strlen(ds_store[d].ds_key)+1;
+			UNSET_BIT(dsp->ds_old_subs, s);
+			len = strlen(dsp->ds_key)+1;
 			if(len > m_ptr->DS_KEY_LEN) 
 				len = m_ptr->DS_KEY_LEN;
 
 			/* Copy the key into client. */
   			if ((r=sys_safecopyto(m_ptr->m_source,
 				(cp_grant_id_t) m_ptr->DS_KEY_GRANT, 0,
-				(vir_bytes) ds_store[d].ds_key,
+				(vir_bytes) dsp->ds_key,
 				len, D)) != 0)
 				return r;
 
 			/* Now copy the value. */
 			switch(type) {
 				case DS_TYPE_STR:
-					len = strlen(ds_store[d].
-						ds_val.ds_val_str)+1;
+					len = strlen(dsp->ds_val.ds_val_str)+1;
 					if(len > m_ptr->DS_VAL_LEN)
 						len = m_ptr->DS_VAL_LEN;
   					if ((r=sys_safecopyto(m_ptr->m_source,
 						m_ptr->DS_VAL, 0,
-						(vir_bytes) ds_store[d].
-						  ds_val.ds_val_str,
+						(vir_bytes) dsp->ds_val.ds_val_str,
 						len, D)) != 0)
 						return r;
 					break;
 				case DS_TYPE_U32:
 					m_ptr->DS_VAL =
-						ds_store[d].ds_val.ds_val_u32;
+						dsp->ds_val.ds_val_u32;
 					break;
 				default:
           				panic(__FILE__,
@@ -307,7 +353,9 @@ int do_subscribe(m_ptr)
 kipc_msg_t *m_ptr;					/* request message */
 {
   char regex[DS_MAX_KEYLEN+3];
-  int s, type, e, d, n = 0;
+  int s, type, e, d, n = 0, len, match;
+  struct sub_node *np;
+  struct data_store *dsp;
   char errbuf[80];
 
   /* Subscribe to a key of interest.
@@ -331,6 +379,7 @@ kipc_msg_t *m_ptr;					/* request message */
   }
 
   regex[DS_MAX_KEYLEN-1] = '\0';
+  len = sub_literal(regex + 1, &match);
   strcat(regex, "$");
 
   /* Find subscription slot. */
@@ -349,18 +398,27 @@ kipc_msg_t *m_ptr;					/* request message */
 	printk("DS: subscribe: regerror: %s\n", errbuf);
 	return -EINVAL;
   }
+
+  /* Hang it into the trie under its literal prefix. */
+  if((np = sub_node(regex + 1, len)) == NULL) {
+	regfree(&ds_subs[s].sub_regex);
+	return -ENOMEM;
+  }
+  ds_subs[s].sub_match = match;
+  ds_subs[s].sub_next = np->sn_subs;
+  np->sn_subs = s;
+
   type = (m_ptr->DS_FLAGS & DS_TYPE_MASK);
   ds_subs[s].sub_flags = DS_IN_USE | type;
   ds_subs[s].sub_owner = m_ptr->m_source;
 
   /* Caller requested an instant initial list? */
   if(m_ptr->DS_FLAGS & DS_INITIAL) {
-	for(d = 0; d < NR_DS_KEYS; d++) {
-	  if(!(ds_store[d].ds_flags & DS_IN_USE))
-	     continue;
-	  if(regexec(&ds_subs[s].sub_regex, ds_store[d].ds_key,
+	for(d = 0; d < nr_in_use; d++) {
+	  dsp = ds_slot(d);
+	  if(regexec(&ds_subs[s].sub_regex, dsp->ds_key,
 		0, NULL, 0) == 0) {
-		SET_BIT(ds_store[d].ds_old_subs, s);
+		SET_BIT(dsp->ds_old_subs, s);
 		n = 1;
 	  }
       }
@@ -404,6 +462,71 @@ kipc_msg_t *m_ptr;
   return 0;
 }
 
+/*===========================================================================*
+ *				sub_literal				     *
+ *===========================================================================*/
+static int
+sub_literal(char *pattern, int *match)
+{
+/* Return the length of the literal prefix all keys matching pattern start
+ * with, and set *match to how the remainder is matched.
+ */
+	int len;
+
+	len = strcspn(pattern, ".[]()*+?{}|^$\\");
+	if(pattern[len] == '\0') {
+		*match = DS_SUB_EXACT;
+		return len;
+	}
+	if(!strcmp(&pattern[len], ".*")) {
+		*match = DS_SUB_PREFIX;
+		return len;
+	}
+
+	*match = DS_SUB_REGEX;
+
+	/* An alternative may start with anything. */
+	if(strchr(pattern, '|'))
+		return 0;
+
+	/* A quantifier makes the last literal character optional. */
+	if(len > 0 && strchr("*?{", pattern[len]))
+		len--;
+
+	return len;
+}
+
+/*===========================================================================*
+ *				sub_node				     *
+ *===========================================================================*/
+static struct sub_node *
+sub_node(char *prefix, int len)
+{
+/* Find the trie node for the first len characters of prefix, creating
+ * the missing part of the path.
+ */
+	struct sub_node *np = &ds_sub_root, *cp;
+	int i;
+
+	for(i = 0; i < len; i++) {
+		for(cp = np->sn_child; cp; cp = cp->sn_sibling)
+			if(cp->sn_char == prefix[i])
+				break;
+		if(!cp) {
+			if(!(cp = malloc(sizeof(*cp))))
+				return NULL;
+			cp->sn_char = prefix[i];
+			cp->sn_child = NULL;
+			cp->sn_subs = -1;
+			cp->sn_sibling = np->sn_child;
+			np->sn_child = cp;
+		}
+		np = cp;
+	}
+
+	return np;
+}
+
 /*===========================================================================*
  *				check_subscribers			     *
  *===========================================================================*/
@@ -412,19 +535,41 @@ check_subscribers(struct data_store *dsp)
 {
 /* Send subscribers whose subscriptions match this (new
  * or updated) data item a notify(), and flag the subscriptions
- * as updated.
+ * as updated. Only the subscriptions on the trie path spelled by
+ * the key can match. The key of an item never changes, so neither
+ * does the set of subscriptions that match it.
  */
-	int i;
-	for(i = 0; i < NR_DS_SUBS; i++) {
-		if(ds_subs[i].sub_flags & DS_IN_USE) {
-			if(regexec(&ds_subs[i].sub_regex, dsp->ds_key, 
-				0, NULL, 0) == 0) {
-				SET_BIT(dsp->ds_old_subs, i);
-				kipc_module_call(KIPC_NOTIFY, 0, ds_subs[i].sub_owner, 0);
-			} else {
-				UNSET_BIT(dsp->ds_old_subs, i);
+	struct sub_node *np = &ds_sub_root;
+	char *k = dsp->ds_key;
+	int s, m;
+
+	for(;;) {
+		for(s = np->sn_subs; s != -1; s = ds_subs[s].sub_next) {
+			switch(ds_subs[s].sub_match) {
+			case DS_SUB_EXACT:
+				m = (*k == '\0');
+				break;
+			case DS_SUB_PREFIX:
+				m = 1;
+				break;
+			default:
+				m = (regexec(&ds_subs[s].sub_regex,
+					dsp->ds_key, 0, NULL, 0) == 0);
+				break;
+			}
+			if(m) {
+				SET_BIT(dsp->ds_old_subs, s);
+				kipc_module_call(KIPC_NOTIFY, 0, ds_subs[s].sub_owner, 0);
 			}
-		} 
+		}
+
+		if(*k == '\0')
+			break;
+		for(np = np->sn_child; np; np = np->sn_sibling)
+			if(np->sn_char == *k)
+				break;
+		if(!np)
+			break;
+		k++;
 	}
 }
-
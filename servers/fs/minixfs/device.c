@@ -14,9 +14,12 @@
 #include <nucleos/com.h>
 #include <nucleos/endpoint.h>
 #include <nucleos/ioctl.h>
+#include <asm/ioctls.h>
 #include <nucleos/safecopies.h>
 #include <nucleos/u64.h>
 #include <nucleos/string.h>
+#include <nucleos/dmap.h>
+#include <nucleos/ramdisk.h>
 #include <servers/fs/minixfs/inode.h>
 #include <servers/fs/minixfs/super.h>
 #include <servers/fs/minixfs/const.h>
@@ -35,6 +38,16 @@ static int gen_opcl(endpoint_t driver_e, int op,
 				 dev_t dev, int proc_e, int flags);
 static int gen_io(int task_nr, kipc_msg_t *mess_ptr);
 
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+/* RAM disk mapped into our address space by the memory driver. */
+static dev_t ram_dev = NO_DEV;
+static char *ram_base;
+static size_t ram_size;
+
+static void ram_map(endpoint_t driver_e, dev_t dev);
+static int ram_io(int op, void *buf, u64_t pos, int bytes);
+#endif
+
 
 /*===========================================================================*
  *				fs_new_driver   			     *
@@ -181,6 +194,11 @@ int flags;			/* special flags, like O_NONBLOCK */
 
   STATICINIT(gids, NR_IOREQS);
 
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+  if (dev == ram_dev && proc_e == SELF_E)
+	return ram_io(op, buf, pos, bytes);
+#endif
+
   /* Determine driver endpoint for this device */
   driver_e = driver_endpoints[(dev >> MAJOR) & BYTE].driver_e;
   
@@ -281,6 +299,12 @@ int flags;			/* mode bits and flags */
   if (major >= NR_DEVICES) major = 0;
   r = gen_opcl(driver_e, DEV_OPEN, dev, proc, flags);
   if (r == SUSPEND) panic(__FILE__,"suspend on open from", NO_NUM);
+
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+  if (r == 0 && major == MEMORY_MAJOR && ram_dev == NO_DEV)
+	ram_map(driver_e, dev);
+#endif
+
   return(r);
 }
 
@@ -292,10 +316,103 @@ void dev_close(driver_e, dev)
 endpoint_t driver_e;
 dev_t dev;			/* device to close */
 {
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+  /* The memory driver unmaps it on the last close. */
+  if (dev == ram_dev)
+	ram_dev = NO_DEV;
+#endif
+
   (void) gen_opcl(driver_e, DEV_CLOSE, dev, 0, 0);
 }
 
 
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+/*===========================================================================*
+ *				ram_map					     *
+ *===========================================================================*/
+static void ram_map(driver_e, dev)
+endpoint_t driver_e;
+dev_t dev;			/* RAM disk just opened */
+{
+/* Ask the memory driver to map a RAM disk into our address space, so that
+ * blocks can be copied without a message to the driver. Devices that can't
+ * be mapped (e.g. /dev/imgrd) simply keep going through the driver.
+ */
+  struct rammap rm;
+  kipc_msg_t m;
+  cp_grant_id_t gid;
+
+  gid = cpf_grant_direct(driver_e, (vir_bytes) &rm, sizeof(rm), CPF_WRITE);
+  if (gid == GRANT_INVALID)
+	return;
+
+  m.m_type   = DEV_IOCTL_S;
+  m.DEVICE   = (dev >> MINOR) & BYTE;
+  m.REQUEST  = MIOCRAMMAP;
+  m.IO_ENDPT = SELF_E;
+  m.IO_GRANT = (char *) gid;
+
+  if (gen_io(driver_e, &m) == 0 && m.REP_STATUS == 0) {
+	ram_dev = dev;
+	ram_base = (char *) rm.rm_base;
+	ram_size = rm.rm_size;
+  }
+
+  cpf_revoke(gid);
+}
+
+
+/*===========================================================================*
+ *				ram_io					     *
+ *===========================================================================*/
+static int ram_io(op, buf, pos, bytes)
+int op;				/* MFS_DEV_READ, MFS_DEV_WRITE, etc. */
+void *buf;			/* buffer or io vector */
+u64_t pos;			/* byte position */
+int bytes;			/* bytes or io vector elements */
+{
+/* Transfer to or from the mapped RAM disk, the way the driver would. */
+  iovec_t *iov;
+  unsigned long position;
+  size_t count;
+  int i;
+
+  if (ex64hi(pos) != 0 || ex64lo(pos) >= ram_size)
+	return 0;	/* EOF */
+  position = ex64lo(pos);
+
+  switch (op) {
+  case MFS_DEV_READ:
+  case MFS_DEV_WRITE:
+	count = bytes;
+	if (position + count > ram_size) count = ram_size - position;
+	if (op == MFS_DEV_READ)
+		memcpy(buf, ram_base + position, count);
+	else
+		memcpy(ram_base + position, buf, count);
+	return count;
+
+  case MFS_DEV_GATHER:
+  case MFS_DEV_SCATTER:
+	iov = (iovec_t *) buf;
+	for (i = 0; i < bytes && position < ram_size; i++, iov++) {
+		count = iov->iov_size;
+		if (position + count > ram_size) count = ram_size - position;
+		if (op == MFS_DEV_GATHER)
+			memcpy((void *) iov->iov_addr, ram_base + position, count);
+		else
+			memcpy(ram_base + position, (void *) iov->iov_addr, count);
+		position += count;
+		iov->iov_size -= count;
+	}
+	return 0;
+  }
+
+  return(-EINVAL);
+}
+#endif
+
+
 /*===========================================================================*
  *				gen_opcl				     *
  *===========================================================================*/
@@ -1,9 +1,10 @@
 /* Buffer (block) cache.  
  */
+#include <servers/fs/pipe.h>
 
 struct buf {
   /* Data portion of the buffer. */
-  char b_data[PIPE_BUF];     /* ordinary user data */
+  char b_data[PIPE_SIZE];     /* ring of user data, see pipe.h */
 
   /* Header portion of the buffer. */
   struct buf *b_next;           /* used to link all free bufs in a chain */
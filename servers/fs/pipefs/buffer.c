@@ -62,7 +62,7 @@ ino_t inum;
   bp->b_dev = dev;
   bp->b_bytes = 0;
   bp->b_count = 1;
-  memset(bp->b_data, 0 , PIPE_BUF);
+  /* No need to clear b_data, only bytes written to the pipe are read. */
   
   /* Add at the end of the buffer */
   if (front == NIL_BUF) {	/* Empty list? */
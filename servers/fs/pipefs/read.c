@@ -5,6 +5,9 @@
 #include <nucleos/u64.h>
 #include "inode.h"
 
+static int pipe_copy(int rw_flag, cp_grant_id_t gid, struct buf *bp,
+	off_t position, unsigned int nrbytes);
+
 
 /*===========================================================================*
  *				fs_readwrite				     *
@@ -15,7 +18,7 @@ int fs_readwrite(void)
   block_t b;
   struct buf *bp;
   cp_grant_id_t gid;
-  off_t position, f_size;
+  off_t position;
   unsigned int nrbytes, cum_io;
   mode_t mode_word;
   struct pipe_inode *rip;
@@ -34,7 +37,6 @@ int fs_readwrite(void)
 
   mode_word = rip->i_mode & I_TYPE;
   if (mode_word != I_NAMED_PIPE) return(-EIO);
-  f_size = rip->i_size;
   
   /* Get the values from the request message */ 
   rw_flag = (fs_m_in.m_type == REQ_READ ? READING : WRITING);
@@ -42,24 +44,14 @@ int fs_readwrite(void)
   position = fs_m_in.REQ_SEEK_POS_LO;
   nrbytes = (unsigned) fs_m_in.REQ_NBYTES;
   
-  if (rw_flag == WRITING) {
-	  /* Check in advance to see if file will grow too big. */
-	  if (position > PIPE_BUF - nrbytes) return(-EFBIG);
-  }
+  /* VFS never lets the writer get more than PIPE_SIZE ahead. */
+  if (nrbytes > PIPE_SIZE) return(-EFBIG);
 
   /* Mark inode in use */
   if ((get_inode(rip->i_dev, rip->i_num)) == NIL_INODE) return(err_code);
   if ((bp = get_block(rip->i_dev, rip->i_num)) == NIL_BUF) return(err_code);
 
-  if (rw_flag == READING) {
-	/* Copy a chunk from the block buffer to user space. */
-	r = sys_safecopyto(VFS_PROC_NR, gid, 0,
-		(vir_bytes) (bp->b_data+position), (phys_bytes) nrbytes, D);
-  } else {
-	/* Copy a chunk from user space to the block buffer. */
-	r = sys_safecopyfrom(VFS_PROC_NR, gid, 0,
-		(vir_bytes) (bp->b_data+position), (phys_bytes) nrbytes, D);
-  }
+  r = pipe_copy(rw_flag, gid, bp, position, nrbytes);
 
   if (r == 0) {
 	position += nrbytes; /* Update position */
@@ -69,9 +61,11 @@ int fs_readwrite(void)
   fs_m_out.RES_SEEK_POS_LO = position; /* It might change later and the VFS
 					   has to know this value */
   
-  /* On write, update file size and access time. */
+  /* On write, update file size and access time. The write position is
+   * the end of the data, VFS may have moved it down by PIPE_SIZE.
+   */
   if (rw_flag == WRITING) {
-	  if (position > f_size) rip->i_size = position;
+	  rip->i_size = position;
   } else {
 	if(position >= rip->i_size) {
 		/* All data in the pipe is read, so reset pipe pointers */
@@ -90,3 +84,44 @@ int fs_readwrite(void)
   return(r);
 }
 
+
+
+/*===========================================================================*
+ *				pipe_copy				     *
+ *===========================================================================*/
+static int pipe_copy(rw_flag, gid, bp, position, nrbytes)
+int rw_flag;
+cp_grant_id_t gid;
+struct buf *bp;
+off_t position;
+unsigned int nrbytes;
+{
+/* Copy between the grant and the ring of the pipe. A chunk crossing the end
+ * of the ring is split into two copies.
+ */
+  unsigned int off, chunk;
+  vir_bytes offset = 0;
+  int r = 0;
+
+  off = position % PIPE_SIZE;
+
+  while (nrbytes > 0 && r == 0) {
+	chunk = MIN(nrbytes, PIPE_SIZE - off);
+
+	if (rw_flag == READING) {
+		/* Copy a chunk from the ring to user space. */
+		r = sys_safecopyto(VFS_PROC_NR, gid, offset,
+			(vir_bytes) (bp->b_data+off), (phys_bytes) chunk, D);
+	} else {
+		/* Copy a chunk from user space to the ring. */
+		r = sys_safecopyfrom(VFS_PROC_NR, gid, offset,
+			(vir_bytes) (bp->b_data+off), (phys_bytes) chunk, D);
+	}
+
+	offset += chunk;
+	nrbytes -= chunk;
+	off = 0;
+  }
+
+  return(r);
+}
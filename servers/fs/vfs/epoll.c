@@ -0,0 +1,640 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+/* Implement persistent interest lists (epoll).
+ *
+ * Unlike select(), which hands the whole fd set to VFS on every call, the
+ * descriptors are registered once with epoll_ctl() and stay registered.
+ * Drivers and pipes report readiness through select_notified() and
+ * select_callback(), which put the matching items on the ready list of
+ * their instance, so a wakeup costs O(ready) instead of O(watched fds).
+ *
+ * Items that were reported are moved to the check list and queried again
+ * on the next epoll_wait(). A level triggered item that is still ready goes
+ * back to the ready list. An edge triggered one on a pipe arms the pipe for
+ * its next read or write and stays quiet until then; drivers only report
+ * transitions to ready, so an edge triggered device that is still ready is
+ * reported again rather than missing data that arrives later. If the query
+ * finds the item not ready, it arms the driver (SEL_NOTIFY) or pipe and
+ * leaves the check list.
+ *
+ * The entry points into this file are
+ *   do_epoll_create:	perform the EPOLL_CREATE system call
+ *   do_epoll_ctl:	perform the EPOLL_CTL system call
+ *   do_epoll_wait:	perform the EPOLL_WAIT system call
+ *   epoll_callback:	a filp became ready (from select_callback)
+ *   epoll_notified:	a device became ready (from select_notified)
+ *   epoll_close_fd:	drop the items of a descriptor being closed
+ *   epoll_forget:	cancel a blocking epoll_wait()
+ *   epoll_exit:	release the instances of an exiting process
+ *   init_epoll:	initialize the epoll tables
+ */
+#include "fs.h"
+#include "select.h"
+#include "file.h"
+#include "vnode.h"
+#include "epoll.h"
+#include <servers/fs/vfs/fproc.h>
+
+#include <nucleos/com.h>
+#include <nucleos/string.h>
+
+#define EP_DEV_HASH	32	/* device hash chains */
+#define EP_BATCH	16	/* events copied out at once */
+
+static struct epoll eptab[NR_EPOLLS];
+static struct epitem epitems[NR_EPITEMS];
+static struct epitem *ep_free;			/* free items */
+static struct epitem *ep_devhash[EP_DEV_HASH];	/* items by v_sdev */
+
+static struct epoll *get_epoll(int epfd);
+static struct epitem *ep_lookup(struct epoll *ep, struct filp *f, int fd);
+static struct epitem *ep_add(struct epoll *ep, struct filp *f, int fd,
+			     int type);
+static void ep_remove(struct epitem *ei);
+static void ep_release(struct epoll *ep);
+static void ep_set(struct epitem *ei, struct epoll_event *ev);
+static int ep_query(struct epitem *ei);
+static void ep_ready(struct epitem *ei, int ops);
+static void ep_check(struct epitem *ei);
+static void ep_dequeue(struct epitem *ei);
+static void ep_rescan(struct epoll *ep);
+static int ep_collect(struct epoll *ep, endpoint_t who_e, vir_bytes uevents,
+		      int maxevents);
+static void ep_wakeup(struct epoll *ep);
+static void ep_cancel_wait(struct epoll *ep);
+static void epoll_timeout_check(timer_t *timer);
+
+#define dev_hash(dev)	(&ep_devhash[(dev) % EP_DEV_HASH])
+
+/*===========================================================================*
+ *				do_epoll_create				     *
+ *===========================================================================*/
+int do_epoll_create(void)
+{
+  struct epoll *ep;
+
+  for (ep = &eptab[0]; ep < &eptab[NR_EPOLLS]; ep++)
+	if (ep->ep_owner == NULL)
+		break;
+  if (ep >= &eptab[NR_EPOLLS]) return(-ENFILE);
+
+  ep->ep_owner = fp;
+  ep->ep_items = NULL;
+  ep->ep_ready = ep->ep_ready_tail = NULL;
+  ep->ep_check = NULL;
+  ep->ep_waiting = 0;
+  ep->ep_expiry = 0;
+
+  return(ep - eptab);
+}
+
+
+/*===========================================================================*
+ *				do_epoll_ctl				     *
+ *===========================================================================*/
+int do_epoll_ctl(void)
+{
+  struct epoll *ep;
+  struct epitem *ei;
+  struct filp *f;
+  struct epoll_event ev;
+  int r, type;
+
+  if ((ep = get_epoll(m_in.EP_FD)) == NULL) return(err_code);
+
+  if (m_in.EP_OP == EPOLL_CTL_CLOSE) {
+	ep_release(ep);
+	return(0);
+  }
+
+  if ((f = get_filp(m_in.EP_TFD)) == NIL_FILP) return(err_code);
+  ei = ep_lookup(ep, f, m_in.EP_TFD);
+
+  if (m_in.EP_OP == EPOLL_CTL_ADD || m_in.EP_OP == EPOLL_CTL_MOD) {
+	r = sys_vircopy(who_e, D, (vir_bytes) m_in.EP_EVENT, ENDPT_SELF, D,
+			(vir_bytes) &ev, sizeof(ev));
+	if (r != 0) return(r);
+  }
+
+  switch (m_in.EP_OP) {
+  case EPOLL_CTL_ADD:
+	if (ei != NULL) return(-EEXIST);
+	if ((type = select_filp_type(f)) < 0) return(-EPERM);
+	if ((ei = ep_add(ep, f, m_in.EP_TFD, type)) == NULL) return(-ENOSPC);
+	ep_set(ei, &ev);
+	break;
+
+  case EPOLL_CTL_MOD:
+	if (ei == NULL) return(-ENOENT);
+	ep_dequeue(ei);
+	ep_set(ei, &ev);
+	break;
+
+  case EPOLL_CTL_DEL:
+	if (ei == NULL) return(-ENOENT);
+	ep_remove(ei);
+	break;
+
+  default:
+	return(-EINVAL);
+  }
+
+  return(0);
+}
+
+
+/*===========================================================================*
+ *				do_epoll_wait				     *
+ *===========================================================================*/
+int do_epoll_wait(void)
+{
+  struct epoll *ep;
+  int maxevents, timeout, ticks;
+
+  if ((ep = get_epoll(m_in.EP_FD)) == NULL) return(err_code);
+
+  maxevents = m_in.EP_MAXEVENTS;
+  timeout = m_in.EP_TIMEOUT;
+  if (maxevents <= 0) return(-EINVAL);
+
+  /* Query the items reported last time before deciding to block. */
+  ep_rescan(ep);
+
+  if (ep->ep_ready != NULL || timeout == 0)
+	return(ep_collect(ep, who_e, (vir_bytes) m_in.EP_EVENTS, maxevents));
+
+  ep->ep_uevents = (vir_bytes) m_in.EP_EVENTS;
+  ep->ep_maxevents = maxevents;
+  ep->ep_waiting = 1;
+
+  if (timeout > 0) {
+	/* Round up to the next tick, like select() does. */
+	ticks = (timeout * system_hz + 999) / 1000;
+	fs_set_timer(&ep->ep_timer, ticks, epoll_timeout_check, ep - eptab);
+	ep->ep_expiry = 1;
+  }
+
+  suspend(FP_BLOCKED_ON_EPOLL);
+  return(SUSPEND);
+}
+
+
+/*===========================================================================*
+ *				epoll_callback				     *
+ *===========================================================================*/
+void epoll_callback(struct filp *f, int ops)
+{
+/* Filp f is available for operations 'ops'. Only the items watching f are
+ * visited.
+ */
+  struct epitem *ei;
+
+  for (ei = f->filp_epitems; ei != NULL; ei = ei->ei_filp_next) {
+	if (!(ops & ei->ei_ops) || (ei->ei_flags & EI_DISABLED))
+		continue;
+	ep_ready(ei, ops & ei->ei_ops);
+	ep_wakeup(ei->ei_ep);
+  }
+}
+
+
+/*===========================================================================*
+ *				epoll_notified				     *
+ *===========================================================================*/
+void epoll_notified(int major, int minor, int ops)
+{
+/* A driver reports that device (major, minor) is available for 'ops'. */
+  struct epitem *ei;
+  dev_t dev;
+
+  dev = (major << MAJOR) | (minor << MINOR);
+
+  for (ei = *dev_hash(dev); ei != NULL; ei = ei->ei_dev_next) {
+	if (ei->ei_filp->filp_vno->v_sdev != dev)
+		continue;
+	if (!(ops & ei->ei_ops) || (ei->ei_flags & EI_DISABLED))
+		continue;
+	ep_ready(ei, ops & ei->ei_ops);
+	ep_wakeup(ei->ei_ep);
+  }
+}
+
+
+/*===========================================================================*
+ *				epoll_close_fd				     *
+ *===========================================================================*/
+void epoll_close_fd(struct fproc *rfp, int fd_nr, struct filp *f)
+{
+/* Descriptor fd_nr of rfp, referring to f, is being closed. */
+  struct epitem *ei, *next;
+
+  for (ei = f->filp_epitems; ei != NULL; ei = next) {
+	next = ei->ei_filp_next;
+	if (ei->ei_ep->ep_owner == rfp && ei->ei_fd == fd_nr)
+		ep_remove(ei);
+  }
+}
+
+
+/*===========================================================================*
+ *				epoll_forget				     *
+ *===========================================================================*/
+void epoll_forget(endpoint_t proc_e)
+{
+/* The epoll_wait() of proc_e is interrupted, e.g. by a signal. */
+  struct epoll *ep;
+
+  for (ep = &eptab[0]; ep < &eptab[NR_EPOLLS]; ep++) {
+	if (ep->ep_owner != NULL && ep->ep_waiting &&
+	    ep->ep_owner->fp_endpoint == proc_e) {
+		ep_cancel_wait(ep);
+		return;
+	}
+  }
+}
+
+
+/*===========================================================================*
+ *				epoll_exit				     *
+ *===========================================================================*/
+void epoll_exit(struct fproc *rfp)
+{
+  struct epoll *ep;
+
+  for (ep = &eptab[0]; ep < &eptab[NR_EPOLLS]; ep++)
+	if (ep->ep_owner == rfp)
+		ep_release(ep);
+}
+
+
+/*===========================================================================*
+ *				init_epoll				     *
+ *===========================================================================*/
+void init_epoll(void)
+{
+  struct epoll *ep;
+  struct epitem *ei;
+
+  for (ep = &eptab[0]; ep < &eptab[NR_EPOLLS]; ep++)
+	fs_init_timer(&ep->ep_timer);
+
+  ep_free = NULL;
+  for (ei = &epitems[NR_EPITEMS - 1]; ei >= &epitems[0]; ei--) {
+	ei->ei_ep = NULL;
+	ei->ei_next = ep_free;
+	ep_free = ei;
+  }
+}
+
+
+/*===========================================================================*
+ *				get_epoll				     *
+ *===========================================================================*/
+static struct epoll *get_epoll(int epfd)
+{
+/* Instances are private to the process that created them. */
+  if (epfd < 0 || epfd >= NR_EPOLLS || eptab[epfd].ep_owner != fp) {
+	err_code = -EBADF;
+	return(NULL);
+  }
+
+  return(&eptab[epfd]);
+}
+
+
+/*===========================================================================*
+ *				ep_lookup				     *
+ *===========================================================================*/
+static struct epitem *ep_lookup(struct epoll *ep, struct filp *f, int fd)
+{
+  struct epitem *ei;
+
+  for (ei = f->filp_epitems; ei != NULL; ei = ei->ei_filp_next)
+	if (ei->ei_ep == ep && ei->ei_fd == fd)
+		return(ei);
+
+  return(NULL);
+}
+
+
+/*===========================================================================*
+ *				ep_add					     *
+ *===========================================================================*/
+static struct epitem *ep_add(struct epoll *ep, struct filp *f, int fd,
+			     int type)
+{
+  struct epitem *ei, **head;
+  struct vnode *vp = f->filp_vno;
+
+  if ((ei = ep_free) == NULL) return(NULL);
+  ep_free = ei->ei_next;
+
+  ei->ei_ep = ep;
+  ei->ei_filp = f;
+  ei->ei_fd = fd;
+  ei->ei_type = type;
+  ei->ei_ops = 0;
+  ei->ei_revents = 0;
+  ei->ei_flags = 0;
+  ei->ei_rnext = NULL;
+
+  ei->ei_next = ep->ep_items;
+  ep->ep_items = ei;
+
+  ei->ei_filp_next = f->filp_epitems;
+  f->filp_epitems = ei;
+
+  ei->ei_dev_next = NULL;
+  if ((vp->v_mode & I_TYPE) == I_CHAR_SPECIAL) {
+	head = dev_hash(vp->v_sdev);
+	ei->ei_dev_next = *head;
+	*head = ei;
+  }
+
+  return(ei);
+}
+
+
+/*===========================================================================*
+ *				ep_remove				     *
+ *===========================================================================*/
+static void ep_remove(struct epitem *ei)
+{
+  struct epitem **pp;
+  struct vnode *vp = ei->ei_filp->filp_vno;
+
+  ep_dequeue(ei);
+
+  for (pp = &ei->ei_ep->ep_items; *pp != ei; pp = &(*pp)->ei_next)
+	;
+  *pp = ei->ei_next;
+
+  for (pp = &ei->ei_filp->filp_epitems; *pp != ei; pp = &(*pp)->ei_filp_next)
+	;
+  *pp = ei->ei_filp_next;
+
+  if ((vp->v_mode & I_TYPE) == I_CHAR_SPECIAL) {
+	for (pp = dev_hash(vp->v_sdev); *pp != ei; pp = &(*pp)->ei_dev_next)
+		;
+	*pp = ei->ei_dev_next;
+  }
+
+  ei->ei_ep = NULL;
+  ei->ei_next = ep_free;
+  ep_free = ei;
+}
+
+
+/*===========================================================================*
+ *				ep_release				     *
+ *===========================================================================*/
+static void ep_release(struct epoll *ep)
+{
+  if (ep->ep_waiting)
+	ep_cancel_wait(ep);
+
+  while (ep->ep_items != NULL)
+	ep_remove(ep->ep_items);
+
+  ep->ep_owner = NULL;
+}
+
+
+/*===========================================================================*
+ *				ep_set					     *
+ *===========================================================================*/
+static void ep_set(struct epitem *ei, struct epoll_event *ev)
+{
+/* (Re)define what item ei waits for and check whether it is ready already. */
+  int ops;
+
+  ei->ei_ops = SEL_ERR;		/* errors are always reported */
+  if (ev->events & EPOLLIN) ei->ei_ops |= SEL_RD;
+  if (ev->events & EPOLLOUT) ei->ei_ops |= SEL_WR;
+
+  ei->ei_flags &= ~(EI_ET | EI_ONESHOT | EI_DISABLED);
+  if (ev->events & EPOLLET) ei->ei_flags |= EI_ET;
+  if (ev->events & EPOLLONESHOT) ei->ei_flags |= EI_ONESHOT;
+
+  ei->ei_data = ev->data;
+  ei->ei_revents = 0;
+
+  if ((ops = ep_query(ei)) != 0)
+	ep_ready(ei, ops);
+}
+
+
+/*===========================================================================*
+ *				ep_query				     *
+ *===========================================================================*/
+static int ep_query(struct epitem *ei)
+{
+/* Ask the driver or pipe code which operations of ei are possible now. If
+ * none are, the query arms a notification.
+ */
+  struct filp *f = ei->ei_filp;
+  int ops = ei->ei_ops;
+
+  /* After a driver failure the descriptor is 'ready' to return -EIO. */
+  if (f->filp_mode == FILP_CLOSED)
+	return(ei->ei_ops);
+
+  if (select_filp_request(f, ei->ei_type, &ops, 1) != SEL_OK || ops < 0)
+	return(SEL_ERR);
+
+  return(ops & ei->ei_ops);
+}
+
+
+/*===========================================================================*
+ *				ep_ready				     *
+ *===========================================================================*/
+static void ep_ready(struct epitem *ei, int ops)
+{
+  struct epoll *ep = ei->ei_ep;
+
+  ei->ei_revents |= ops;
+  if (ei->ei_flags & EI_READY)
+	return;
+
+  ep_dequeue(ei);		/* possibly from the check list */
+
+  ei->ei_rnext = NULL;
+  if (ep->ep_ready_tail != NULL)
+	ep->ep_ready_tail->ei_rnext = ei;
+  else
+	ep->ep_ready = ei;
+  ep->ep_ready_tail = ei;
+  ei->ei_flags |= EI_READY;
+}
+
+
+/*===========================================================================*
+ *				ep_check				     *
+ *===========================================================================*/
+static void ep_check(struct epitem *ei)
+{
+  struct epoll *ep = ei->ei_ep;
+
+  ei->ei_rnext = ep->ep_check;
+  ep->ep_check = ei;
+  ei->ei_flags |= EI_CHECK;
+}
+
+
+/*===========================================================================*
+ *				ep_dequeue				     *
+ *===========================================================================*/
+static void ep_dequeue(struct epitem *ei)
+{
+/* Take ei off the ready or check list, whichever it is on. */
+  struct epoll *ep = ei->ei_ep;
+  struct epitem **pp, *prev = NULL;
+
+  if (ei->ei_flags & EI_READY)
+	pp = &ep->ep_ready;
+  else if (ei->ei_flags & EI_CHECK)
+	pp = &ep->ep_check;
+  else
+	return;
+
+  for (; *pp != ei; pp = &prev->ei_rnext)
+	prev = *pp;
+  *pp = ei->ei_rnext;
+
+  if (ep->ep_ready_tail == ei)
+	ep->ep_ready_tail = prev;
+
+  ei->ei_flags &= ~(EI_READY | EI_CHECK);
+}
+
+
+/*===========================================================================*
+ *				ep_rescan				     *
+ *===========================================================================*/
+static void ep_rescan(struct epoll *ep)
+{
+  struct epitem *ei, *next;
+  int ops;
+
+  ei = ep->ep_check;
+  ep->ep_check = NULL;
+
+  for (; ei != NULL; ei = next) {
+	next = ei->ei_rnext;
+	ei->ei_flags &= ~EI_CHECK;
+
+	if ((ops = ep_query(ei)) == 0)
+		continue;		/* armed, wait for a notification */
+
+	/* Edge triggered and still ready: nothing new to report, but the
+	 * query armed nothing either. Wait for the next transfer if the
+	 * filp can tell us about it, otherwise report the item again.
+	 */
+	if ((ei->ei_flags & EI_ET) &&
+	    select_filp_arm(ei->ei_filp, ei->ei_type, ei->ei_ops))
+		continue;
+
+	ep_ready(ei, ops);
+  }
+}
+
+
+/*===========================================================================*
+ *				ep_collect				     *
+ *===========================================================================*/
+static int ep_collect(struct epoll *ep, endpoint_t who_e, vir_bytes uevents,
+		      int maxevents)
+{
+/* Move up to maxevents ready items to the caller's event array. */
+  static struct epoll_event evbuf[EP_BATCH];
+  struct epitem *ei;
+  int n = 0, b = 0, r;
+
+  while (n < maxevents && (ei = ep->ep_ready) != NULL) {
+	ep_dequeue(ei);
+
+	evbuf[b].events = 0;
+	if (ei->ei_revents & SEL_RD) evbuf[b].events |= EPOLLIN;
+	if (ei->ei_revents & SEL_WR) evbuf[b].events |= EPOLLOUT;
+	if (ei->ei_revents & SEL_ERR) evbuf[b].events |= EPOLLERR;
+	evbuf[b].data = ei->ei_data;
+	ei->ei_revents = 0;
+
+	if (ei->ei_flags & EI_ONESHOT)
+		ei->ei_flags |= EI_DISABLED;
+	else
+		ep_check(ei);
+
+	n++;
+	if (++b == EP_BATCH || n == maxevents || ep->ep_ready == NULL) {
+		r = sys_vircopy(ENDPT_SELF, D, (vir_bytes) evbuf, who_e, D,
+				uevents + (n - b) * sizeof(evbuf[0]),
+				b * sizeof(evbuf[0]));
+		if (r != 0) return(r);
+		b = 0;
+	}
+  }
+
+  return(n);
+}
+
+
+/*===========================================================================*
+ *				ep_wakeup				     *
+ *===========================================================================*/
+static void ep_wakeup(struct epoll *ep)
+{
+  endpoint_t owner_e;
+  int r;
+
+  if (!ep->ep_waiting)
+	return;
+
+  owner_e = ep->ep_owner->fp_endpoint;
+  ep_cancel_wait(ep);
+  r = ep_collect(ep, owner_e, ep->ep_uevents, ep->ep_maxevents);
+  revive(owner_e, r);
+}
+
+
+/*===========================================================================*
+ *				ep_cancel_wait				     *
+ *===========================================================================*/
+static void ep_cancel_wait(struct epoll *ep)
+{
+  if (ep->ep_expiry) {
+	fs_cancel_timer(&ep->ep_timer);
+	ep->ep_expiry = 0;
+  }
+
+  ep->ep_waiting = 0;
+}
+
+
+/*===========================================================================*
+ *				epoll_timeout_check			     *
+ *===========================================================================*/
+static void epoll_timeout_check(timer_t *timer)
+{
+  struct epoll *ep;
+  int e;
+
+  e = tmr_arg(timer)->ta_int;
+  if (e < 0 || e >= NR_EPOLLS)
+	return;
+
+  ep = &eptab[e];
+  if (ep->ep_owner == NULL || !ep->ep_waiting)
+	return;
+
+  ep->ep_expiry = 0;
+  ep_wakeup(ep);
+}
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2012  Ladislav Klenovic <klenovic@nucleonsoft.com>
+ *
+ *  This file is part of Nucleos kernel.
+ *
+ *  Nucleos kernel is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 2 of the License.
+ */
+#ifndef __SERVERS_VFS_EPOLL_H
+#define __SERVERS_VFS_EPOLL_H
+
+#include <nucleos/epoll.h>
+
+/* An epoll item is one file descriptor watched by an epoll instance. Items
+ * are linked into their instance, into the filp they watch (filp_epitems)
+ * and, for character specials, into a hash chain of their device so that
+ * readiness notifications find them without scanning.
+ */
+struct epitem {
+  struct epoll *ei_ep;		/* owning instance, NULL if slot is free */
+  struct filp *ei_filp;		/* watched filp */
+  int ei_fd;			/* descriptor the filp was added as */
+  int ei_type;			/* select fd type of the filp */
+  int ei_ops;			/* interested in these SEL_* operations */
+  int ei_revents;		/* SEL_* operations waiting for delivery */
+  int ei_flags;			/* EI_* */
+  epoll_data_t ei_data;		/* returned with every event */
+
+  struct epitem *ei_next;	/* items of the instance, or free list */
+  struct epitem *ei_filp_next;	/* items watching the same filp */
+  struct epitem *ei_dev_next;	/* items watching the same device */
+  struct epitem *ei_rnext;	/* ready or check list */
+};
+
+#define EI_READY	0x01	/* on the ready list */
+#define EI_CHECK	0x02	/* on the check list, query on next wait */
+#define EI_ET		0x04	/* edge triggered */
+#define EI_ONESHOT	0x08	/* disable after one event */
+#define EI_DISABLED	0x10	/* fired oneshot item, waits for a MOD */
+
+struct epoll {
+  struct fproc *ep_owner;	/* slot is free iff this is NULL */
+  struct epitem *ep_items;	/* all items of the instance */
+  struct epitem *ep_ready;	/* items with pending events */
+  struct epitem *ep_ready_tail;
+  struct epitem *ep_check;	/* reported items, query before blocking */
+  int ep_waiting;		/* owner is suspended in epoll_wait */
+  vir_bytes ep_uevents;		/* where to store the events */
+  int ep_maxevents;		/* how many of them */
+  int ep_expiry;		/* timer is set */
+  timer_t ep_timer;
+};
+
+#endif /* __SERVERS_VFS_EPOLL_H */
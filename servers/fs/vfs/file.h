@@ -10,6 +10,8 @@
 #ifndef __SERVERS_VFS_FILE_H
 #define __SERVERS_VFS_FILE_H
 
+struct epitem;
+
 /* This is the filp table.  It is an intermediary between file descriptors and
  * inodes.  A slot is free if filp_count == 0.
  */
@@ -34,6 +36,8 @@ struct filp {
 
   /* following are for fd-type-specific select() */
   int filp_pipe_select_ops;
+
+  struct epitem *filp_epitems;	/* epoll items watching this filp */
 };
 
 extern struct filp filp[];
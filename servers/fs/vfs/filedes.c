@@ -67,6 +67,7 @@ int get_fd(int start, mode_t bits, int *k, struct filp **fpt)
 		f->filp_flags = 0;
 		f->filp_state = FS_NORMAL;
 		f->filp_select_flags = 0;
+		f->filp_epitems = NULL;
 		*fpt = f;
 		return 0;
 	}
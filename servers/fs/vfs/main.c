@@ -439,6 +439,7 @@ static void fs_init(void)
 	build_dmap();			/* build device table and map boot driver */
 	init_root();			/* init root device and load super block */
 	init_select();		/* init select() structures */
+	init_epoll();		/* init epoll structures */
 
 	vmp = &vmnt[0];		/* Should be the root filesystem */
 	if (vmp->m_dev == NO_DEV)
@@ -464,6 +464,9 @@ static void free_proc(struct fproc *exiter, int flags)
   for (i = 0; i < OPEN_MAX; i++) {
 	(void) close_fd(fp, i);
   }
+
+  /* Release the epoll instances of the process. */
+  epoll_exit(fp);
   
   /* Check if any process is SUSPENDed on this driver.
    * If a driver exits, unmap its entries in the dmap table.
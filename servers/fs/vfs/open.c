@@ -541,6 +541,7 @@ int fd_nr;
   /* First locate the vnode that belongs to the file descriptor. */
   if ( (rfilp = get_filp2(rfp, fd_nr)) == NIL_FILP) return(err_code);
   vp = rfilp->filp_vno;
+  if (rfilp->filp_epitems != NULL) epoll_close_fd(rfp, fd_nr, rfilp);
   close_filp(rfilp);
 
   FD_CLR(fd_nr, &rfp->fp_cloexec_set);
@@ -35,6 +35,7 @@
 #include <nucleos/time.h>
 #include "file.h"
 #include <servers/fs/vfs/fproc.h>
+#include <servers/fs/pipe.h>
 #include "param.h"
 #include "select.h"
 
@@ -166,7 +167,7 @@ int notouch;			/* check only */
  * and there is no writer, return 0 bytes.  If a process is writing to a
  * pipe and no one is reading from it, give a broken pipe error.
  */
-  off_t pos;
+  off_t pos, room;
   int r = 0;
 
   if (ex64hi(position) != 0)
@@ -203,7 +204,8 @@ int notouch;			/* check only */
   }
 
   /* Calculate how many bytes can be written. */
-  if (pos + bytes > PIPE_BUF) {
+  room = PIPE_SIZE - (pos - vp->v_pipe_rd_pos);
+  if (bytes > room) {
 	if (oflags & O_NONBLOCK) {
 		if (bytes <= PIPE_BUF) {
 			/* Write has to be atomic */
@@ -211,7 +213,7 @@ int notouch;			/* check only */
 		}
 
 		/* Compute available space */
-		bytes= PIPE_BUF-pos;
+		bytes= room;
 
 		if (bytes > 0)  {
 			/* Do a partial write. Need to wakeup reader */
@@ -226,7 +228,7 @@ int notouch;			/* check only */
 
 	if (bytes > PIPE_BUF) {
 		/* Compute available space */
-		bytes= PIPE_BUF-pos;
+		bytes= room;
 
 		if (bytes > 0) {
 			/* Do a partial write. Need to wakeup reader
@@ -243,7 +245,7 @@ int notouch;			/* check only */
   }
 
   /* Writing to an empty pipe.  Search for suspended reader. */
-  if (pos == 0 && !notouch)
+  if (pos == vp->v_pipe_rd_pos && !notouch)
 	release(vp, __NR_read, susp_count);
 
   /* Requested amount fits */
@@ -251,6 +253,52 @@ int notouch;			/* check only */
 }
 
 
+#ifdef CONFIG_VFS_PIPE_DIRECT
+/*===========================================================================*
+ *				pipe_direct				     *
+ *===========================================================================*/
+int pipe_direct(vp, usr_e, buf, bytes)
+struct vnode *vp;		/* the inode of the pipe */
+endpoint_t usr_e;		/* writer */
+char *buf;			/* writer's buffer */
+size_t bytes;			/* bytes to be written */
+{
+/* A write to an empty pipe with a reader suspended on it: copy the data
+ * straight into the reader's buffer and complete its read, the data never
+ * enters pipefs. Return the number of bytes taken by the reader.
+ */
+  register struct fproc *rp;
+  size_t n;
+  int r;
+
+  if (vp->v_pipe_rd_pos < vp->v_size)
+	return(0);		/* pipe not empty, keep the order of data */
+
+  for (rp = &fproc[0]; rp < &fproc[NR_PROCS]; rp++) {
+	if (rp->fp_pid == PID_FREE || rp->fp_blocked_on != FP_BLOCKED_ON_PIPE ||
+	    rp->fp_revived != NOT_REVIVING || (rp->fp_fd & BYTE) != __NR_read ||
+	    rp->fp_filp[rp->fp_fd>>8]->filp_vno != vp || rp->fp_nbytes <= 0)
+		continue;
+
+	n = MIN(bytes, (size_t) rp->fp_nbytes);
+	r = sys_vircopy(usr_e, D, (vir_bytes) buf, rp->fp_endpoint, D,
+			(vir_bytes) rp->fp_buffer, n);
+	if (r != 0)
+		return(0);	/* let the regular path report the error */
+
+	rp->fp_blocked_on = FP_BLOCKED_ON_NONE;
+	susp_count--;
+	if(susp_count < 0)
+		panic("vfs", "susp_count now negative", susp_count);
+	reply(rp->fp_endpoint, n);
+	return(n);
+  }
+
+  return(0);
+}
+#endif /* CONFIG_VFS_PIPE_DIRECT */
+
+
 /*===========================================================================*
  *				suspend					     *
  *===========================================================================*/
@@ -459,7 +507,8 @@ int returned;			/* if hanging on task, how many bytes read */
 	if (blocked_on == FP_BLOCKED_ON_POPEN) {
 		/* process blocked in open or create */
 		reply(proc_nr_e, rfp->fp_fd>>8);
-	} else if (blocked_on == FP_BLOCKED_ON_SELECT) {
+	} else if (blocked_on == FP_BLOCKED_ON_SELECT ||
+		   blocked_on == FP_BLOCKED_ON_EPOLL) {
 		reply(proc_nr_e, returned);
 	} else {
 		/* Revive a process suspended on TTY or other device. 
@@ -526,6 +575,10 @@ int proc_nr_e;
 		select_forget(proc_nr_e);
 		break;
 
+	case FP_BLOCKED_ON_EPOLL:/* process blocking on epoll_wait() */
+		epoll_forget(proc_nr_e);
+		break;
+
 	case FP_BLOCKED_ON_POPEN:		/* process trying to open a fifo */
 		break;
 
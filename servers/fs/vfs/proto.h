@@ -53,6 +53,17 @@ int dmap_driver_match(endpoint_t proc, int major);
 void dmap_unmap_by_endpt(int proc_nr);
 void dmap_endpt_up(int proc_nr);
 
+/* epoll.c */
+int do_epoll_create(void);
+int do_epoll_ctl(void);
+int do_epoll_wait(void);
+void epoll_callback(struct filp *f, int ops);
+void epoll_notified(int major, int minor, int ops);
+void epoll_close_fd(struct fproc *rfp, int fd_nr, struct filp *f);
+void epoll_forget(endpoint_t proc_e);
+void epoll_exit(struct fproc *rfp);
+void init_epoll(void);
+
 /* exec.c */
 int pm_exec(int proc_e, char *path, vir_bytes path_len, char *frame, vir_bytes frame_len);
 
@@ -133,6 +144,7 @@ int map_vnode(struct vnode *vp);
 int scall_pipe(void);
 void unpause(int proc_nr_e);
 int pipe_check(struct vnode *vp, int rw_flag, int oflags, int bytes, u64_t position, int notouch);
+int pipe_direct(struct vnode *vp, endpoint_t usr_e, char *buf, size_t bytes);
 void release(struct vnode *vp, int call_nr, int count);
 void revive(int proc_nr, int bytes);
 void suspend(int task);
@@ -258,6 +270,9 @@ void select_timeout_check(timer_t *);
 void init_select(void);
 void select_unsuspend_by_endpt(endpoint_t proc);
 int select_notified(int major, int minor, int ops);
+int select_filp_type(struct filp *f);
+int select_filp_request(struct filp *f, int type, int *ops, int block);
+int select_filp_arm(struct filp *f, int type, int ops);
 
 /* timers.c */
 void fs_set_timer(timer_t *tp, int delta, tmr_func_t watchdog, int arg);
@@ -26,6 +26,7 @@
 #include <nucleos/u64.h>
 #include "file.h"
 #include <servers/fs/vfs/fproc.h>
+#include <servers/fs/pipe.h>
 #include "param.h"
 #include <nucleos/dirent.h>
 #include <assert.h>
@@ -225,6 +226,20 @@ size_t req_size;
   cum_io = fp->fp_cum_io_partial; 
   op = (rw_flag == READING ? VFS_DEV_READ : VFS_DEV_WRITE);
 
+#ifdef CONFIG_VFS_PIPE_DIRECT
+  /* Hand the data straight to a waiting reader if there is one. */
+  if (rw_flag == WRITING && (r = pipe_direct(vp, usr_e, buf, req_size)) > 0) {
+	cum_io += r;
+	buf += r;
+	req_size -= r;
+	if (req_size == 0) {
+		fp->fp_cum_io_partial = 0;
+		return(cum_io);
+	}
+	fp->fp_cum_io_partial = cum_io;
+  }
+#endif
+
   r = pipe_check(vp, rw_flag, oflags, req_size, position, 0);
   if (r <= 0) {
 	if (r == SUSPEND) pipe_suspend(rw_flag, fd_nr, buf, req_size);
@@ -286,6 +301,13 @@ size_t req_size;
 		vp->v_pipe_rd_pos= 0;
 		vp->v_pipe_wr_pos= 0;
 		position = cvu64(0);
+	} else if (cmp64ul(position, PIPE_SIZE) >= 0) {
+		/* Keep the positions small. Pipefs indexes its ring with
+		 * position % PIPE_SIZE, so this does not move any data.
+		 */
+		position = sub64ul(position, PIPE_SIZE);
+		vp->v_size -= PIPE_SIZE;
+		vp->v_pipe_wr_pos -= PIPE_SIZE;
 	}
   }
 
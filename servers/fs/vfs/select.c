@@ -14,6 +14,9 @@
  *   select_callback:  notify select system of possible fd operation 
  *   select_notified:  low-level entry for device notifying select
  *   select_unsuspend_by_endpt: cancel a blocking select on exiting driver
+ *   select_filp_type: find the fd type of a filp for epoll
+ *   select_filp_request: query a filp on behalf of epoll
+ *   select_filp_arm:  ask for the next notification of a ready filp
  */
 
 #define DEBUG_SELECT 0
@@ -257,6 +260,58 @@ int do_select(void)
 }
 
 
+/*===========================================================================*
+ *				select_filp_type			     *
+ *===========================================================================*/
+int select_filp_type(struct filp *f)
+{
+/* Return the fd type of filp f, or -1 if it can't be watched by epoll. Types
+ * whose drivers answer asynchronously are left to select() only.
+ */
+  int t, type = -1;
+
+  for (t = 0; t < SEL_FDS; t++) {
+	if (fdtypes[t].select_match) {
+		if (fdtypes[t].select_match(f))
+			type = t;
+	} else if (select_major_match(fdtypes[t].select_major, f)) {
+		type = t;
+	}
+  }
+
+  if (type != -1 && fdtypes[type].select_request == select_request_asynch)
+	return(-1);
+
+  return(type);
+}
+
+
+/*===========================================================================*
+ *				select_filp_request			     *
+ *===========================================================================*/
+int select_filp_request(struct filp *f, int type, int *ops, int block)
+{
+  return(fdtypes[type].select_request(f, ops, block));
+}
+
+
+/*===========================================================================*
+ *				select_filp_arm				     *
+ *===========================================================================*/
+int select_filp_arm(struct filp *f, int type, int ops)
+{
+/* Arm a notification for 'ops' on f even though f is ready for them now.
+ * Only pipes can do this, they call back on every read or write. Drivers
+ * just report transitions to ready. Returns whether it could be armed.
+ */
+  if (fdtypes[type].select_request != select_request_pipe)
+	return(0);
+
+  f->filp_pipe_select_ops |= ops;
+  return(1);
+}
+
+
 /*===========================================================================*
  *				select_request_file			     *
  *===========================================================================*/
@@ -563,6 +618,8 @@ int select_callback(struct filp *fp, int ops)
 			select_return(&selecttab[s], 0);
 	}
 
+	epoll_callback(fp, ops);
+
 	return 0;
 }
 
@@ -577,6 +634,8 @@ int select_notified(int major, int minor, int selected_ops)
 	printk("select callback: %d, %d: %d\n", major, minor, selected_ops);
 #endif
 
+	epoll_notified(major, minor, selected_ops);
+
 	for(t = 0; t < SEL_FDS; t++)
 		if (!fdtypes[t].select_match && fdtypes[t].select_major == major)
 		    	break;
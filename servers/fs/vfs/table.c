@@ -33,6 +33,9 @@ int (*call_vec[])(void) = {
 	SCALL_HANDLER(creat,		do_creat),
 	SCALL_HANDLER(dup,		do_dup),
 	SCALL_HANDLER(dup2,		do_dup2),
+	SCALL_HANDLER(epoll_create,	do_epoll_create),
+	SCALL_HANDLER(epoll_ctl,	do_epoll_ctl),
+	SCALL_HANDLER(epoll_wait,	do_epoll_wait),
 	SCALL_HANDLER(fchdir,		do_fchdir),
 	SCALL_HANDLER(fchmod,		do_fchmod),
 	SCALL_HANDLER(fchown,		do_fchown),
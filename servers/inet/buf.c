@@ -397,7 +397,6 @@ acc_t *acc;
 			continue;
 		}
 
-		bf_free_bufsize += buf->buf_size;
 #ifdef BUF_TRACK_ALLOC_FREE
 		buf->buf_free_file= clnt_file;
 		buf->buf_free_line= clnt_line;
@@ -442,6 +441,49 @@ register acc_t *acc_ptr;
 	return new_acc;
 }
 
+/*
+bf_extreq
+*/
+
+acc_t *bf_extreq(buf, size)
+buf_t *buf;
+size_t size;
+{
+	acc_t *acc;
+
+	assert(buf->buf_linkC == 0);
+	assert(size <= buf->buf_size);
+
+	if (!acc_freelist)
+	{
+		free_accs();
+		if (!acc_freelist)
+			ip_panic(( "buf.c: out of accessors" ));
+	}
+	acc= acc_freelist;
+	acc_freelist= acc->acc_next;
+
+	buf->buf_linkC= 1;
+	acc->acc_linkC= 1;
+	acc->acc_buffer= buf;
+	acc->acc_offset= 0;
+	acc->acc_length= size;
+	acc->acc_next= NULL;
+	acc->acc_ext_link= NULL;
+	return acc;
+}
+
+void bf_extdone(acc)
+acc_t *acc;
+{
+	assert(acc->acc_linkC == 0);
+	assert(acc->acc_buffer->buf_linkC == 0);
+
+	acc->acc_buffer= NULL;
+	acc->acc_next= acc_freelist;
+	acc_freelist= acc;
+}
+
 size_t bf_bufsize(acc_ptr)
 register acc_t *acc_ptr;
 {
@@ -834,6 +876,7 @@ acc_t *acc;
 	if (inet_buf_debug)
 		memset(acc->acc_buffer->buf_data_p, 0xa5, 512);
 #endif
+	bf_free_bufsize += 512;
 	acc->acc_next= buf512_freelist;
 	buf512_freelist= acc;
 }
@@ -846,6 +889,7 @@ acc_t *acc;
 	if (inet_buf_debug)
 		memset(acc->acc_buffer->buf_data_p, 0xa5, 2*1024);
 #endif
+	bf_free_bufsize += 2*1024;
 	acc->acc_next= buf2K_freelist;
 	buf2K_freelist= acc;
 }
@@ -858,6 +902,7 @@ acc_t *acc;
 	if (inet_buf_debug)
 		memset(acc->acc_buffer->buf_data_p, 0xa5, 32*1024);
 #endif
+	bf_free_bufsize += 32*1024;
 	acc->acc_next= buf32K_freelist;
 	buf32K_freelist= acc;
 }
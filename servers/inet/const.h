@@ -34,4 +34,8 @@ Copyright 1995 Philip Homburg
 
 #define BUF_S		512
 
+#define ETH_TSO_MAX_SIZE	16384	/* Largest frame for a device that does
+					 * TCP segmentation offload
+					 */
+
 #endif /* INET__CONST_H */
@@ -13,6 +13,7 @@ arp.c
 Copyright 1995 Philip Homburg
 */
 #include <asm/ioctls.h>
+#include <nucleos/mman.h>
 
 #include "../inet.h"
 #include "type.h"
@@ -26,12 +27,11 @@ Copyright 1995 Philip Homburg
 #include "io.h"
 #include "sr.h"
 
-#define ARP_CACHE_NR	 256
+#define ARP_CACHE_NR	 256	/* Cache entries allocated at a time */
+#define ARP_CACHE_MAX	4096	/* Default limit of the cache */
 #define AP_REQ_NR	  32
 
-#define ARP_HASH_NR	256
-#define ARP_HASH_MASK	0xff
-#define ARP_HASH_WIDTH	4
+#define ARP_HASH_NR	256	/* Initial number of hash chains */
 
 #define MAX_ARP_RETRIES		5
 #define ARP_TIMEOUT		(HZ/2+1)	/* .5 seconds */
@@ -87,7 +87,7 @@ typedef struct arp_port
 	struct arp_req
 	{
 		timer_t ar_timer;
-		int ar_entry;
+		struct arp_cache *ar_entry;
 		int ar_req_count;
 	} ap_req[AP_REQ_NR];
 
@@ -123,6 +123,10 @@ typedef struct arp_cache
 	arp_port_t *ac_port;
 	time_t ac_expire;
 	time_t ac_lastuse;
+	int ac_entno;			/* Number for NWIOARPGNEXT */
+	struct arp_cache *ac_hnext;	/* Hash chain */
+	struct arp_cache *ac_lnext;	/* LRU list or free list */
+	struct arp_cache *ac_lprev;
 } arp_cache_t;
 
 #define ACF_EMPTY	0
@@ -130,18 +134,33 @@ typedef struct arp_cache
 #define ACF_PUB		2
 
 #define ACS_UNUSED	0
-#define ACS_INCOMPLETE	1
-#define ACS_VALID	2
+#define ACS_INCOMPLETE	1	/* Waiting for the first reply */
+#define ACS_REACHABLE	2	/* Confirmed within ARP_EXP_TIME */
 #define ACS_UNREACHABLE	3
-
-static struct arp_hash_ent
-{
-	arp_cache_t *ahe_row[ARP_HASH_WIDTH];
-} arp_hash[ARP_HASH_NR];
-
+#define ACS_STALE	4	/* Not confirmed lately, still used */
+#define ACS_PROBE	5	/* Stale and being refreshed */
+
+/* The cache grows by ARP_CACHE_NR entries at a time up to arp_cache_max,
+ * entries never move. The chunks of entries are mapped, only the hash
+ * chains come from the heap. Entries in use are found through hash chains,
+ * the number of chains doubles when there are more entries than chains.
+ * The entries that are not permanent are kept on a LRU list, the oldest one
+ * is reused when the cache cannot grow any more.
+ */
 static arp_port_t *arp_port_table;
-static arp_cache_t *arp_cache;
+static arp_cache_t **arp_chunk;
 static int arp_cache_nr;
+static int arp_cache_max;
+static int arp_perm_nr;
+static arp_cache_t *arp_freelist;
+static arp_cache_t arp_lru;
+static arp_cache_t **arp_hash;
+static unsigned arp_hash_nr;
+
+arp_stat_t *arp_stat;
+
+#define cache_ent(entno) \
+	(&arp_chunk[(entno) / ARP_CACHE_NR][(entno) % ARP_CACHE_NR])
 
 static acc_t *arp_getdata(int fd, size_t offset, size_t count, int for_ioctl);
 static int arp_putdata(int fd, size_t offset, acc_t *data, int for_ioctl);
@@ -153,7 +172,18 @@ static void do_reclist(event_t *ev, ev_arg_t ev_arg);
 static void process_arp_pkt(arp_port_t *arp_port, acc_t *data);
 static void client_reply(arp_port_t *arp_port, ipaddr_t ipaddr, ether_addr_t *ethaddr);
 static arp_cache_t *find_cache_ent(arp_port_t *arp_port, ipaddr_t ipaddr);
-static arp_cache_t *alloc_cache_ent(int flags);
+static arp_cache_t *alloc_cache_ent(arp_port_t *arp_port, ipaddr_t ipaddr,
+	int flags);
+static void free_cache_ent(arp_cache_t *ce);
+static int grow_cache(void);
+static void rehash_cache(unsigned hash_nr);
+static unsigned arp_hashval(arp_port_t *arp_port, ipaddr_t ipaddr,
+	unsigned hash_nr);
+static void lru_link(arp_cache_t *ce);
+static void lru_unlink(arp_cache_t *ce);
+static void lru_touch(arp_cache_t *ce);
+static struct arp_req *start_req(arp_port_t *arp_port, arp_cache_t *ce);
+static void stop_req(arp_port_t *arp_port, arp_cache_t *ce);
 static void arp_buffree(int priority);
 #ifdef BUF_CONSISTENCY_CHECK
 static void arp_bufcheck(void);
@@ -162,21 +192,28 @@ static void arp_bufcheck(void);
 void arp_prep()
 {
 	arp_port_table= alloc(eth_conf_nr * sizeof(arp_port_table[0]));
+	arp_stat= alloc(eth_conf_nr * sizeof(arp_stat[0]));
 
-	arp_cache_nr= ARP_CACHE_NR;
-	if (arp_cache_nr < (eth_conf_nr+1)*AP_REQ_NR)
+	arp_cache_max= arp_conf_nr ? arp_conf_nr : ARP_CACHE_MAX;
+	if (arp_cache_max < (eth_conf_nr+1)*AP_REQ_NR)
 	{
-		arp_cache_nr= (eth_conf_nr+1)*AP_REQ_NR;
 		printk("arp: using %d cache entries instead of %d\n",
-			arp_cache_nr, ARP_CACHE_NR);
+			(eth_conf_nr+1)*AP_REQ_NR, arp_cache_max);
+		arp_cache_max= (eth_conf_nr+1)*AP_REQ_NR;
 	}
-	arp_cache= alloc(arp_cache_nr * sizeof(arp_cache[0]));
+	arp_cache_max= (arp_cache_max + ARP_CACHE_NR-1) / ARP_CACHE_NR *
+		ARP_CACHE_NR;
+	arp_chunk= alloc(arp_cache_max / ARP_CACHE_NR * sizeof(arp_chunk[0]));
+	arp_hash_nr= ARP_HASH_NR;
+	arp_hash= alloc(arp_hash_nr * sizeof(arp_hash[0]));
+	if (!arp_port_table || !arp_stat || !arp_chunk || !arp_hash)
+		ip_panic(( "arp: out of memory" ));
 }
 
 void arp_init()
 {
 	arp_port_t *arp_port;
-	arp_cache_t *cache;
+	unsigned u;
 	int i;
 
 	assert (BUF_S >= sizeof(struct nwio_ethstat));
@@ -189,13 +226,20 @@ void arp_init()
 						 * unavailable */
 	}
 
-	cache= arp_cache;
-	for (i=0; i<arp_cache_nr; i++, cache++)
+	memset(arp_stat, '\0', eth_conf_nr * sizeof(arp_stat[0]));
+
+	arp_cache_nr= 0;
+	arp_perm_nr= 0;
+	arp_freelist= NULL;
+	arp_lru.ac_lnext= arp_lru.ac_lprev= &arp_lru;
+	for (u= 0; u<arp_hash_nr; u++)
+		arp_hash[u]= NULL;
+
+	/* Start with enough entries for all outstanding requests */
+	while (arp_cache_nr < (eth_conf_nr+1)*AP_REQ_NR)
 	{
-		cache->ac_state= ACS_UNUSED;
-		cache->ac_flags= ACF_EMPTY;
-		cache->ac_expire= 0;
-		cache->ac_lastuse= 0;
+		if (!grow_cache())
+			ip_panic(( "arp: out of memory" ));
 	}
 
 #ifndef BUF_CONSISTENCY_CHECK
@@ -537,11 +581,10 @@ static void process_arp_pkt (arp_port, data)
 arp_port_t *arp_port;
 acc_t *data;
 {
-	int i, entry, do_reply;
+	int i, do_reply;
 	arp46_t *arp;
 	u16_t *p;
 	arp_cache_t *ce, *cache;
-	struct arp_req *reqp;
 	time_t curr_time;
 	ipaddr_t spa, tpa;
 
@@ -602,39 +645,29 @@ acc_t *data;
 			arp_port-arp_port_table);
 			writeIpAddr(spa); printk("\n"));
 
-		ce= alloc_cache_ent(ACF_EMPTY);
-		ce->ac_flags= ACF_EMPTY;
-		ce->ac_state= ACS_VALID;
+		ce= alloc_cache_ent(arp_port, spa, ACF_EMPTY);
+		if (ce == NULL)
+			return;	/* Only permanent entries and requests */
+		ce->ac_state= ACS_REACHABLE;
 		ce->ac_ethaddr= arp->a46_sha;
-		ce->ac_ipaddr= spa;
-		ce->ac_port= arp_port;
 		ce->ac_expire= curr_time+ARP_EXP_TIME;
 		ce->ac_lastuse= curr_time-ARP_INUSE_OFFSET; /* never used */
 	}
 
+	if (ce->ac_state == ACS_INCOMPLETE || ce->ac_state == ACS_PROBE)
+		stop_req(arp_port, ce);
 	if (ce->ac_state == ACS_INCOMPLETE || ce->ac_state == ACS_UNREACHABLE)
 	{
 		ce->ac_ethaddr= arp->a46_sha;
 		if (ce->ac_state == ACS_INCOMPLETE)
 		{
-			/* Find request entry */
-			entry= ce-arp_cache;
-			for (i= 0, reqp= arp_port->ap_req; i<AP_REQ_NR; 
-				i++, reqp++)
-			{
-				if (reqp->ar_entry == entry)
-					break;
-			}
-			assert(i < AP_REQ_NR);
-			clck_untimer(&reqp->ar_timer);
-			reqp->ar_entry= -1;
-			
-			ce->ac_state= ACS_VALID;
+			/* Keep the entry while the packets go out */
+			ce->ac_state= ACS_REACHABLE;
+			lru_touch(ce);
 			client_reply(arp_port, spa, &arp->a46_sha);
 		}
-		else
-			ce->ac_state= ACS_VALID;
 	}
+	ce->ac_state= ACS_REACHABLE;
 
 	/* Update fields in the arp cache. */
 	if (memcmp(&ce->ac_ethaddr, &arp->a46_sha,
@@ -708,113 +741,220 @@ arp_port_t *arp_port;
 ipaddr_t ipaddr;
 {
 	arp_cache_t *ce;
-	int i;
-	unsigned hash;
 
-	hash= (ipaddr >> 24) ^ (ipaddr >> 16) ^ (ipaddr >> 8) ^ ipaddr;
-	hash &= ARP_HASH_MASK;
-
-	ce= arp_hash[hash].ahe_row[0];
-	if (ce && ce->ac_ipaddr == ipaddr && ce->ac_port == arp_port &&
-		ce->ac_state != ACS_UNUSED)
-	{
-		return ce;
-	}
-	for (i= 1; i<ARP_HASH_WIDTH; i++)
+	ce= arp_hash[arp_hashval(arp_port, ipaddr, arp_hash_nr)];
+	for (; ce; ce= ce->ac_hnext)
 	{
-		ce= arp_hash[hash].ahe_row[i];
-		if (!ce || ce->ac_ipaddr != ipaddr || ce->ac_port != arp_port
-			|| ce->ac_state == ACS_UNUSED)
-		{
-			continue;
-		}
-		arp_hash[hash].ahe_row[i]= arp_hash[hash].ahe_row[0];
-		arp_hash[hash].ahe_row[0]= ce;
-		return ce;
+		if (ce->ac_ipaddr == ipaddr && ce->ac_port == arp_port)
+			return ce;
 	}
+	return NULL;
+}
 
-	for (i=0, ce= arp_cache; i<arp_cache_nr; i++, ce++)
+static arp_cache_t *alloc_cache_ent(arp_port, ipaddr, flags)
+arp_port_t *arp_port;
+ipaddr_t ipaddr;
+int flags;
+{
+	arp_cache_t *ce;
+	unsigned hash;
+
+	if ((flags & ACF_PERM) && arp_perm_nr >= arp_cache_max/2)
+		return NULL; /* Too many entries */
+
+	if (arp_freelist == NULL)
+		grow_cache();
+	if (arp_freelist == NULL)
 	{
-		if (ce->ac_state != ACS_UNUSED &&
-			ce->ac_port == arp_port &&
-			ce->ac_ipaddr == ipaddr)
+		/* Reuse the least recently used entry, except when a
+		 * request for it is in progress.
+		 */
+		for (ce= arp_lru.ac_lprev; ce != &arp_lru; ce= ce->ac_lprev)
 		{
-			for (i= ARP_HASH_WIDTH-1; i>0; i--)
+			if (ce->ac_state != ACS_INCOMPLETE &&
+				ce->ac_state != ACS_PROBE)
 			{
-				arp_hash[hash].ahe_row[i]=
-					arp_hash[hash].ahe_row[i-1];
+				break;
 			}
-			assert(i == 0);
-			arp_hash[hash].ahe_row[0]= ce;
-			return ce;
 		}
+		if (ce == &arp_lru)
+			return NULL;
+		free_cache_ent(ce);
 	}
-	return NULL;
+
+	ce= arp_freelist;
+	arp_freelist= ce->ac_lnext;
+	ce->ac_flags= flags;
+	ce->ac_ipaddr= ipaddr;
+	ce->ac_port= arp_port;
+	hash= arp_hashval(arp_port, ipaddr, arp_hash_nr);
+	ce->ac_hnext= arp_hash[hash];
+	arp_hash[hash]= ce;
+	if (flags & ACF_PERM)
+		arp_perm_nr++;
+	else
+		lru_link(ce);
+	return ce;
 }
 
-static arp_cache_t *alloc_cache_ent(flags)
-int flags;
+static void free_cache_ent(ce)
+arp_cache_t *ce;
 {
-	arp_cache_t *cache, *old;
-	int i;
+	arp_cache_t **cep;
 
-	old= NULL;
-	for (i=0, cache= arp_cache; i<arp_cache_nr; i++, cache++)
+	for (cep= &arp_hash[arp_hashval(ce->ac_port, ce->ac_ipaddr,
+		arp_hash_nr)]; *cep != ce; cep= &(*cep)->ac_hnext)
 	{
-		if (cache->ac_state == ACS_UNUSED)
-		{
-			old= cache;
-			break;
-		}
-		if (cache->ac_state == ACS_INCOMPLETE)
-			continue;
-		if (cache->ac_flags & ACF_PERM)
-			continue;
-		if (!old || cache->ac_lastuse < old->ac_lastuse)
-			old= cache;
+		assert(*cep != NULL);
 	}
-	assert(old);
+	*cep= ce->ac_hnext;
+	if (ce->ac_flags & ACF_PERM)
+		arp_perm_nr--;
+	else
+		lru_unlink(ce);
 
-	if (!flags)
-		return old;
+	ce->ac_state= ACS_UNUSED;
+	ce->ac_flags= ACF_EMPTY;
+	ce->ac_lnext= arp_freelist;
+	arp_freelist= ce;
+}
+
+static int grow_cache()
+{
+	arp_cache_t *chunk, *ce;
+	int i;
+
+	if (arp_cache_nr >= arp_cache_max)
+		return 0;
+	chunk= mmap(0, ARP_CACHE_NR * sizeof(chunk[0]), PROT_READ|PROT_WRITE,
+		MAP_PREALLOC|MAP_ANONYMOUS, -1, 0);
+	if (chunk == MAP_FAILED)
+		return 0;
+	arp_chunk[arp_cache_nr / ARP_CACHE_NR]= chunk;
 
-	/* Get next permanent entry */
-	for (i=0, cache= arp_cache; i<arp_cache_nr; i++, cache++)
+	for (i= ARP_CACHE_NR-1, ce= &chunk[i]; i >= 0; i--, ce--)
 	{
-		if (cache->ac_state == ACS_UNUSED)
-			break;
-		if (cache->ac_flags & ACF_PERM)
-			continue;
-		break;
+		ce->ac_state= ACS_UNUSED;
+		ce->ac_flags= ACF_EMPTY;
+		ce->ac_expire= 0;
+		ce->ac_lastuse= 0;
+		ce->ac_entno= arp_cache_nr + i;
+		ce->ac_lnext= arp_freelist;
+		arp_freelist= ce;
 	}
-	if (i >= arp_cache_nr/2)
-		return NULL; /* Too many entries */
-	if (cache != old)
+	arp_cache_nr += ARP_CACHE_NR;
+
+	if (arp_cache_nr > arp_hash_nr)
+		rehash_cache(2*arp_hash_nr);
+	return 1;
+}
+
+static void rehash_cache(hash_nr)
+unsigned hash_nr;
+{
+	arp_cache_t **hash, *ce, *next;
+	unsigned i, h;
+
+	hash= alloc(hash_nr * sizeof(hash[0]));
+	if (hash == NULL)
+		return;	/* Live with longer chains */
+	for (i= 0; i<hash_nr; i++)
+		hash[i]= NULL;
+
+	for (i= 0; i<arp_hash_nr; i++)
 	{
-		assert(old > cache);
-		*old= *cache;
-		old= cache;
+		for (ce= arp_hash[i]; ce; ce= next)
+		{
+			next= ce->ac_hnext;
+			h= arp_hashval(ce->ac_port, ce->ac_ipaddr, hash_nr);
+			ce->ac_hnext= hash[h];
+			hash[h]= ce;
+		}
 	}
+	free(arp_hash);
+	arp_hash= hash;
+	arp_hash_nr= hash_nr;
+}
 
-	if (!(flags & ACF_PUB))
-		return old;
+static unsigned arp_hashval(arp_port, ipaddr, hash_nr)
+arp_port_t *arp_port;
+ipaddr_t ipaddr;
+unsigned hash_nr;
+{
+	u32_t hash;
+
+	/* hash_nr is a power of two */
+	hash= ipaddr ^ (arp_port-arp_port_table);
+	hash= (hash >> 16) ^ hash;
+	hash *= 0x45d9f3bUL;
+	hash= (hash >> 16) ^ hash;
+	return hash & (hash_nr-1);
+}
 
-	/* Get first nonpublished entry */
-	for (i=0, cache= arp_cache; i<arp_cache_nr; i++, cache++)
+static void lru_link(ce)
+arp_cache_t *ce;
+{
+	ce->ac_lnext= arp_lru.ac_lnext;
+	ce->ac_lprev= &arp_lru;
+	ce->ac_lnext->ac_lprev= ce;
+	arp_lru.ac_lnext= ce;
+}
+
+static void lru_unlink(ce)
+arp_cache_t *ce;
+{
+	ce->ac_lprev->ac_lnext= ce->ac_lnext;
+	ce->ac_lnext->ac_lprev= ce->ac_lprev;
+}
+
+static void lru_touch(ce)
+arp_cache_t *ce;
+{
+	if (ce->ac_flags & ACF_PERM)
+		return;
+	lru_unlink(ce);
+	lru_link(ce);
+}
+
+static struct arp_req *start_req(arp_port, ce)
+arp_port_t *arp_port;
+arp_cache_t *ce;
+{
+	int i;
+	struct arp_req *reqp;
+
+	for (i= 0, reqp= arp_port->ap_req; i<AP_REQ_NR; i++, reqp++)
 	{
-		if (cache->ac_state == ACS_UNUSED)
+		if (reqp->ar_entry == NULL)
 			break;
-		if (cache->ac_flags & ACF_PUB)
-			continue;
-		break;
 	}
-	if (cache != old)
+	if (i >= AP_REQ_NR)
+		return NULL;
+
+	reqp->ar_entry= ce;
+	reqp->ar_req_count= -1;
+
+	/* Send the first packet by expiring the timer */
+	clck_timer(&reqp->ar_timer, 1, arp_timeout,
+		(arp_port-arp_port_table)*AP_REQ_NR + i);
+	return reqp;
+}
+
+static void stop_req(arp_port, ce)
+arp_port_t *arp_port;
+arp_cache_t *ce;
+{
+	int i;
+	struct arp_req *reqp;
+
+	for (i= 0, reqp= arp_port->ap_req; i<AP_REQ_NR; i++, reqp++)
 	{
-		assert(old > cache);
-		*old= *cache;
-		old= cache;
+		if (reqp->ar_entry == ce)
+			break;
 	}
-	return old;
+	assert(i < AP_REQ_NR);
+	clck_untimer(&reqp->ar_timer);
+	reqp->ar_entry= NULL;
 }
 
 void arp_set_ipaddr (eth_port, ipaddr)
@@ -856,7 +996,7 @@ arp_func_t arp_func;
 	arp_port->ap_sendlist= NULL;
 	arp_port->ap_reclist= NULL;
 	for (i= 0; i<AP_REQ_NR; i++)
-		arp_port->ap_req[i].ar_entry= -1;
+		arp_port->ap_req[i].ar_entry= NULL;
 	ev_init(&arp_port->ap_event);
 
 	arp_main(arp_port);
@@ -869,14 +1009,14 @@ int eth_port;
 ipaddr_t ipaddr;
 ether_addr_t *ethaddr;
 {
-	int i, ref;
 	arp_port_t *arp_port;
-	struct arp_req *reqp;
+	arp_stat_t *arp_st;
 	arp_cache_t *ce;
 	time_t curr_time;
 
 	assert(eth_port >= 0 && eth_port < eth_conf_nr);
 	arp_port= &arp_port_table[eth_port];
+	arp_st= &arp_stat[eth_port];
 	assert(arp_port->ap_state == APS_ARPMAIN ||
 		(printk("arp[%d]: ap_state= %d\n", arp_port-arp_port_table,
 		arp_port->ap_state), 0));
@@ -884,81 +1024,72 @@ ether_addr_t *ethaddr;
 	curr_time= get_time();
 
 	ce= find_cache_ent (arp_port, ipaddr);
-	if (ce && ce->ac_expire < curr_time)
+	if (ce && ce->ac_state == ACS_UNREACHABLE &&
+		ce->ac_expire < curr_time)
 	{
-		assert(ce->ac_state != ACS_INCOMPLETE);
-
-		/* Check whether there is enough space for an ARP
-		 * request or not.
-		 */
-		for (i= 0, reqp= arp_port->ap_req; i<AP_REQ_NR; i++, reqp++)
-		{
-			if (reqp->ar_entry < 0)
-				break;
-		}
-		if (i < AP_REQ_NR)
-		{
-			/* Okay, expire this entry. */
-			ce->ac_state= ACS_UNUSED;
-			ce= NULL;
-		}
-		else
-		{
-			/* Continue using this entry for a while */
-			printk("arp[%d]: Overloaded! Keeping entry for ",
-				arp_port-arp_port_table);
-			writeIpAddr(ipaddr);
-			printk("\n");
-			ce->ac_expire= curr_time+ARP_NOTRCH_EXP_TIME;
-		}
+		/* Time to try again */
+		free_cache_ent(ce);
+		ce= NULL;
 	}
 	if (ce)
 	{
-		/* Found an entry. This entry should be valid, unreachable
-		 * or incomplete.
-		 */
 		ce->ac_lastuse= curr_time;
-		if (ce->ac_state == ACS_VALID)
+		lru_touch(ce);
+		switch (ce->ac_state)
 		{
-			*ethaddr= ce->ac_ethaddr;
-			return 0;
-		}
-		if (ce->ac_state == ACS_UNREACHABLE)
+		case ACS_INCOMPLETE:
+			arp_st->as_miss++;
+			return NW_SUSPEND;
+		case ACS_UNREACHABLE:
+			arp_st->as_hit++;
 			return -EHOSTUNREACH;
-		assert(ce->ac_state == ACS_INCOMPLETE);
-
-		return NW_SUSPEND;
+		case ACS_REACHABLE:
+			if (ce->ac_expire >= curr_time ||
+				(ce->ac_flags & ACF_PERM))
+			{
+				break;
+			}
+			ce->ac_state= ACS_STALE;
+			/* fall through */
+		case ACS_STALE:
+			/* Keep using the old address while a request
+			 * confirms it. Without a free request slot,
+			 * try again next time.
+			 */
+			if (start_req(arp_port, ce) != NULL)
+			{
+				ce->ac_state= ACS_PROBE;
+				arp_st->as_refresh++;
+			}
+			break;
+		case ACS_PROBE:
+			break;
+		default:
+			ip_panic(( "arp_ip_eth: bad state %d", ce->ac_state ));
+		}
+		arp_st->as_hit++;
+		*ethaddr= ce->ac_ethaddr;
+		return 0;
 	}
 
-	/* Find an empty slot for an ARP request */
-	for (i= 0, reqp= arp_port->ap_req; i<AP_REQ_NR; i++, reqp++)
+	arp_st->as_miss++;
+	ce= alloc_cache_ent(arp_port, ipaddr, ACF_EMPTY);
+	if (ce == NULL)
 	{
-		if (reqp->ar_entry < 0)
-			break;
+		/* Only permanent entries and requests in the cache */
+		return -EHOSTUNREACH;
 	}
-	if (i >= AP_REQ_NR)
+	ce->ac_state= ACS_INCOMPLETE;
+	ce->ac_expire= curr_time+ARP_EXP_TIME;
+	ce->ac_lastuse= curr_time;
+
+	if (start_req(arp_port, ce) == NULL)
 	{
 		/* We should be able to report that this ARP request
 		 * cannot be accepted. At the moment we just return SUSPEND.
 		 */
-		return NW_SUSPEND;
+		free_cache_ent(ce);
 	}
-	ref= (eth_port*AP_REQ_NR + i);
-
-	ce= alloc_cache_ent(ACF_EMPTY);
-	ce->ac_flags= 0;
-	ce->ac_state= ACS_INCOMPLETE;
-	ce->ac_ipaddr= ipaddr;
-	ce->ac_port= arp_port;
-	ce->ac_expire= curr_time+ARP_EXP_TIME;
-	ce->ac_lastuse= curr_time;
-
-	reqp->ar_entry= ce-arp_cache;
-	reqp->ar_req_count= -1;
-
-	/* Send the first packet by expiring the timer */
-	clck_timer(&reqp->ar_timer, 1, arp_timeout, ref);
-
 	return NW_SUSPEND;
 }
 
@@ -970,7 +1101,7 @@ get_userdata_t get_userdata;
 put_userdata_t put_userdata;
 {
 	arp_port_t *arp_port;
-	arp_cache_t *ce, *cache;
+	arp_cache_t *ce;
 	acc_t *data;
 	nwio_arp_t *arp_iop;
 	int entno, result, ac_flags;
@@ -993,19 +1124,8 @@ put_userdata_t put_userdata;
 		data= bf_packIffLess(data, sizeof(*arp_iop));
 		arp_iop= (nwio_arp_t *)ptr2acc_data(data);
 		ipaddr= arp_iop->nwa_ipaddr;
-		ce= NULL;	/* lint */
-		for (entno= 0; entno < arp_cache_nr; entno++)
-		{
-			ce= &arp_cache[entno];
-			if (ce->ac_state == ACS_UNUSED ||
-				ce->ac_port != arp_port)
-			{
-				continue;
-			}
-			if (ce->ac_ipaddr == ipaddr)
-				break;
-		}
-		if (entno == arp_cache_nr)
+		ce= find_cache_ent(arp_port, ipaddr);
+		if (ce == NULL)
 		{
 			/* Also report the address of this interface */
 			if (ipaddr != arp_port->ap_ipaddr)
@@ -1020,7 +1140,7 @@ put_userdata_t put_userdata;
 		}
 		else
 		{
-			arp_iop->nwa_entno= entno+1;
+			arp_iop->nwa_entno= ce->ac_entno+1;
 			arp_iop->nwa_ipaddr= ce->ac_ipaddr;
 			arp_iop->nwa_ethaddr= ce->ac_ethaddr;
 			arp_iop->nwa_flags= 0;
@@ -1049,7 +1169,7 @@ put_userdata_t put_userdata;
 		ce= NULL;	/* lint */
 		for (; entno < arp_cache_nr; entno++)
 		{
-			ce= &arp_cache[entno];
+			ce= cache_ent(entno);
 			if (ce->ac_state == ACS_UNUSED ||
 				ce->ac_port != arp_port)
 			{
@@ -1099,18 +1219,15 @@ put_userdata_t put_userdata;
 			ac_flags |= ACF_PUB|ACF_PERM;
 
 		/* Allocate a cache entry */
-		ce= alloc_cache_ent(ac_flags);
+		ce= alloc_cache_ent(arp_port, ipaddr, ac_flags);
 		if (ce == NULL)
 		{
 			bf_afree(data);
 			return -ENOMEM;
 		}
 
-		ce->ac_flags= ac_flags;
-		ce->ac_state= ACS_VALID;
+		ce->ac_state= ACS_REACHABLE;
 		ce->ac_ethaddr= arp_iop->nwa_ethaddr;
-		ce->ac_ipaddr= arp_iop->nwa_ipaddr;
-		ce->ac_port= arp_port;
 
 		curr_time= get_time();
 		ce->ac_expire= curr_time+ARP_EXP_TIME;
@@ -1133,56 +1250,11 @@ put_userdata_t put_userdata;
 		if (ce->ac_state == ACS_INCOMPLETE)
 			return -EINVAL;
 
-		ac_flags= ce->ac_flags;
-		if (ac_flags & ACF_PUB)
-		{
-			/* Make sure entry is at the end of published
-			 * entries.
-			 */
-			for (entno= 0, cache= arp_cache;
-				entno<arp_cache_nr; entno++, cache++)
-			{
-				if (cache->ac_state == ACS_UNUSED)
-					break;
-				if (cache->ac_flags & ACF_PUB)
-					continue;
-				break;
-			}
-			assert(cache > arp_cache);
-			cache--;
-			if (cache != ce)
-			{
-				assert(cache > ce);
-				*ce= *cache;
-				ce= cache;
-			}
-		}
-		if (ac_flags & ACF_PERM)
-		{
-			/* Make sure entry is at the end of permanent
-			 * entries.
-			 */
-			for (entno= 0, cache= arp_cache;
-				entno<arp_cache_nr; entno++, cache++)
-			{
-				if (cache->ac_state == ACS_UNUSED)
-					break;
-				if (cache->ac_flags & ACF_PERM)
-					continue;
-				break;
-			}
-			assert(cache > arp_cache);
-			cache--;
-			if (cache != ce)
-			{
-				assert(cache > ce);
-				*ce= *cache;
-				ce= cache;
-			}
-		}
+		if (ce->ac_state == ACS_PROBE)
+			stop_req(arp_port, ce);
 
 		/* Clear entry */
-		ce->ac_state= ACS_UNUSED;
+		free_cache_ent(ce);
 
 		return 0;
 
@@ -1197,7 +1269,7 @@ static void arp_timeout (ref, timer)
 int ref;
 timer_t *timer;
 {
-	int i, port, reqind, acind;
+	int i, port, reqind, probe;
 	arp_port_t *arp_port;
 	arp_cache_t *ce;
 	struct arp_req *reqp;
@@ -1215,24 +1287,27 @@ timer_t *timer;
 	reqp= &arp_port->ap_req[reqind];
 	assert (timer == &reqp->ar_timer);
 
-	acind= reqp->ar_entry;
-
-	assert(acind >= 0 && acind < arp_cache_nr);
-	ce= &arp_cache[acind];
-
+	ce= reqp->ar_entry;
+	assert(ce != NULL);
 	assert(ce->ac_port == arp_port);
-	assert(ce->ac_state == ACS_INCOMPLETE);
+	assert(ce->ac_state == ACS_INCOMPLETE || ce->ac_state == ACS_PROBE);
 
 	if (++reqp->ar_req_count >= MAX_ARP_RETRIES)
 	{
 		curr_time= get_time();
+		clck_untimer(&reqp->ar_timer);
+		reqp->ar_entry= NULL;
+
+		probe= (ce->ac_state == ACS_PROBE);
 		ce->ac_state= ACS_UNREACHABLE;
 		ce->ac_expire= curr_time+ ARP_NOTRCH_EXP_TIME;
 		ce->ac_lastuse= curr_time;
 
-		clck_untimer(&reqp->ar_timer);
-		reqp->ar_entry= -1;
-		client_reply(arp_port, ce->ac_ipaddr, NULL);
+		/* Nobody waits for a stale entry, the packets went to the
+		 * old address.
+		 */
+		if (!probe)
+			client_reply(arp_port, ce->ac_ipaddr, NULL);
 		return;
 	}
 
@@ -1248,12 +1323,20 @@ timer_t *timer;
 		*p= 0xdead;
 	}
 
-	arp->a46_dstaddr.ea_addr[0]= 0xff;
-	arp->a46_dstaddr.ea_addr[1]= 0xff;
-	arp->a46_dstaddr.ea_addr[2]= 0xff;
-	arp->a46_dstaddr.ea_addr[3]= 0xff;
-	arp->a46_dstaddr.ea_addr[4]= 0xff;
-	arp->a46_dstaddr.ea_addr[5]= 0xff;
+	if (ce->ac_state == ACS_PROBE)
+	{
+		/* Refresh a stale entry without bothering the others */
+		arp->a46_dstaddr= ce->ac_ethaddr;
+	}
+	else
+	{
+		arp->a46_dstaddr.ea_addr[0]= 0xff;
+		arp->a46_dstaddr.ea_addr[1]= 0xff;
+		arp->a46_dstaddr.ea_addr[2]= 0xff;
+		arp->a46_dstaddr.ea_addr[3]= 0xff;
+		arp->a46_dstaddr.ea_addr[4]= 0xff;
+		arp->a46_dstaddr.ea_addr[5]= 0xff;
+	}
 	arp->a46_hdr= htons(ARP_ETHERNET);
 	arp->a46_pro= htons(ETH_IP_PROTO);
 	arp->a46_hln= 6;
@@ -1275,6 +1358,13 @@ timer_t *timer;
 		arp_timeout, ref);
 }
 
+void arp_qdrop(eth_port)
+int eth_port;
+{
+	assert(eth_port >= 0 && eth_port < eth_conf_nr);
+	arp_stat[eth_port].as_qdrop++;
+}
+
 static void arp_buffree(priority)
 int priority;
 {
@@ -21,6 +21,16 @@ Copyright 1995 Philip Homburg
 #define ARP_REQUEST	1
 #define ARP_REPLY	2
 
+typedef struct arp_stat
+{
+	u32_t as_hit;		/* Lookups answered from the cache */
+	u32_t as_miss;		/* Lookups that wait for a reply */
+	u32_t as_refresh;	/* Stale entries refreshed in the background */
+	u32_t as_qdrop;		/* Packets dropped while waiting for a reply */
+} arp_stat_t;
+
+extern arp_stat_t *arp_stat;	/* Per ethernet port */
+
 /* Prototypes */
 typedef void (*arp_func_t)(int fd, ipaddr_t ipaddr, ether_addr_t *ethaddr);
 void arp_prep(void);
@@ -28,6 +38,7 @@ void arp_init(void);
 void arp_set_ipaddr(int eth_port, ipaddr_t ipaddr);
 int arp_set_cb(int eth_port, int ip_port, arp_func_t arp_func);
 int arp_ip_eth(int eth_port, ipaddr_t ipaddr, ether_addr_t *ethaddr);
+void arp_qdrop(int eth_port);
 int arp_ioctl(int eth_port, int fd, ioreq_t req, get_userdata_t get_userdata,
 	      put_userdata_t put_userdata);
 
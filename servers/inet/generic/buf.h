@@ -156,6 +156,15 @@ acc_t *_bf_dupacc(char *clnt_file, int clnt_line, acc_t *acc);
 #endif
 /* the result is an acc with linkC == 1 identical to the given one */
 
+acc_t *bf_extreq(buf_t *buf, size_t size);
+/* the result is an acc with linkC == 1 for the first size bytes of a buffer
+   that is not from the pools. The buf_free function of the buffer is called
+   when the last link goes away, it has to return the acc with bf_extdone.
+   Freeing it does not count towards the pool memory bf_memreq waits for */
+
+void bf_extdone(acc_t *acc);
+/* this returns the acc of a buffer from bf_extreq to the free accessors */
+
 #ifndef BUF_TRACK_ALLOC_FREE
 void bf_afree(acc_t *acc);
 #else
@@ -446,7 +446,7 @@ size_t count;
 	if (eth_fd->ef_ethopt.nweo_flags & NWEO_RWDATONLY)
 		count += ETH_HDR_SIZE;
 
-	if (count<ETH_MIN_PACK_SIZE || count>ETH_MAX_PACK_SIZE)
+	if (count<ETH_MIN_PACK_SIZE || count>eth_max_size(eth_port))
 	{
 		DBLOCK(1, printk("illegal packetsize (%d)\n",count));
 		reply_thr_get (eth_fd, -EPACKSIZE, FALSE);
@@ -508,7 +508,7 @@ size_t data_len;
 	if (eth_fd->ef_ethopt.nweo_flags & NWEO_RWDATONLY)
 		count += ETH_HDR_SIZE;
 
-	if (count<ETH_MIN_PACK_SIZE || count>ETH_MAX_PACK_SIZE)
+	if (count<ETH_MIN_PACK_SIZE || count>eth_max_size(eth_port))
 	{
 		DBLOCK(1, printk("illegal packetsize (%d)\n",count));
 		return -EPACKSIZE;
@@ -49,9 +49,14 @@ typedef struct eth_port
 #define EPF_EMPTY	 0x0
 #define EPF_ENABLED	 0x1
 #define EPF_GOT_ADDR	 0x2	/* Got ethernet address from device */
+#define EPF_TSO		 0x4	/* Device segments large TCP frames */
 #define EPF_READ_IP	0x20
 #define EPF_READ_SP	0x40
 
+/* Largest frame that can be written to an ethernet port */
+#define eth_max_size(ep)	(((ep)->etp_flags & EPF_TSO) ? \
+	ETH_TSO_MAX_SIZE : ETH_MAX_PACK_SIZE)
+
 extern eth_port_t *eth_port_table;
 
 extern int no_ethWritePort;	/* debug, consistency check */
@@ -48,6 +48,7 @@ void ip_prep()
 {
 	ip_port_table= alloc(ip_conf_nr * sizeof(ip_port_table[0]));
 	icmp_prep();
+	ipr_prep();
 }
 
 void ip_init()
@@ -87,6 +88,7 @@ void ip_init()
 		ip_port->ip_dl_type= icp->ic_devtype;
 		ip_port->ip_mtu= IP_DEF_MTU;
 		ip_port->ip_mtu_max= IP_MAX_PACKSIZE;
+		ip_port->ip_tso= 0;
 
 		switch(ip_port->ip_dl_type)
 		{
@@ -286,6 +288,7 @@ int priority;
 				{
 					pack= next_pack;
 					next_pack= pack->acc_ext_link;
+					arp_qdrop(ip_port->ip_dl.dl_eth.de_port);
 					bf_afree(pack);
 				}
 				ip_port->ip_dl.dl_eth.de_arp_head= next_pack;
@@ -55,6 +55,7 @@ static int ipeth_send(struct ip_port *ip_port, ipaddr_t dest, acc_t *pack, int t
 static void ipeth_arp_reply(int ip_port_nr, ipaddr_t ipaddr, ether_addr_t *dst_ether_ptr);
 static int ipeth_update_ttl(time_t enq_time, time_t now, acc_t *eth_pack);
 static void ip_eth_arrived(int port, acc_t *pack, size_t pack_size);
+static size_t ipeth_max_frame(ip_port_t *ip_port, acc_t *eth_pack);
 
 
 int ipeth_init(ip_port)
@@ -83,6 +84,8 @@ ip_port_t *ip_port;
 	ip_port->ip_dev_send= ipeth_send;
 	ip_port->ip_mtu= ETH_MAX_PACK_SIZE-ETH_HDR_SIZE;
 	ip_port->ip_mtu_max= ip_port->ip_mtu;
+	if (eth_conf[ip_port->ip_dl.dl_eth.de_port].ec_flags & ECF_TSO)
+		ip_port->ip_tso= ETH_TSO_MAX_SIZE-ETH_HDR_SIZE;
 	return 0;
 }
 
@@ -361,7 +364,7 @@ int type;
 	 */
 	pack_size= bf_bufsize(eth_pack);
 	if (ip_port->ip_dl.dl_eth.de_frame == NULL && pack_size <=
-		ip_port->ip_mtu + sizeof(*eth_hdr))
+		ipeth_max_frame(ip_port, eth_pack))
 	{
 		r= eth_send(ip_port->ip_dl.dl_eth.de_fd,
 			eth_pack, pack_size);
@@ -425,7 +428,7 @@ ip_port_t *ip_port;
 
 		pack_size= bf_bufsize(eth_pack);
 
-		if (pack_size > ip_port->ip_mtu+sizeof(*eth_hdr))
+		if (pack_size > ipeth_max_frame(ip_port, eth_pack))
 		{
 			/* Split the IP packet */
 			assert(eth_pack->acc_linkC == 1);
@@ -564,6 +567,7 @@ ether_addr_t *eth_addr;
 		if (eth_addr == NULL)
 		{
 			/* Destination is unreachable, delete packet. */
+			arp_qdrop(ip_port->ip_dl.dl_eth.de_port);
 			bf_afree(eth_pack);
 			continue;
 		}
@@ -602,6 +606,7 @@ ether_addr_t *eth_addr;
 
 		if (r == -EHOSTUNREACH)
 		{
+			arp_qdrop(ip_port->ip_dl.dl_eth.de_port);
 			bf_afree(eth_pack);
 			continue;
 		}
@@ -717,3 +722,24 @@ size_t pack_size;
 	else
 		ip_arrived(ip_port, pack);
 }
+
+static size_t ipeth_max_frame(ip_port, eth_pack)
+ip_port_t *ip_port;
+acc_t *eth_pack;
+{
+	acc_t *ip_pack;
+	ip_hdr_t *ip_hdr;
+
+	/* The device cuts large TCP packets into segments itself, those
+	 * need not be split.
+	 */
+	ip_pack= eth_pack->acc_next;
+	if (ip_port->ip_tso && ip_pack &&
+		ip_pack->acc_length >= IP_MIN_HDR_SIZE)
+	{
+		ip_hdr= (ip_hdr_t *)ptr2acc_data(ip_pack);
+		if (ip_hdr->ih_proto == IPPROTO_TCP)
+			return ip_port->ip_tso + sizeof(eth_hdr_t);
+	}
+	return ip_port->ip_mtu + sizeof(eth_hdr_t);
+}
@@ -65,6 +65,7 @@ typedef struct ip_port
 	u16_t ip_frame_id;
 	u16_t ip_mtu;
 	u16_t ip_mtu_max;		/* Max MTU for this kind of network */
+	u16_t ip_tso;			/* Max TCP packet the device segments */
 	ip_dev_t ip_dev_main;
 	ip_dev_t ip_dev_set_ipaddr;
 	ip_dev_send_t ip_dev_send;
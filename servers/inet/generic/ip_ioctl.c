@@ -655,7 +655,13 @@ ip_port_t *ip_port;
 	ip_hdr->ih_vers_ihl= (IP_VERSION << 4) | (hdr_len/4);
 	ip_hdr->ih_tos= 0;
 	ip_hdr->ih_length= htons(ip_port->ip_mtu);
+
+	/* The size of TCP packets the device segments, only for segments of
+	 * the full MTU.
+	 */
 	ip_hdr->ih_id= 0;
+	if (ip_port->ip_mtu == ip_port->ip_mtu_max)
+		ip_hdr->ih_id= htons(ip_port->ip_tso);
 	ip_hdr->ih_flags_fragoff= 0;
 	ip_hdr->ih_ttl= 0;
 	ip_hdr->ih_proto= 0;
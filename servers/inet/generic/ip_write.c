@@ -229,6 +229,12 @@ size_t data_len;
 	if (ip_hdr->ih_flags_fragoff & htons(IH_DONT_FRAG))
 	{
 		req_mtu= bf_bufsize(data);
+		if (req_mtu > ip_port->ip_mtu && req_mtu <= ip_port->ip_tso &&
+			ip_hdr->ih_proto == IPPROTO_TCP)
+		{
+			/* The device segments the packet, each segment fits */
+			req_mtu= ip_port->ip_mtu;
+		}
 		if (req_mtu > ip_port->ip_mtu)
 		{
 			DBLOCK(1, printk(
@@ -24,28 +24,35 @@ Copyright 1995 Philip Homburg
 #include "ip_int.h"
 #include "ipr.h"
 
-#define OROUTE_NR		128
-#define OROUTE_STATIC_NR	16
-#define OROUTE_HASH_ASS_NR	 4
-#define OROUTE_HASH_NR		32
-#define OROUTE_HASH_MASK	(OROUTE_HASH_NR-1)
-
-#define hash_oroute(port_nr, ipaddr, hash_tmp) (hash_tmp= (ipaddr), \
-	hash_tmp= (hash_tmp >> 20) ^ hash_tmp, \
-	hash_tmp= (hash_tmp >> 10) ^ hash_tmp, \
-	hash_tmp= (hash_tmp >> 5) ^ hash_tmp, \
-	(hash_tmp + (port_nr)) & OROUTE_HASH_MASK)
-
-typedef struct oroute_hash
+#define OROUTE_NR		128	/* Default size of the table */
+#define OROUTE_STATIC_NR	16	/* Static routes per OROUTE_NR */
+
+/* The output routes are found through a path compressed binary trie
+ * (Patricia trie) per port. A node stands for a prefix, keys are kept in
+ * host byte order. Nodes that carry routes point to the best route to
+ * their network, with the other routes chained through ort_nextgw and
+ * ort_nextdist. Nodes without routes only exist to join two subtries.
+ */
+typedef struct oroute_node
 {
-	ipaddr_t orh_addr;
-	oroute_t *orh_route;
-} oroute_hash_t;
-
-static oroute_t oroute_table[OROUTE_NR];
-static oroute_t *oroute_head;
+	u32_t orn_key;
+	int orn_len;
+	oroute_t *orn_route;
+	struct oroute_node *orn_parent;
+	struct oroute_node *orn_child[2];
+} oroute_node_t;
+
+#define ortn_mask(len)		((len) == 0 ? 0 : 0xffffffffUL << (32-(len)))
+#define ortn_bit(key, n)	(((key) >> (31-(n))) & 1)
+
+static oroute_t *oroute_table;
+static int oroute_nr;
+static oroute_t *oroute_freelist;
 static int static_oroute_nr;
-static oroute_hash_t oroute_hash_table[OROUTE_HASH_NR][OROUTE_HASH_ASS_NR];
+static int static_oroute_max;
+static oroute_node_t *oroute_nodes;
+static oroute_node_t *oroute_node_freelist;
+static oroute_node_t **oroute_trie;
 
 #define IROUTE_NR		512
 #define IROUTE_HASH_ASS_NR	 4
@@ -68,22 +75,58 @@ static iroute_t iroute_table[IROUTE_NR];
 static iroute_hash_t iroute_hash_table[IROUTE_HASH_NR][IROUTE_HASH_ASS_NR];
 
 static oroute_t *oroute_find_ent(int port_nr, ipaddr_t dest);
+static oroute_t *oroute_alloc(time_t currtim);
+static void oroute_free(oroute_t *oroute);
 static void oroute_del(oroute_t *oroute);
 static oroute_t *sort_dists(oroute_t *oroute);
 static oroute_t *sort_gws(oroute_t *oroute);
-static void oroute_uncache_nw(ipaddr_t dest, ipaddr_t netmask);
+static int ortn_len(ipaddr_t netmask);
+static oroute_node_t *ortn_lookup(int port_nr, ipaddr_t dest, int len,
+	int create);
+static oroute_t *ortn_match(int port_nr, ipaddr_t dest);
+static void ortn_prune(int port_nr, oroute_node_t *node);
 static void iroute_uncache_nw(ipaddr_t dest, ipaddr_t netmask);
 
+void ipr_prep()
+{
+	oroute_nr= oroute_conf_nr ? oroute_conf_nr : OROUTE_NR;
+	if (oroute_nr < OROUTE_STATIC_NR)
+		oroute_nr= OROUTE_STATIC_NR;
+	oroute_table= alloc(oroute_nr * sizeof(oroute_table[0]));
+
+	/* A trie holding n routes has less than 2n nodes. */
+	oroute_nodes= alloc(2 * oroute_nr * sizeof(oroute_nodes[0]));
+	oroute_trie= alloc(ip_conf_nr * sizeof(oroute_trie[0]));
+	if (!oroute_table || !oroute_nodes || !oroute_trie)
+		ip_panic(( "ipr: unable to allocate %d routes", oroute_nr ));
+}
+
 void ipr_init()
 {
 	int i;
 	oroute_t *oroute;
+	oroute_node_t *node;
 	iroute_t *iroute;
 
-	for (i= 0, oroute= oroute_table; i<OROUTE_NR; i++, oroute++)
+	oroute_freelist= NULL;
+	for (i= oroute_nr-1, oroute= &oroute_table[i]; i >= 0; i--, oroute--)
+	{
 		oroute->ort_flags= ORTF_EMPTY;
+		oroute->ort_nextgw= oroute_freelist;
+		oroute_freelist= oroute;
+	}
+	oroute_node_freelist= NULL;
+	for (i= 2*oroute_nr-1, node= &oroute_nodes[i]; i >= 0; i--, node--)
+	{
+		node->orn_child[0]= oroute_node_freelist;
+		oroute_node_freelist= node;
+	}
+	for (i= 0; i<ip_conf_nr; i++)
+		oroute_trie[i]= NULL;
 	static_oroute_nr= 0;
-	assert(OROUTE_HASH_ASS_NR == 4);
+	static_oroute_max= oroute_nr / OROUTE_NR * OROUTE_STATIC_NR;
+	if (static_oroute_max < OROUTE_STATIC_NR)
+		static_oroute_max= OROUTE_STATIC_NR;
 
 	for (i= 0, iroute= iroute_table; i<IROUTE_NR; i++, iroute++)
 		iroute->irt_flags= IRTF_EMPTY;
@@ -227,13 +270,12 @@ int static_route;
 i32_t preference;
 oroute_t **oroute_p;
 {
-	int i;
+	int len;
 	ip_port_t *ip_port;
-	oroute_t *oroute, *oldest_route, *prev, *nw_route, *gw_route, 
-		*prev_route;
+	oroute_node_t *node;
+	oroute_t *oroute, *new_route, *prev, *nw_route, *gw_route;
 	time_t currtim, exp_tim, exp_tim_orig;
 
-	oldest_route= 0;
 	currtim= get_time();
 	if (timeout)
 		exp_tim= timeout+currtim;
@@ -258,25 +300,27 @@ oroute_t **oroute_p;
 		return -EINVAL;
 	}
 
+	/* The trie only holds prefixes, the host part of dest is ignored. */
+	len= ortn_len(subnetmask);
+	if (len < 0)
+	{
+		DBLOCK(1, printk("ip[%d]: (ipr_add_oroute) invalid netmask: ",
+			port_nr); writeIpAddr(subnetmask); printk("\n"));
+		return -EINVAL;
+	}
+	dest &= subnetmask;
+
 	if (static_route)
 	{
-		if (static_oroute_nr >= OROUTE_STATIC_NR)
+		if (static_oroute_nr >= static_oroute_max)
 			return -ENOMEM;
 		static_oroute_nr++;
 	}
 	else
 	{
 		/* Try to track down any old routes. */
-		for(oroute= oroute_head; oroute; oroute= oroute->ort_nextnw)
-		{
-			if (oroute->ort_port != port_nr)
-				continue;
-			if (oroute->ort_dest == dest &&
-				oroute->ort_subnetmask == subnetmask)
-			{
-				break;
-			}
-		}
+		node= ortn_lookup(port_nr, dest, len, FALSE);
+		oroute= node ? node->orn_route : NULL;
 		for(; oroute; oroute= oroute->ort_nextgw)
 		{
 			if (oroute->ort_gateway == gateway)
@@ -309,85 +353,29 @@ oroute_t **oroute_p;
 					exp_tim= exp_tim_orig;
 				}
 			}
-			oroute_del(oroute);
-			oroute->ort_flags= 0;
-			oldest_route= oroute;
+			oroute_free(oroute);
 		}
 	}
 
-	if (oldest_route == NULL)
-	{
-		/* Look for an unused entry, or remove an existing one */
-		for (i= 0, oroute= oroute_table; i<OROUTE_NR; i++, oroute++)
-		{
-			if ((oroute->ort_flags & ORTF_INUSE) == 0)
-				break;
-			if (oroute->ort_exp_tim && oroute->ort_exp_tim < 
-				currtim)
-			{
-				oroute_del(oroute);
-				oroute->ort_flags= 0;
-				break;
-			}
-			if (oroute->ort_flags & ORTF_STATIC)
-				continue;
-			if (oroute->ort_dest == 0)
-			{
-				/* Never remove default routes. */
-				continue;
-			}
-			if (oldest_route == NULL)
-			{
-				oldest_route= oroute;
-				continue;
-			}
-			if (oroute->ort_timestamp < oldest_route->ort_timestamp)
-			{
-				oldest_route= oroute;
-			}
-		}
-		if (i < OROUTE_NR)
-			oldest_route= oroute;
-		else
-		{
-			assert(oldest_route);
-			oroute_del(oldest_route);
-			oldest_route->ort_flags= 0;
-		}
-	}
-
-	oldest_route->ort_dest= dest;
-	oldest_route->ort_gateway= gateway;
-	oldest_route->ort_subnetmask= subnetmask;
-	oldest_route->ort_exp_tim= exp_tim;
-	oldest_route->ort_timestamp= currtim;
-	oldest_route->ort_dist= dist;
-	oldest_route->ort_mtu= mtu;
-	oldest_route->ort_port= port_nr;
-	oldest_route->ort_flags= ORTF_INUSE;
-	oldest_route->ort_pref= preference;
+	new_route= oroute_alloc(currtim);
+	new_route->ort_dest= dest;
+	new_route->ort_gateway= gateway;
+	new_route->ort_subnetmask= subnetmask;
+	new_route->ort_exp_tim= exp_tim;
+	new_route->ort_timestamp= currtim;
+	new_route->ort_dist= dist;
+	new_route->ort_mtu= mtu;
+	new_route->ort_port= port_nr;
+	new_route->ort_flags= ORTF_INUSE;
+	new_route->ort_pref= preference;
 	if (static_route)
-		oldest_route->ort_flags |= ORTF_STATIC;
+		new_route->ort_flags |= ORTF_STATIC;
 	
-	/* Insert the route by tearing apart the routing table, 
-	 * and insert the entry during the reconstruction.
+	/* Take the list of routes with the same gateway out of the network's
+	 * list, add the new route to it and put it back in order.
 	 */
-	for (prev= 0, nw_route= oroute_head; nw_route; 
-		prev= nw_route, nw_route= nw_route->ort_nextnw)
-	{
-		if (nw_route->ort_port != port_nr)
-			continue;
-		if (nw_route->ort_dest == dest &&
-			nw_route->ort_subnetmask == subnetmask)
-		{
-			if (prev)
-				prev->ort_nextnw= nw_route->ort_nextnw;
-			else
-				oroute_head= nw_route->ort_nextnw;
-			break;
-		}
-	}
-	prev_route= nw_route;
+	node= ortn_lookup(port_nr, dest, len, TRUE);
+	nw_route= node->orn_route;
 	for(prev= NULL, gw_route= nw_route; gw_route; 
 		prev= gw_route, gw_route= gw_route->ort_nextgw)
 	{
@@ -400,18 +388,12 @@ oroute_t **oroute_p;
 			break;
 		}
 	}
-	oldest_route->ort_nextdist= gw_route;
-	gw_route= oldest_route;
-	gw_route= sort_dists(gw_route);
+	new_route->ort_nextdist= gw_route;
+	gw_route= sort_dists(new_route);
 	gw_route->ort_nextgw= nw_route;
-	nw_route= gw_route;
-	nw_route= sort_gws(nw_route);
-	nw_route->ort_nextnw= oroute_head;
-	oroute_head= nw_route;
-	if (nw_route != prev_route)
-		oroute_uncache_nw(nw_route->ort_dest, nw_route->ort_subnetmask);
+	node->orn_route= sort_gws(gw_route);
 	if (oroute_p != NULL)
-		*oroute_p= oldest_route;
+		*oroute_p= new_route;
 	return 0;
 }
 
@@ -422,33 +404,31 @@ ipaddr_t subnetmask;
 ipaddr_t gateway;
 int static_route;
 {
-	int i;
+	int len;
+	oroute_node_t *node;
 	oroute_t *oroute;
 
-	for(i= 0, oroute= oroute_table; i<OROUTE_NR; i++, oroute++)
+	len= ortn_len(subnetmask);
+	if (len < 0)
+		return -ESRCH;
+	node= ortn_lookup(port_nr, dest & subnetmask, len, FALSE);
+	if (node == NULL)
+		return -ESRCH;
+
+	for (oroute= node->orn_route; oroute; oroute= oroute->ort_nextgw)
 	{
-		if ((oroute->ort_flags & ORTF_INUSE) == 0)
-			continue;
-		if (oroute->ort_port != port_nr ||
-			oroute->ort_dest != dest ||
-			oroute->ort_subnetmask != subnetmask ||
-			oroute->ort_gateway != gateway)
-		{
-			continue;
-		}
-		if (!!(oroute->ort_flags & ORTF_STATIC) != static_route)
-			continue;
-		break;
+		if (oroute->ort_gateway == gateway)
+			break;
 	}
-
-	if (i == OROUTE_NR)
+	for (; oroute; oroute= oroute->ort_nextdist)
+	{
+		if (!!(oroute->ort_flags & ORTF_STATIC) == static_route)
+			break;
+	}
+	if (oroute == NULL)
 		return -ESRCH;
 
-	if (static_route)
-		static_oroute_nr--;
-
-	oroute_del(oroute);
-	oroute->ort_flags &= ~ORTF_INUSE;
+	oroute_free(oroute);
 	return 0;
 }
 
@@ -478,7 +458,7 @@ ipaddr_t mask;
 		addr= mask= htonl(0xffffffff);
 	}
 
-	for(i= 0, oroute= oroute_table; i<OROUTE_NR; i++, oroute++)
+	for(i= 0, oroute= oroute_table; i<oroute_nr; i++, oroute++)
 	{
 		if ((oroute->ort_flags & ORTF_INUSE) == 0)
 			continue;
@@ -494,10 +474,7 @@ ipaddr_t mask;
 			writeIpAddr(oroute->ort_gateway);
 			printk("\n"));
 
-		if (oroute->ort_flags & ORTF_STATIC)
-			static_oroute_nr--;
-		oroute_del(oroute);
-		oroute->ort_flags &= ~ORTF_INUSE;
+		oroute_free(oroute);
 	}
 }
 
@@ -513,7 +490,7 @@ time_t timeout;
 	int result;
 
 	currtim= get_time();
-	for (i= 0, route_ind= oroute_table; i<OROUTE_NR; i++, route_ind++)
+	for (i= 0, route_ind= oroute_table; i<oroute_nr; i++, route_ind++)
 	{
 		if (!(route_ind->ort_flags & ORTF_INUSE))
 			continue;
@@ -695,19 +672,18 @@ nwio_route_t *route_ent;
 {
 	oroute_t *oroute;
 
-	if (ent_no<0 || ent_no>= OROUTE_NR)
+	if (ent_no<0 || ent_no>= oroute_nr)
 		return -ENOENT;
 
 	oroute= &oroute_table[ent_no];
 	if ((oroute->ort_flags & ORTF_INUSE) && oroute->ort_exp_tim &&
 					oroute->ort_exp_tim < get_time())
 	{
-		oroute_del(oroute);
-		oroute->ort_flags &= ~ORTF_INUSE;
+		oroute_free(oroute);
 	}
 
 	route_ent->nwr_ent_no= ent_no;
-	route_ent->nwr_ent_count= OROUTE_NR;
+	route_ent->nwr_ent_count= oroute_nr;
 	route_ent->nwr_dest= oroute->ort_dest;
 	route_ent->nwr_netmask= oroute->ort_subnetmask;
 	route_ent->nwr_gateway= oroute->ort_gateway;
@@ -730,98 +706,84 @@ static oroute_t *oroute_find_ent(port_nr, dest)
 int port_nr;
 ipaddr_t dest;
 {
-	int hash;
-	oroute_hash_t *oroute_hash;
-	oroute_hash_t tmp_hash;
-	oroute_t *oroute, *bestroute;
+	oroute_t *oroute;
 	time_t currtim;
-	unsigned long hash_tmp;
-	u32_t tmp_mask;
 
 	currtim= get_time();
-
-	hash= hash_oroute(port_nr, dest, hash_tmp);
-	oroute_hash= &oroute_hash_table[hash][0];
-	if (oroute_hash[0].orh_addr == dest)
-		oroute= oroute_hash[0].orh_route;
-	else if (oroute_hash[1].orh_addr == dest)
-	{
-		tmp_hash= oroute_hash[1];
-		oroute_hash[1]= oroute_hash[0];
-		oroute_hash[0]= tmp_hash;
-		oroute= tmp_hash.orh_route;
-	}
-	else if (oroute_hash[2].orh_addr == dest)
-	{
-		tmp_hash= oroute_hash[2];
-		oroute_hash[2]= oroute_hash[1];
-		oroute_hash[1]= oroute_hash[0];
-		oroute_hash[0]= tmp_hash;
-		oroute= tmp_hash.orh_route;
-	}
-	else if (oroute_hash[3].orh_addr == dest)
-	{
-		tmp_hash= oroute_hash[3];
-		oroute_hash[3]= oroute_hash[2];
-		oroute_hash[2]= oroute_hash[1];
-		oroute_hash[1]= oroute_hash[0];
-		oroute_hash[0]= tmp_hash;
-		oroute= tmp_hash.orh_route;
-	}
-	else
-		oroute= NULL;
-	if (oroute)
+	for (;;)
 	{
+		oroute= ortn_match(port_nr, dest);
+		if (oroute == NULL)
+			return NULL;
 		assert(oroute->ort_port == port_nr);
-		if (oroute->ort_exp_tim && oroute->ort_exp_tim<currtim)
-		{
-			oroute_del(oroute);
-			oroute->ort_flags &= ~ORTF_INUSE;
-		}
-		else
+		if (!oroute->ort_exp_tim || oroute->ort_exp_tim >= currtim)
 			return oroute;
+
+		/* Expired, the next best route may be more specific. */
+		oroute_free(oroute);
 	}
+}
 
-	bestroute= NULL;
-	for (oroute= oroute_head; oroute; oroute= oroute->ort_nextnw)
+
+static oroute_t *oroute_alloc(currtim)
+time_t currtim;
+{
+	int i;
+	oroute_t *oroute, *oldest_route;
+
+	if (oroute_freelist == NULL)
 	{
-		if (((dest ^ oroute->ort_dest) & oroute->ort_subnetmask) != 0)
-			continue;
-		if (oroute->ort_port != port_nr)
-			continue;
-		if (!bestroute)
-		{
-			bestroute= oroute;
-			continue;
-		}
-		assert(oroute->ort_dest != bestroute->ort_dest);
-		/* Using two ntohl macros in one expression
-		 * is not allowed (tmp_l is modified twice)
-		 */
-		tmp_mask= ntohl(oroute->ort_subnetmask);
-		if (tmp_mask > ntohl(bestroute->ort_subnetmask))
+		/* Table is full, remove an expired or the oldest entry */
+		oldest_route= NULL;
+		for (i= 0, oroute= oroute_table; i<oroute_nr; i++, oroute++)
 		{
-			bestroute= oroute;
-			continue;
+			assert(oroute->ort_flags & ORTF_INUSE);
+			if (oroute->ort_exp_tim && oroute->ort_exp_tim < 
+				currtim)
+			{
+				oldest_route= oroute;
+				break;
+			}
+			if (oroute->ort_flags & ORTF_STATIC)
+				continue;
+			if (oroute->ort_dest == 0)
+			{
+				/* Never remove default routes. */
+				continue;
+			}
+			if (oldest_route == NULL ||
+				oroute->ort_timestamp <
+				oldest_route->ort_timestamp)
+			{
+				oldest_route= oroute;
+			}
 		}
+		assert(oldest_route);
+		oroute_free(oldest_route);
 	}
-	if (bestroute == NULL)
-		return NULL;
+	oroute= oroute_freelist;
+	oroute_freelist= oroute->ort_nextgw;
+	return oroute;
+}
 
-	oroute_hash[3]= oroute_hash[2];
-	oroute_hash[2]= oroute_hash[1];
-	oroute_hash[1]= oroute_hash[0];
-	oroute_hash[0].orh_addr= dest;
-	oroute_hash[0].orh_route= bestroute;
 
-	return bestroute;
+static void oroute_free(oroute)
+oroute_t *oroute;
+{
+	oroute_del(oroute);
+	if (oroute->ort_flags & ORTF_STATIC)
+		static_oroute_nr--;
+	oroute->ort_flags= ORTF_EMPTY;
+	oroute->ort_nextgw= oroute_freelist;
+	oroute_freelist= oroute;
 }
 
 
 static void oroute_del(oroute)
 oroute_t *oroute;
 {
-	oroute_t *prev, *nw_route, *gw_route, *dist_route, *prev_route;
+	oroute_node_t *node;
+	oroute_t *prev, *nw_route, *gw_route, *dist_route;
 
 	DBLOCK(0x10, 
 		printk("ip[%d]: deleting oroute to ", oroute->ort_port);
@@ -836,22 +798,10 @@ oroute_t *oroute;
 			(long)oroute->ort_pref, (long)oroute->ort_mtu);
 		printk("flags 0x%x\n", oroute->ort_flags));
 
-	for (prev= NULL, nw_route= oroute_head; nw_route; 
-				prev= nw_route, nw_route= nw_route->ort_nextnw)
-	{
-		if (oroute->ort_port == nw_route->ort_port &&
-			oroute->ort_dest == nw_route->ort_dest &&
-			oroute->ort_subnetmask == nw_route->ort_subnetmask)
-		{
-			break;
-		}
-	}
-	assert(nw_route);
-	if (prev)
-		prev->ort_nextnw= nw_route->ort_nextnw;
-	else
-		oroute_head= nw_route->ort_nextnw;
-	prev_route= nw_route;
+	node= ortn_lookup(oroute->ort_port, oroute->ort_dest,
+		ortn_len(oroute->ort_subnetmask), FALSE);
+	assert(node);
+	nw_route= node->orn_route;
 	for (prev= NULL, gw_route= nw_route; gw_route; 
 				prev= gw_route, gw_route= gw_route->ort_nextgw)
 	{
@@ -880,17 +830,9 @@ oroute_t *oroute;
 		gw_route->ort_nextgw= nw_route;
 		nw_route= gw_route;
 	}
-	nw_route= sort_gws(nw_route);
-	if (nw_route != NULL)
-	{
-		nw_route->ort_nextnw= oroute_head;
-		oroute_head= nw_route;
-	}
-	if (nw_route != prev_route)
-	{
-		oroute_uncache_nw(prev_route->ort_dest, 
-			prev_route->ort_subnetmask);
-	}
+	node->orn_route= sort_gws(nw_route);
+	if (node->orn_route == NULL)
+		ortn_prune(oroute->ort_port, node);
 }
 
 
@@ -982,24 +924,147 @@ oroute_t *oroute;
 }
 
 
-static void oroute_uncache_nw(dest, netmask)
-ipaddr_t dest;
+static int ortn_len(netmask)
 ipaddr_t netmask;
 {
-	int i, j;
-	oroute_hash_t *oroute_hash;
+	/* Prefix length of a netmask, -1 if the mask is not contiguous. */
+	u32_t mask;
+	int len;
+
+	mask= ntohl(netmask);
+	for (len= 0; mask & 0x80000000UL; len++)
+		mask <<= 1;
+	return mask == 0 ? len : -1;
+}
+
+
+static oroute_node_t *ortn_lookup(port_nr, dest, len, create)
+int port_nr;
+ipaddr_t dest;
+int len;
+int create;
+{
+	/* Find the node of the prefix dest/len. If it is not there and
+	 * create is set, add it to the trie, splitting an edge if needed.
+	 */
+	oroute_node_t **linkp, *node, *parent, *new_node, *glue;
+	u32_t key, diff;
+	int common;
+
+	key= ntohl(dest) & ortn_mask(len);
+	parent= NULL;
+	diff= 0;
+	linkp= &oroute_trie[port_nr];
+	while ((node= *linkp) != NULL)
+	{
+		diff= (node->orn_key ^ key) &
+			ortn_mask(node->orn_len < len ? node->orn_len : len);
+		if (diff != 0 || node->orn_len > len)
+			break;
+		if (node->orn_len == len)
+			return node;
+		parent= node;
+		linkp= &node->orn_child[ortn_bit(key, node->orn_len)];
+	}
+	if (!create)
+		return NULL;
 
-	for (i= 0, oroute_hash= &oroute_hash_table[0][0];
-		i<OROUTE_HASH_NR; i++, oroute_hash += OROUTE_HASH_ASS_NR)
+	new_node= oroute_node_freelist;
+	assert(new_node);
+	oroute_node_freelist= new_node->orn_child[0];
+	new_node->orn_key= key;
+	new_node->orn_len= len;
+	new_node->orn_route= NULL;
+	new_node->orn_child[0]= new_node->orn_child[1]= NULL;
+	new_node->orn_parent= parent;
+	*linkp= new_node;
+	if (node == NULL)
+		return new_node;
+
+	if (diff == 0)
 	{
-		for (j= 0; j<OROUTE_HASH_ASS_NR; j++)
-		{
-			if (((oroute_hash[j].orh_addr ^ dest) & netmask) == 0)
-			{
-				oroute_hash[j].orh_addr= 0;
-				oroute_hash[j].orh_route= NULL;
-			}
-		}
+		/* The new prefix is a prefix of node */
+		new_node->orn_child[ortn_bit(node->orn_key, len)]= node;
+		node->orn_parent= new_node;
+		return new_node;
+	}
+
+	/* The prefixes differ in a bit, join them at the first one */
+	for (common= 0; !(diff & 0x80000000UL); common++)
+		diff <<= 1;
+	glue= oroute_node_freelist;
+	assert(glue);
+	oroute_node_freelist= glue->orn_child[0];
+	glue->orn_key= key & ortn_mask(common);
+	glue->orn_len= common;
+	glue->orn_route= NULL;
+	glue->orn_parent= parent;
+	glue->orn_child[ortn_bit(key, common)]= new_node;
+	glue->orn_child[ortn_bit(node->orn_key, common)]= node;
+	new_node->orn_parent= glue;
+	node->orn_parent= glue;
+	*linkp= glue;
+	return new_node;
+}
+
+
+static oroute_t *ortn_match(port_nr, dest)
+int port_nr;
+ipaddr_t dest;
+{
+	/* Longest prefix match: the best route of the deepest node on the
+	 * path of dest that has routes.
+	 */
+	oroute_node_t *node;
+	oroute_t *bestroute;
+	u32_t key;
+
+	key= ntohl(dest);
+	bestroute= NULL;
+	for (node= oroute_trie[port_nr]; node; )
+	{
+		if ((node->orn_key ^ key) & ortn_mask(node->orn_len))
+			break;
+		if (node->orn_route)
+			bestroute= node->orn_route;
+		if (node->orn_len == 32)
+			break;
+		node= node->orn_child[ortn_bit(key, node->orn_len)];
+	}
+	return bestroute;
+}
+
+
+static void ortn_prune(port_nr, node)
+int port_nr;
+oroute_node_t *node;
+{
+	/* Remove a node that lost its last route, and the node that joined
+	 * it to the rest of the trie if that one is no longer needed.
+	 */
+	oroute_node_t *parent, *child, **linkp;
+
+	while (node && node->orn_route == NULL)
+	{
+		if (node->orn_child[0] && node->orn_child[1])
+			break;
+		child= node->orn_child[0] ? node->orn_child[0] :
+			node->orn_child[1];
+		parent= node->orn_parent;
+		if (parent == NULL)
+			linkp= &oroute_trie[port_nr];
+		else if (parent->orn_child[0] == node)
+			linkp= &parent->orn_child[0];
+		else
+			linkp= &parent->orn_child[1];
+		*linkp= child;
+		if (child)
+			child->orn_parent= parent;
+		node->orn_child[0]= oroute_node_freelist;
+		oroute_node_freelist= node;
+		if (child)
+			break;
+		node= parent;
 	}
 }
 
@@ -29,8 +29,7 @@ typedef struct oroute
 	time_t ort_timestamp;
 	int ort_flags;
 
-	struct oroute *ort_nextnw;
-	struct oroute *ort_nextgw;
+	struct oroute *ort_nextgw;	/* also links the free entries */
 	struct oroute *ort_nextdist;
 } oroute_t;
 
@@ -67,6 +66,7 @@ typedef struct iroute
 
 iroute_t *iroute_frag(int port_nr, ipaddr_t dest);
 int oroute_frag(int port_nr, ipaddr_t dest, int ttl, size_t msgsize, ipaddr_t *nexthop);
+void ipr_prep(void);
 void ipr_init(void);
 int ipr_get_iroute(int ent_no, nwio_route_t *route_ent);
 int ipr_add_iroute(int port_nr, ipaddr_t dest, ipaddr_t subnetmask, ipaddr_t gateway,
@@ -39,6 +39,11 @@ static int tcp_select(int fd, unsigned operations);
 static acc_t *tcp_get_data(int fd, size_t offset, size_t count, int for_ioctl);
 static int tcp_put_data(int fd, size_t offset, acc_t *data, int for_ioctl);
 static void tcp_put_pkt(int fd, acc_t *data, size_t datalen);
+static int tcp_gro_match(tcp_port_t *tcp_port, ip_hdr_t *ip_hdr, tcp_hdr_t *tcp_hdr,
+			 size_t data_len);
+static void tcp_gro_deliver(tcp_port_t *tcp_port);
+static void tcp_pkt2conn(tcp_port_t *tcp_port, acc_t *ip_pack, acc_t *tcp_pack,
+			 acc_t *data, size_t data_len);
 static void read_ip_packets(tcp_port_t *port);
 static int tcp_setconf(tcp_fd_t *tcp_fd);
 static int tcp_setopt(tcp_fd_t *tcp_fd);
@@ -106,6 +111,11 @@ void tcp_init()
 		tcp_port->tp_state= TPS_EMPTY;
 		tcp_port->tp_snd_head= NULL;
 		tcp_port->tp_snd_tail= NULL;
+		tcp_port->tp_tso= 0;
+		tcp_port->tp_gro_ip= NULL;
+		tcp_port->tp_gro_tcp= NULL;
+		tcp_port->tp_gro_data= NULL;
+		tcp_port->tp_gro_len= 0;
 		ev_init(&tcp_port->tp_snd_event);
 		for (j= 0; j<TCP_CONN_HASH_NR; j++)
 		{
@@ -520,16 +530,14 @@ acc_t *data;
 size_t datalen;
 {
 	tcp_port_t *tcp_port;
-	tcp_conn_t *tcp_conn, **conn_p;
+	tcp_conn_t *tcp_conn;
 	ip_hdr_t *ip_hdr;
-	tcp_hdr_t *tcp_hdr;
+	tcp_hdr_t *tcp_hdr, *gro_hdr;
 	acc_t *ip_pack, *tcp_pack;
 	size_t ip_datalen, tcp_datalen, ip_hdr_len, tcp_hdr_len;
 	u16_t sum, mtu;
-	u32_t bits;
-	int i, hash;
-	ipaddr_t srcaddr, dstaddr, ipaddr, mask;
-	tcpport_t srcport, dstport;
+	int i;
+	ipaddr_t ipaddr, mask;
 
 	tcp_port= &tcp_port_table[fd];
 
@@ -548,6 +556,7 @@ size_t datalen;
 			tcp_port->tp_ipaddr= ipaddr;
 			tcp_port->tp_subnetmask= mask;
 			tcp_port->tp_mtu= mtu;
+			tcp_port->tp_tso= ntohs(ip_hdr->ih_id);
 			DBLOCK(1, printk("tcp_put_pkt: using address ");
 				writeIpAddr(ipaddr);
 				printk(", netmask ");
@@ -630,6 +639,139 @@ size_t datalen;
 		return;
 	}
 
+	/* Receive coalescing. In order data segments of a connection are
+	 * merged and go through the connection as one.
+	 */
+	if (tcp_port->tp_gro_ip)
+	{
+		if (tcp_gro_match(tcp_port, ip_hdr, tcp_hdr, tcp_datalen))
+		{
+			tcp_port->tp_gro_data= bf_append(tcp_port->tp_gro_data,
+				data);
+			tcp_port->tp_gro_len += tcp_datalen;
+			gro_hdr= (tcp_hdr_t *)ptr2acc_data(tcp_port->tp_gro_tcp);
+			gro_hdr->th_flags |= (tcp_hdr->th_flags & THF_PSH);
+			gro_hdr->th_window= tcp_hdr->th_window;
+			bf_afree(ip_pack);
+			bf_afree(tcp_pack);
+
+			if ((gro_hdr->th_flags & THF_PSH) ||
+				tcp_port->tp_gro_len + tcp_port->tp_mtu >
+				TCP_GRO_MAX_SIZE)
+			{
+				tcp_gro_deliver(tcp_port);
+			}
+			return;
+		}
+		tcp_gro_deliver(tcp_port);
+	}
+	if (tcp_datalen != 0 && ip_hdr_len == IP_MIN_HDR_SIZE &&
+		tcp_hdr_len == TCP_MIN_HDR_SIZE &&
+		(tcp_hdr->th_flags & TH_FLAGS_MASK) == THF_ACK)
+	{
+		/* Hold the segment until tcp_gro_flush, or until a segment
+		 * arrives that can't be merged.
+		 */
+		tcp_port->tp_gro_ip= ip_pack;
+		tcp_port->tp_gro_tcp= tcp_pack;
+		tcp_port->tp_gro_data= data;
+		tcp_port->tp_gro_len= tcp_datalen;
+		return;
+	}
+
+	tcp_pkt2conn(tcp_port, ip_pack, tcp_pack, data, tcp_datalen);
+}
+
+static int tcp_gro_match(tcp_port, ip_hdr, tcp_hdr, data_len)
+tcp_port_t *tcp_port;
+ip_hdr_t *ip_hdr;
+tcp_hdr_t *tcp_hdr;
+size_t data_len;
+{
+	ip_hdr_t *gro_ip_hdr;
+	tcp_hdr_t *gro_tcp_hdr;
+	u8_t flags;
+
+	gro_ip_hdr= (ip_hdr_t *)ptr2acc_data(tcp_port->tp_gro_ip);
+	gro_tcp_hdr= (tcp_hdr_t *)ptr2acc_data(tcp_port->tp_gro_tcp);
+
+	flags= tcp_hdr->th_flags & TH_FLAGS_MASK;
+	if (data_len == 0 || (flags != THF_ACK && flags != (THF_ACK|THF_PSH)))
+		return 0;
+	if ((ip_hdr->ih_vers_ihl & IH_IHL_MASK) << 2 != IP_MIN_HDR_SIZE ||
+		(tcp_hdr->th_data_off & TH_DO_MASK) >> 2 != TCP_MIN_HDR_SIZE)
+	{
+		return 0;
+	}
+	if (tcp_port->tp_gro_len + data_len > TCP_GRO_MAX_SIZE)
+		return 0;
+
+	return (ip_hdr->ih_src == gro_ip_hdr->ih_src &&
+		ip_hdr->ih_dst == gro_ip_hdr->ih_dst &&
+		tcp_hdr->th_srcport == gro_tcp_hdr->th_srcport &&
+		tcp_hdr->th_dstport == gro_tcp_hdr->th_dstport &&
+		tcp_hdr->th_ack_nr == gro_tcp_hdr->th_ack_nr &&
+		ntohl(tcp_hdr->th_seq_nr) == ntohl(gro_tcp_hdr->th_seq_nr) +
+		tcp_port->tp_gro_len);
+}
+
+static void tcp_gro_deliver(tcp_port)
+tcp_port_t *tcp_port;
+{
+	acc_t *ip_pack, *tcp_pack, *data;
+	size_t data_len;
+
+	ip_pack= tcp_port->tp_gro_ip;
+	tcp_pack= tcp_port->tp_gro_tcp;
+	data= tcp_port->tp_gro_data;
+	data_len= tcp_port->tp_gro_len;
+	tcp_port->tp_gro_ip= NULL;
+	tcp_port->tp_gro_tcp= NULL;
+	tcp_port->tp_gro_data= NULL;
+	tcp_port->tp_gro_len= 0;
+
+	tcp_pkt2conn(tcp_port, ip_pack, tcp_pack, data, data_len);
+}
+
+/*
+tcp_gro_flush
+*/
+
+int tcp_gro_flush()
+{
+	int i, n;
+	tcp_port_t *tcp_port;
+
+	n= 0;
+	for (i=0, tcp_port= tcp_port_table; i<tcp_conf_nr; i++, tcp_port++)
+	{
+		if (tcp_port->tp_gro_ip)
+		{
+			tcp_gro_deliver(tcp_port);
+			n++;
+		}
+	}
+	return n;
+}
+
+static void tcp_pkt2conn(tcp_port, ip_pack, tcp_pack, data, data_len)
+tcp_port_t *tcp_port;
+acc_t *ip_pack;
+acc_t *tcp_pack;
+acc_t *data;
+size_t data_len;
+{
+	tcp_conn_t *tcp_conn, **conn_p;
+	ip_hdr_t *ip_hdr;
+	tcp_hdr_t *tcp_hdr;
+	u32_t bits;
+	int hash;
+	ipaddr_t srcaddr, dstaddr;
+	tcpport_t srcport, dstport;
+
+	ip_hdr= (ip_hdr_t *)ptr2acc_data(ip_pack);
+	tcp_hdr= (tcp_hdr_t *)ptr2acc_data(tcp_pack);
+
 	srcaddr= ip_hdr->ih_src;
 	dstaddr= ip_hdr->ih_dst;
 	srcport= tcp_hdr->th_srcport;
@@ -705,7 +847,7 @@ size_t datalen;
 	}
 	assert(tcp_conn->tc_busy == 0);
 	tcp_conn->tc_busy++;
-	tcp_frag2conn(tcp_conn, ip_hdr, tcp_hdr, data, tcp_datalen);
+	tcp_frag2conn(tcp_conn, ip_hdr, tcp_hdr, data, data_len);
 	tcp_conn->tc_busy--;
 	bf_afree(ip_pack);
 	bf_afree(tcp_pack);
@@ -18,6 +18,12 @@ Copyright 1995 Philip Homburg
 
 #define TCP_MAX_DATAGRAM	8192
 
+#ifndef TCP_GRO_MAX_SIZE
+#define TCP_GRO_MAX_SIZE	(16*1024)	/* Max. data of coalesced
+						 * segments
+						 */
+#endif
+
 #ifndef TCP_MAX_SND_WND_SIZE
 #define TCP_MAX_SND_WND_SIZE	(32*1024)
 #endif
@@ -95,5 +101,6 @@ int tcp_write(int fd, size_t count);
 int tcp_ioctl(int fd, ioreq_t req);
 int tcp_cancel(int fd, int which_operation);
 void tcp_close(int fd);
+int tcp_gro_flush(void);
 
 #endif /* TCP_H */
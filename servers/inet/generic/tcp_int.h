@@ -31,6 +31,11 @@ typedef struct tcp_port
 	ipaddr_t tp_ipaddr;
 	ipaddr_t tp_subnetmask;
 	u16_t tp_mtu;
+	u16_t tp_tso;		/* Max packet the device segments, or 0 */
+	acc_t *tp_gro_ip;	/* Held segment for receive coalescing */
+	acc_t *tp_gro_tcp;
+	acc_t *tp_gro_data;
+	size_t tp_gro_len;
 	struct tcp_conn *tp_snd_head;
 	struct tcp_conn *tp_snd_tail;
 	event_t tp_snd_event;
@@ -27,6 +27,7 @@ Copyright 1995 Philip Homburg
 #include "tcp_int.h"
 
 static acc_t *make_pack(tcp_conn_t *tcp_conn);
+static u16_t tso_seg_max(tcp_conn_t *tcp_conn, u16_t mss);
 static void tcp_send_timeout(int conn, struct timer *timer);
 static void do_snd_event(event_t *ev, ev_arg_t arg);
 
@@ -173,7 +174,7 @@ tcp_conn_t *tcp_conn;
 	ip_hdr_t *ip_hdr;
 	int tot_hdr_size, ip_hdr_len, no_push, head, more2write;
 	u32_t seg_seq, seg_lo_data, queue_lo_data, seg_hi, seg_hi_data;
-	u16_t seg_up, mss;
+	u16_t seg_up, mss, seg_max;
 	u8_t seg_flags;
 	size_t pack_size;
 	clock_t curr_time, new_dis;
@@ -353,16 +354,33 @@ tcp_conn_t *tcp_conn;
 					tot_hdr_size);
 				mss= tcp_conn->tc_mtu-tot_hdr_size;
 			}
-			if (seg_hi_data - seg_lo_data > mss)
+
+			/* With TSO a packet can hold several segments. Urgent
+			 * data would be flagged in each of them.
+			 */
+			seg_max= mss;
+			if (tot_hdr_size == IP_TCP_MIN_HDR_SIZE &&
+				!tcp_GEmod4G(tcp_conn->tc_SND_UP, seg_lo_data))
+			{
+				seg_max= tso_seg_max(tcp_conn, mss);
+			}
+			if (seg_hi_data - seg_lo_data > seg_max)
 			{
-				/* Truncate to at most one segment */
-				seg_hi_data= seg_lo_data + mss;
+				/* Truncate to at most one packet */
+				seg_hi_data= seg_lo_data + seg_max;
 				seg_hi= seg_hi_data;
 				seg_flags &= ~THF_FIN;
 			}
+			if (no_push && seg_hi_data - seg_lo_data > mss)
+			{
+				/* Only whole segments */
+				seg_hi_data= seg_lo_data +
+					(seg_hi_data-seg_lo_data)/mss*mss;
+				seg_hi= seg_hi_data;
+			}
 
 			if (no_push &&
-				seg_hi_data-seg_lo_data != mss)
+				(seg_hi_data-seg_lo_data) % mss != 0)
 			{
 				DBLOCK(0x20, printk(
 				"no data: no push for partial segment\n"));
@@ -1445,3 +1463,30 @@ int error;
 	tcp_conn->tc_flags &= TCF_INUSE;
 	assert (tcp_check_conn(tcp_conn));
 }
+
+/*
+tso_seg_max
+*/
+
+static u16_t tso_seg_max(tcp_conn, mss)
+tcp_conn_t *tcp_conn;
+u16_t mss;
+{
+	tcp_port_t *tcp_port;
+	ipaddr_t remaddr;
+
+	tcp_port= tcp_conn->tc_port;
+	remaddr= tcp_conn->tc_remaddr;
+
+	/* The device cuts large packets into segments of the port MTU. Looped
+	 * back packets are never cut.
+	 */
+	if (!tcp_port->tp_tso || tcp_conn->tc_mtu != tcp_port->tp_mtu)
+		return mss;
+	if (remaddr == tcp_port->tp_ipaddr ||
+		(ntohl(remaddr) & 0xff000000) == 0x7f000000)
+	{
+		return mss;
+	}
+	return (tcp_port->tp_tso-IP_TCP_MIN_HDR_SIZE)/mss*mss;
+}
@@ -211,6 +211,11 @@ void main(void)
 			clck_expire_timers();
 			continue;
 		}
+		if (!eth_recv_more() && tcp_gro_flush())
+		{
+			/* Deliver coalesced segments before we block */
+			continue;
+		}
 		mq= mq_get();
 		if (!mq)
 			ip_panic(("out of messages"));
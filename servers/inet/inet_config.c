@@ -45,6 +45,8 @@ int tcp_conf_nr;
 int udp_conf_nr;
 
 int ip_forward_directed_bcast= 0;	/* Default is off */
+int oroute_conf_nr= 0;			/* Default table size */
+int arp_conf_nr= 0;			/* Default cache limit */
 
 static u8_t iftype[IP_PORT_MAX];	/* Interface in use as? */
 static int ifdefault= -1;		/* Default network interface. */
@@ -238,6 +240,22 @@ void read_conf(void)
 	icp= ip_conf;
 
 	while (token(0), word[0] != 0) {
+		if (strcmp(word, "routes") == 0) {
+			/* Size of the output routing table. */
+			token(1);
+			oroute_conf_nr= number(word, OROUTE_CONF_MAX);
+			token(0);
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
+		if (strcmp(word, "arp") == 0) {
+			/* Maximum size of the ARP cache. */
+			token(1);
+			arp_conf_nr= number(word, ARP_CONF_MAX);
+			token(0);
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
 		if (strncmp(word, "eth", 3) == 0) {
 			ecp->ec_ifno= ifno= number(word+3, IP_PORT_MAX-1);
 			type= NETTYPE_ETH;
@@ -313,6 +331,32 @@ void read_conf(void)
 						exit(1);
 					}
 					token(0);
+				} else
+				if (strcmp(word, "tso") == 0) {
+					if (type != NETTYPE_ETH ||
+						eth_is_vlan(ecp-1)) {
+						printk(
+				"inet: tso needs an ethernet device, not %s%d\n",
+							type == NETTYPE_ETH ?
+							"vlan eth" : "psip",
+							ifno);
+						exit(1);
+					}
+					ecp[-1].ec_flags |= ECF_TSO;
+					token(0);
+				} else
+				if (strcmp(word, "zerocopy") == 0) {
+					if (type != NETTYPE_ETH ||
+						eth_is_vlan(ecp-1)) {
+						printk(
+			"inet: zerocopy needs an ethernet device, not %s%d\n",
+							type == NETTYPE_ETH ?
+							"vlan eth" : "psip",
+							ifno);
+						exit(1);
+					}
+					ecp[-1].ec_flags |= ECF_ZEROCOPY;
+					token(0);
 				} else {
 					printk("inet: Unknown option '%s'\n",
 						word);
@@ -39,9 +39,13 @@ struct eth_conf
 	u8_t ec_port;		/* Task port (!vlan) or Ethernet port (vlan) */
 	u8_t ec_ifno;		/* Interface number of /dev/eth* */
 	u16_t ec_vlan;		/* VLAN number of this net if task == NULL */
+	u8_t ec_flags;		/* ECF_* options */
 };
 #define eth_is_vlan(ecp)	((ecp)->ec_task == NULL)
 
+#define ECF_TSO		0x01	/* Device does TCP segmentation offload */
+#define ECF_ZEROCOPY	0x02	/* Device receives into inet's buffers */
+
 struct psip_conf
 {
 	u8_t pc_ifno;		/* Interface number of /dev/psip* */
@@ -93,5 +97,16 @@ void *alloc(size_t size);
 
 /* Options */
 extern int ip_forward_directed_bcast;
+extern int oroute_conf_nr;	/* Output routes, 0 is the default size */
+
+#define OROUTE_CONF_MAX	262144	/* Upper limit of 'routes' */
+
+extern int arp_conf_nr;		/* ARP cache limit, 0 is the default */
+
+/* An ARP cache entry takes 48 bytes in a mapped chunk and 4 bytes of hash
+ * chain heads in the heap. inet_stackheap has room for the hash chains of
+ * the default 4096 entries only, a larger cache also needs a larger heap.
+ */
+#define ARP_CONF_MAX	262144	/* Upper limit of 'arp' */
 
 #endif /* INET__INET_CONFIG_H */
@@ -18,6 +18,7 @@ Copyright 1995 Philip Homburg
 #include "inet.h"
 #include <servers/ds/ds.h>
 #include <nucleos/safecopies.h>
+#include <nucleos/mman.h>
 #include "proto.h"
 #include "osdep_eth.h"
 #include "generic/type.h"
@@ -31,8 +32,46 @@ Copyright 1995 Philip Homburg
 
 static int recv_debug= 0;
 
+/* Receive buffers of a zero-copy port. The driver receives straight into
+ * them, inet wraps the buffer of each packet in an accessor and hands the
+ * buffer back to the driver when the last accessor is gone. Packets that sit
+ * in socket queues would keep the driver starved, so once inet holds most of
+ * the buffers, packets are copied into the pools and their buffer goes back.
+ */
+#define RXZC_CHUNK	(64*1024)	/* physically contiguous allocation */
+#define RXZC_CHUNK_NR	(RXZC_CHUNK / DL_RXBUF_SIZE)
+#define RXZC_GRANT_NR	((ETH_RXZC_NR + RXZC_CHUNK_NR-1) / RXZC_CHUNK_NR)
+#define RXZC_LOW	32	/* return buffers at once below this level */
+#define RXZC_COPY	(ETH_RXZC_NR/4)	/* copy when fewer are left to drivers */
+#define RXZC_BATCH	32	/* most packets per reply of the driver */
+
+#define RZS_RET		0	/* queued to be handed to the driver */
+#define RZS_DRIVER	1	/* owned by the driver */
+#define RZS_INET	2	/* holds a packet inside inet */
+
+typedef struct rxzc
+{
+	buf_t rz_buf[ETH_RXZC_NR];
+	cp_grant_id_t rz_grant[RXZC_GRANT_NR];	/* one for each chunk */
+	int rz_grant_task;	/* driver the chunks are granted to */
+	u8_t rz_state[ETH_RXZC_NR];
+	rxbuf_s_t rz_ret[ETH_RXZC_NR];	/* buffers to hand to the driver */
+	int rz_ret_nr;
+	int rz_sent_nr;		/* first rz_sent_nr of rz_ret are granted */
+	int rz_req_nr;		/* DL_READV_Z requests not yet acknowledged */
+	int rz_drv_nr;		/* buffers owned by the driver */
+	int rz_inet_nr;		/* buffers holding packets inside inet */
+	cp_grant_id_t rz_ret_grant;
+	rxpkt_s_t rz_pkt[RXZC_BATCH];	/* packets of the last reply */
+	u32_t rz_seq;		/* last batch of packets consumed */
+	cp_grant_id_t rz_pkt_grant;
+	event_t rz_ev;
+} rxzc_t;
+
 static void setup_read(eth_port_t *eth_port);
-static void read_int(eth_port_t *eth_port, int count);
+static void read_int(eth_port_t *eth_port, kipc_msg_t *m);
+static void read_pack(eth_port_t *eth_port, acc_t *pack, int count);
+static u16_t tso_mss(acc_t **packp);
 static void eth_issue_send(eth_port_t *eth_port);
 static void write_int(eth_port_t *eth_port);
 static void eth_recvev(event_t *ev, ev_arg_t ev_arg);
@@ -40,6 +79,17 @@ static void eth_sendev(event_t *ev, ev_arg_t ev_arg);
 static eth_port_t *find_port(kipc_msg_t *m);
 static void eth_restart(eth_port_t *eth_port, int tasknr);
 static void send_getstat(eth_port_t *eth_port);
+static void rxzc_init(eth_port_t *eth_port);
+static void rxzc_reset(rxzc_t *rz);
+static void rxzc_queue(rxzc_t *rz, int id);
+static acc_t *rxzc_pack(eth_port_t *eth_port, rxzc_t *rz, int id,
+	int len);
+static void rxzc_free(acc_t *acc);
+static void rxzc_ret(eth_port_t *eth_port, rxzc_t *rz, int id);
+static void rxzc_freeev(event_t *ev, ev_arg_t ev_arg);
+static void rxzc_check(eth_port_t *eth_port);
+static void rxzc_give(eth_port_t *eth_port);
+static void rxzc_taken(rxzc_t *rz);
 
 void osdep_eth_init()
 {
@@ -55,7 +105,7 @@ void osdep_eth_init()
 		i<eth_conf_nr; i++, ecp++, eth_port++)
 	{
 		/* Set all grants to invalid */
-		for (j= 0; j<IOVEC_NR; j++)
+		for (j= 0; j<WR_IOVEC; j++)
 			eth_port->etp_osdep.etp_wr_iovec[j].iov_grant= -1;
 		eth_port->etp_osdep.etp_wr_vec_grant= -1;
 		for (j= 0; j<RD_IOVEC; j++)
@@ -66,12 +116,13 @@ void osdep_eth_init()
 		eth_port->etp_osdep.etp_flags= OEPF_EMPTY;
 		eth_port->etp_osdep.etp_stat_gid= -1;
 		eth_port->etp_osdep.etp_stat_buf= NULL;
+		eth_port->etp_osdep.etp_rxzc= NULL;
 
 		if (eth_is_vlan(ecp))
 			continue;
 
 		/* Allocate grants */
-		for (j= 0; j<IOVEC_NR; j++)
+		for (j= 0; j<WR_IOVEC; j++)
 		{
 			if (cpf_getgrants(&gid, 1) != 1)
 			{
@@ -106,6 +157,9 @@ void osdep_eth_init()
 		}
 		eth_port->etp_osdep.etp_rd_vec_grant= gid;
 
+		if (ecp->ec_flags & ECF_ZEROCOPY)
+			rxzc_init(eth_port);
+
 		r= ds_retrieve_u32(ecp->ec_task, &tasknr);
 		if (r != 0 && r != -ESRCH)
 		{
@@ -160,6 +214,8 @@ void osdep_eth_init()
 			eth_write, eth_ioctl, eth_cancel, eth_select);
 
 		eth_port->etp_flags |= EPF_ENABLED;
+		if (ecp->ec_flags & ECF_TSO)
+			eth_port->etp_flags |= EPF_TSO;
 		eth_port->etp_vlan= 0;
 		eth_port->etp_vlan_port= NULL;
 		eth_port->etp_wr_pack= 0;
@@ -243,6 +299,19 @@ acc_t *pack;
 	assert(!eth_port->etp_vlan);
 
 	assert(eth_port->etp_wr_pack == NULL);
+
+	eth_port->etp_osdep.etp_wr_mss= 0;
+	if (bf_bufsize(pack) > ETH_MAX_PACK_SIZE)
+	{
+		eth_port->etp_osdep.etp_wr_mss= tso_mss(&pack);
+		if (eth_port->etp_osdep.etp_wr_mss == 0)
+		{
+			/* The device can only segment TCP */
+			DBLOCK(1, printk("eth_write_port: large non-TCP frame\n"));
+			bf_afree(pack);
+			return;
+		}
+	}
 	eth_port->etp_wr_pack= pack;
 
 	if (eth_port->etp_osdep.etp_state != OEPS_IDLE)
@@ -318,10 +387,15 @@ kipc_msg_t *m;
 		{
 			stat= m->DL_STAT & 0xffff;
 
+			if ((stat & DL_RXBUF_TAKEN) &&
+				loc_port->etp_osdep.etp_rxzc)
+			{
+				rxzc_taken(loc_port->etp_osdep.etp_rxzc);
+			}
 			if (stat & DL_PACK_SEND)
 				write_int(loc_port);
 			if (stat & DL_PACK_RECV)
-				read_int(loc_port, m->DL_COUNT);
+				read_int(loc_port, m);
 			return;
 		}
 
@@ -472,6 +546,8 @@ kipc_msg_t *m;
 	if (!(stat & (DL_PACK_SEND|DL_PACK_RECV)))
 		printk("eth_rec: neither DL_PACK_SEND nor DL_PACK_RECV\n");
 #endif
+	if ((stat & DL_RXBUF_TAKEN) && loc_port->etp_osdep.etp_rxzc)
+		rxzc_taken(loc_port->etp_osdep.etp_rxzc);
 	if (stat & DL_PACK_SEND)
 		write_int(loc_port);
 	if (stat & DL_PACK_RECV)
@@ -481,7 +557,7 @@ kipc_msg_t *m;
 			printk("eth_rec: eth%d got DL_PACK_RECV\n",
 				m->DL_PORT);
 		}
-		read_int(loc_port, m->DL_COUNT);
+		read_int(loc_port, m);
 	}
 
 	if (loc_port->etp_osdep.etp_state == OEPS_IDLE &&
@@ -507,6 +583,8 @@ kipc_msg_t *m;
 	{
 		send_getstat(loc_port);
 	}
+	if (loc_port->etp_osdep.etp_rxzc)
+		rxzc_check(loc_port);
 }
 
 void eth_check_drivers(m)
@@ -534,6 +612,25 @@ kipc_msg_t *m;
 	}
 }
 
+int eth_recv_more()
+{
+	int i;
+	eth_port_t *eth_port;
+
+	/* Only trust the hint while a read request is outstanding, the
+	 * driver then replies as soon as it processes the request.
+	 */
+	for (i= 0, eth_port= eth_port_table; i<eth_conf_nr; i++, eth_port++)
+	{
+		if ((eth_port->etp_osdep.etp_flags & OEPF_RECV_MORE) &&
+			eth_port->etp_osdep.etp_state == OEPS_RECV_SENT)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
 int eth_get_stat(eth_port, eth_stat)
 eth_port_t *eth_port;
 eth_stat_t *eth_stat;
@@ -632,15 +729,17 @@ u32_t flags;
 static void eth_issue_send(eth_port)
 eth_port_t *eth_port;
 {
-	int i, r, pack_size;
+	int i, r, pack_size, iov_nr;
 	acc_t *pack, *pack_ptr;
 	iovec_s_t *iovec;
 	kipc_msg_t m;
 
+	/* Only a TSO capable driver accepts the long vectors of large frames */
+	iov_nr= (eth_port->etp_flags & EPF_TSO) ? WR_IOVEC : IOVEC_NR;
 	iovec= eth_port->etp_osdep.etp_wr_iovec;
 	pack= eth_port->etp_wr_pack;
 	pack_size= 0;
-	for (i=0, pack_ptr= pack; i<IOVEC_NR && pack_ptr; i++,
+	for (i=0, pack_ptr= pack; i<iov_nr && pack_ptr; i++,
 		pack_ptr= pack_ptr->acc_next)
 	{
 		r= cpf_setgrant_direct(iovec[i].iov_grant,
@@ -656,12 +755,12 @@ eth_port_t *eth_port;
 		}
 		pack_size += iovec[i].iov_size= pack_ptr->acc_length;
 	}
-	if (i>= IOVEC_NR)
+	if (i>= iov_nr)
 		{
 		pack= bf_pack(pack);		/* packet is too fragmented */
 		eth_port->etp_wr_pack= pack;
 		pack_size= 0;
-		for (i=0, pack_ptr= pack; i<IOVEC_NR && pack_ptr;
+		for (i=0, pack_ptr= pack; i<iov_nr && pack_ptr;
 			i++, pack_ptr= pack_ptr->acc_next)
 			{
 			r= cpf_setgrant_direct(iovec[i].iov_grant,
@@ -678,7 +777,7 @@ eth_port_t *eth_port;
 			pack_size += iovec[i].iov_size= pack_ptr->acc_length;
 		}
 	}
-	assert (i< IOVEC_NR);
+	assert (i< iov_nr);
 	assert (pack_size >= ETH_MIN_PACK_SIZE);
 
 	r= cpf_setgrant_direct(eth_port->etp_osdep.etp_wr_vec_grant,
@@ -694,6 +793,7 @@ eth_port_t *eth_port;
 		}
 	m.DL_COUNT= i;
 	m.DL_GRANT= eth_port->etp_osdep.etp_wr_vec_grant;
+	m.DL_MSS= eth_port->etp_osdep.etp_wr_mss;
 	m.m_type= DL_WRITEV_S;
 
 	m.DL_PORT= eth_port->etp_osdep.etp_port;
@@ -746,16 +846,73 @@ eth_port_t *eth_port;
 	eth_restart_write(eth_port);
 }
 
-static void read_int(eth_port, count)
+static void read_int(eth_port, m)
 eth_port_t *eth_port;
-int count;
+kipc_msg_t *m;
 {
-	acc_t *pack, *cut_pack;
+	rxzc_t *rz;
+	acc_t *pack;
+	int i, n;
 
-	pack= eth_port->etp_rd_pack;
-	eth_port->etp_rd_pack= NULL;
+	/* Upper layers may hold back work while the driver has more packets
+	 * ready for us.
+	 */
+	if (m->DL_STAT & DL_RECV_MORE)
+		eth_port->etp_osdep.etp_flags |= OEPF_RECV_MORE;
+	else
+		eth_port->etp_osdep.etp_flags &= ~OEPF_RECV_MORE;
 
-	if (count < ETH_MIN_PACK_SIZE)
+	rz= eth_port->etp_osdep.etp_rxzc;
+	if (rz)
+	{
+		/* A batch of packets, each in its own buffer. The driver
+		 * leaves the table alone until a request tells it that we
+		 * are done with this batch.
+		 */
+		n= m->DL_COUNT;
+		if (m->DL_RXSEQ != (int)(rz->rz_seq+1) || n < 0 ||
+			n > RXZC_BATCH)
+		{
+			printk(
+			"mnx_eth`read_int: bad batch %d of %d packets\n",
+				m->DL_RXSEQ, n);
+		}
+		else
+		{
+			for (i= 0; i<n; i++)
+			{
+				pack= rxzc_pack(eth_port, rz,
+					rz->rz_pkt[i].rxp_id,
+					rz->rz_pkt[i].rxp_len);
+				read_pack(eth_port, pack,
+					rz->rz_pkt[i].rxp_len);
+			}
+			rz->rz_seq++;
+		}
+	}
+	else
+	{
+		pack= eth_port->etp_rd_pack;
+		eth_port->etp_rd_pack= NULL;
+		read_pack(eth_port, pack, m->DL_COUNT);
+	}
+	
+	eth_port->etp_flags &= ~(EPF_READ_IP|EPF_READ_SP);
+	setup_read(eth_port);
+}
+
+static void read_pack(eth_port, pack, count)
+eth_port_t *eth_port;
+acc_t *pack;
+int count;
+{
+	acc_t *cut_pack;
+
+	if (pack == NULL)
+	{
+		/* Bad buffer from the driver, already reported */
+	}
+	else if (count < ETH_MIN_PACK_SIZE)
 	{
 		printk("mnx_eth`read_int: packet size too small (%d)\n",
 			count);
@@ -778,9 +935,6 @@ int count;
 	assert(no_ethWritePort);
 	no_ethWritePort= 0;
 	}
-	
-	eth_port->etp_flags &= ~(EPF_READ_IP|EPF_READ_SP);
-	setup_read(eth_port);
 }
 
 static void setup_read(eth_port)
@@ -803,6 +957,17 @@ eth_port_t *eth_port;
 		return;
 	}
 
+	if (eth_port->etp_osdep.etp_rxzc)
+	{
+		/* The driver receives into our buffers, just hand it the
+		 * ones that came back.
+		 */
+		rxzc_give(eth_port);
+		eth_port->etp_flags |= EPF_READ_IP;
+		eth_port->etp_flags |= EPF_READ_SP;
+		return;
+	}
+
 		assert (!eth_port->etp_rd_pack);
 
 		iovec= eth_port->etp_osdep.etp_rd_iovec;
@@ -883,7 +1048,7 @@ ev_arg_t ev_arg;
 		printk("eth_recvev: eth%d got DL_PACK_RECV\n", m_ptr->DL_PORT);
 	}
 
-	read_int(eth_port, m_ptr->DL_COUNT);
+	read_int(eth_port, m_ptr);
 }
 
 static void eth_sendev(ev, ev_arg)
@@ -1024,6 +1189,12 @@ int tasknr;
 		eth_port->etp_rd_pack= NULL;
 		eth_port->etp_flags &= ~(EPF_READ_IP|EPF_READ_SP);
 	}
+	if (eth_port->etp_osdep.etp_rxzc)
+	{
+		/* The buffers of the old driver are lost with it */
+		rxzc_reset(eth_port->etp_osdep.etp_rxzc);
+		eth_port->etp_flags &= ~(EPF_READ_IP|EPF_READ_SP);
+	}
 
 }
 
@@ -1046,3 +1217,355 @@ eth_port_t *eth_port;
 	if (r != 0)
 		ip_panic(( "eth_get_stat: asynsend failed: %d", r));
 	}
+
+static u16_t tso_mss(packp)
+acc_t **packp;
+{
+	acc_t *pack;
+	eth_hdr_t *eth_hdr;
+	ip_hdr_t *ip_hdr;
+	tcp_hdr_t *tcp_hdr;
+	size_t ip_hdr_len, tcp_hdr_len;
+
+	/* The device cuts a large TCP frame into segments that fit in a
+	 * normal frame, each one with a copy of the headers.
+	 */
+	pack= bf_packIffLess(*packp, ETH_HDR_SIZE+IP_MIN_HDR_SIZE);
+	*packp= pack;
+	eth_hdr= (eth_hdr_t *)ptr2acc_data(pack);
+	ip_hdr= (ip_hdr_t *)(eth_hdr+1);
+	if (eth_hdr->eh_proto != htons(ETH_IP_PROTO) ||
+		ip_hdr->ih_proto != IPPROTO_TCP)
+	{
+		return 0;
+	}
+	ip_hdr_len= (ip_hdr->ih_vers_ihl & IH_IHL_MASK) << 2;
+
+	pack= bf_packIffLess(pack, ETH_HDR_SIZE+ip_hdr_len+TCP_MIN_HDR_SIZE);
+	*packp= pack;
+	tcp_hdr= (tcp_hdr_t *)((u8_t *)ptr2acc_data(pack) +
+		ETH_HDR_SIZE+ip_hdr_len);
+	tcp_hdr_len= (tcp_hdr->th_data_off & TH_DO_MASK) >> 2;
+
+	return ETH_MAX_PACK_SIZE-ETH_HDR_SIZE-ip_hdr_len-tcp_hdr_len;
+}
+
+static void rxzc_init(eth_port)
+eth_port_t *eth_port;
+{
+	rxzc_t *rz;
+	char *chunk;
+	cp_grant_id_t gid;
+	int i, j, r;
+
+	/* The bookkeeping is too large for the small inet heap. */
+	rz= mmap(0, sizeof(*rz), PROT_READ|PROT_WRITE,
+		MAP_PREALLOC|MAP_ANONYMOUS, -1, 0);
+	if (rz == MAP_FAILED)
+	{
+		printk("eth%d: no memory for zero-copy receive: %d\n",
+			eth_port-eth_port_table, errno);
+		return;
+	}
+
+	/* VM only lets a process map memory into its own address space, so
+	 * the buffers are ours. Each chunk is granted to the driver, which
+	 * asks the kernel for the physical address of a buffer in it.
+	 */
+	chunk= NULL;
+	for (i= 0; i<ETH_RXZC_NR; i++)
+	{
+		if (i % RXZC_CHUNK_NR == 0)
+		{
+			chunk= mmap(0, RXZC_CHUNK, PROT_READ|PROT_WRITE,
+				MAP_PREALLOC|MAP_CONTIG|MAP_ANONYMOUS, -1, 0);
+			if (chunk == MAP_FAILED)
+			{
+				r= errno;
+				break;
+			}
+		}
+		j= i % RXZC_CHUNK_NR;
+
+		rz->rz_buf[i].buf_linkC= 0;
+		rz->rz_buf[i].buf_free= rxzc_free;
+		rz->rz_buf[i].buf_size= DL_RXBUF_SIZE;
+		rz->rz_buf[i].buf_data_p= chunk + j*DL_RXBUF_SIZE;
+		rz->rz_state[i]= RZS_RET;
+	}
+	if (i < ETH_RXZC_NR)
+	{
+		printk("eth%d: unable to allocate receive buffers: %d\n",
+			eth_port-eth_port_table, r);
+		for (j= 0; j<i; j += RXZC_CHUNK_NR)
+			munmap(rz->rz_buf[j].buf_data_p, RXZC_CHUNK);
+		munmap(rz, sizeof(*rz));
+		return;
+	}
+
+	if (cpf_getgrants(rz->rz_grant, RXZC_GRANT_NR) != RXZC_GRANT_NR)
+	{
+		ip_panic(( "rxzc_init: cpf_getgrants failed: %d\n", errno));
+	}
+	rz->rz_grant_task= ENDPT_NONE;
+	if (cpf_getgrants(&gid, 1) != 1)
+	{
+		ip_panic(( "rxzc_init: cpf_getgrants failed: %d\n", errno));
+	}
+	rz->rz_ret_grant= gid;
+	if (cpf_getgrants(&gid, 1) != 1)
+	{
+		ip_panic(( "rxzc_init: cpf_getgrants failed: %d\n", errno));
+	}
+	rz->rz_pkt_grant= gid;
+	rz->rz_inet_nr= 0;
+	ev_init(&rz->rz_ev);
+
+	rxzc_reset(rz);
+	eth_port->etp_osdep.etp_rxzc= rz;
+}
+
+static void rxzc_reset(rz)
+rxzc_t *rz;
+{
+	int i;
+
+	/* All buffers that are not in use by inet go to the driver */
+	rz->rz_ret_nr= 0;
+	for (i= 0; i<ETH_RXZC_NR; i++)
+	{
+		if (rz->rz_state[i] == RZS_INET)
+			continue;
+		rz->rz_state[i]= RZS_RET;
+		rxzc_queue(rz, i);
+	}
+	rz->rz_sent_nr= 0;
+	rz->rz_req_nr= 0;
+	rz->rz_drv_nr= 0;
+	rz->rz_seq= 0;
+}
+
+static void rxzc_queue(rz, id)
+rxzc_t *rz;
+int id;
+{
+	rxbuf_s_t *rxb;
+
+	rxb= &rz->rz_ret[rz->rz_ret_nr++];
+	rxb->rxb_id= id;
+	rxb->rxb_grant= rz->rz_grant[id / RXZC_CHUNK_NR];
+	rxb->rxb_offset= (id % RXZC_CHUNK_NR) * DL_RXBUF_SIZE;
+}
+
+static acc_t *rxzc_pack(eth_port, rz, id, len)
+eth_port_t *eth_port;
+rxzc_t *rz;
+int id;
+int len;
+{
+	acc_t *pack, *acc;
+	char *data;
+
+	if (id < 0 || id >= ETH_RXZC_NR || rz->rz_state[id] != RZS_DRIVER)
+	{
+		printk("mnx_eth`rxzc_pack: bad receive buffer %d\n", id);
+		return NULL;
+	}
+	rz->rz_state[id]= RZS_INET;
+	rz->rz_drv_nr--;
+	rz->rz_inet_nr++;
+
+	/* Bad sizes are dropped by read_pack */
+	if (ETH_RXZC_NR - rz->rz_inet_nr >= RXZC_COPY ||
+		len < ETH_MIN_PACK_SIZE || len > ETH_MAX_PACK_SIZE_TAGGED)
+	{
+		return bf_extreq(&rz->rz_buf[id], DL_RXBUF_SIZE);
+	}
+
+	pack= bf_memreq(len);
+	data= rz->rz_buf[id].buf_data_p;
+	for (acc= pack; acc; acc= acc->acc_next)
+	{
+		memcpy(ptr2acc_data(acc), data, acc->acc_length);
+		data += acc->acc_length;
+	}
+	rxzc_ret(eth_port, rz, id);
+
+	return pack;
+}
+
+static void rxzc_free(acc)
+acc_t *acc;
+{
+	eth_port_t *eth_port;
+	rxzc_t *rz;
+	buf_t *buf;
+	int i;
+
+	buf= acc->acc_buffer;
+	for (i= 0, eth_port= eth_port_table; i<eth_conf_nr; i++, eth_port++)
+	{
+		rz= eth_port->etp_osdep.etp_rxzc;
+		if (rz && buf >= rz->rz_buf && buf < &rz->rz_buf[ETH_RXZC_NR])
+			break;
+	}
+	assert(i < eth_conf_nr);
+	bf_extdone(acc);
+
+	rxzc_ret(eth_port, rz, buf - rz->rz_buf);
+}
+
+static void rxzc_ret(eth_port, rz, id)
+eth_port_t *eth_port;
+rxzc_t *rz;
+int id;
+{
+	ev_arg_t ev_arg;
+
+	assert(rz->rz_state[id] == RZS_INET);
+	rz->rz_state[id]= RZS_RET;
+	rz->rz_inet_nr--;
+	rxzc_queue(rz, id);
+
+	/* We may be deep inside some protocol, talk to the driver later */
+	if (rz->rz_drv_nr < RXZC_LOW && !ev_in_queue(&rz->rz_ev))
+	{
+		ev_arg.ev_ptr= eth_port;
+		ev_enqueue(&rz->rz_ev, rxzc_freeev, ev_arg);
+	}
+}
+
+static void rxzc_freeev(ev, ev_arg)
+event_t *ev;
+ev_arg_t ev_arg;
+{
+	rxzc_check(ev_arg.ev_ptr);
+}
+
+static void rxzc_check(eth_port)
+eth_port_t *eth_port;
+{
+	rxzc_t *rz;
+
+	/* The buffers are normally returned with the next read request.
+	 * When the driver runs low, it may not have a packet to reply with
+	 * so hand them over now. If the port is busy, the reply that makes
+	 * it idle gets us here again.
+	 */
+	rz= eth_port->etp_osdep.etp_rxzc;
+	if (eth_port->etp_osdep.etp_state != OEPS_IDLE ||
+		rz->rz_req_nr != 0 || rz->rz_ret_nr == 0 ||
+		rz->rz_drv_nr >= RXZC_LOW)
+	{
+		return;
+	}
+	rxzc_give(eth_port);
+}
+
+static void rxzc_give(eth_port)
+eth_port_t *eth_port;
+{
+	rxzc_t *rz;
+	kipc_msg_t mess;
+	int i, n, r;
+
+	rz= eth_port->etp_osdep.etp_rxzc;
+
+	/* A restarted driver has a new endpoint */
+	if (rz->rz_grant_task != eth_port->etp_osdep.etp_task)
+	{
+		for (i= 0; i<RXZC_GRANT_NR; i++)
+		{
+			r= cpf_setgrant_direct(rz->rz_grant[i],
+				eth_port->etp_osdep.etp_task,
+				(vir_bytes)rz->rz_buf[i*RXZC_CHUNK_NR].buf_data_p,
+				RXZC_CHUNK, CPF_WRITE);
+			if (r != 0)
+			{
+				ip_panic((
+			"mnx_eth`rxzc_give: cpf_setgrant_direct failed: %d\n",
+					errno));
+			}
+		}
+		rz->rz_grant_task= eth_port->etp_osdep.etp_task;
+	}
+
+	/* The driver acknowledges each request with DL_RXBUF_TAKEN once it
+	 * has copied the table. Only the oldest outstanding request carries
+	 * buffers, so the acknowledgements can't get mixed up.
+	 */
+	n= rz->rz_req_nr == 0 ? rz->rz_ret_nr : 0;
+	if (n)
+	{
+		r= cpf_setgrant_direct(rz->rz_ret_grant,
+			eth_port->etp_osdep.etp_task,
+			(vir_bytes)rz->rz_ret,
+			(vir_bytes)(n * sizeof(rz->rz_ret[0])),
+			CPF_READ);
+		if (r != 0)
+		{
+			ip_panic((
+		"mnx_eth`rxzc_give: cpf_setgrant_direct failed: %d\n",
+				errno));
+		}
+	}
+
+	r= cpf_setgrant_direct(rz->rz_pkt_grant,
+		eth_port->etp_osdep.etp_task,
+		(vir_bytes)rz->rz_pkt,
+		(vir_bytes)sizeof(rz->rz_pkt),
+		CPF_WRITE);
+	if (r != 0)
+	{
+		ip_panic((
+	"mnx_eth`rxzc_give: cpf_setgrant_direct failed: %d\n",
+			errno));
+	}
+
+	mess.m_type= DL_READV_Z;
+	mess.DL_PORT= eth_port->etp_osdep.etp_port;
+	mess.DL_PROC= this_proc;
+	mess.DL_COUNT= n;
+	mess.DL_GRANT= rz->rz_ret_grant;
+	mess.DL_RXGRANT= rz->rz_pkt_grant;
+	mess.DL_RXMAX= RXZC_BATCH;
+	mess.DL_RXSEQ= rz->rz_seq;
+
+	assert(eth_port->etp_osdep.etp_state == OEPS_IDLE);
+
+	r= asynsend(eth_port->etp_osdep.etp_task, &mess);
+	eth_port->etp_osdep.etp_state= OEPS_RECV_SENT;
+
+	if (r < 0)
+	{
+		printk("mnx_eth`rxzc_give: asynsend to %d failed: %d\n",
+			eth_port->etp_osdep.etp_task, r);
+		return;
+	}
+	rz->rz_sent_nr= n;
+	rz->rz_req_nr++;
+}
+
+static void rxzc_taken(rz)
+rxzc_t *rz;
+{
+	int i;
+
+	if (rz->rz_req_nr == 0)
+	{
+		printk("mnx_eth`rxzc_taken: no request outstanding\n");
+		return;
+	}
+	rz->rz_req_nr--;
+
+	for (i= 0; i<rz->rz_sent_nr; i++)
+	{
+		assert(rz->rz_state[rz->rz_ret[i].rxb_id] == RZS_RET);
+		rz->rz_state[rz->rz_ret[i].rxb_id]= RZS_DRIVER;
+	}
+	rz->rz_drv_nr += rz->rz_sent_nr;
+	rz->rz_ret_nr -= rz->rz_sent_nr;
+	memmove(rz->rz_ret, rz->rz_ret+rz->rz_sent_nr,
+		rz->rz_ret_nr * sizeof(rz->rz_ret[0]));
+	rz->rz_sent_nr= 0;
+}
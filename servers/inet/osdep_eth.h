@@ -22,6 +22,10 @@ Copyright 1995 Philip Homburg
 
 #define IOVEC_NR	16
 #define RD_IOVEC	((ETH_MAX_PACK_SIZE + BUF_S -1)/BUF_S)
+#define WR_IOVEC	((ETH_TSO_MAX_SIZE + BUF_S -1)/BUF_S + 1)
+#define ETH_RXZC_NR	512	/* receive buffers of a zero-copy port */
+
+struct rxzc;
 
 typedef struct osdep_eth_port
 {
@@ -31,8 +35,9 @@ typedef struct osdep_eth_port
 	int etp_port;
 	int etp_recvconf;
 	int etp_send_ev;
-	iovec_s_t etp_wr_iovec[IOVEC_NR];
+	iovec_s_t etp_wr_iovec[WR_IOVEC];
 	cp_grant_id_t etp_wr_vec_grant;
+	u16_t etp_wr_mss;
 	iovec_s_t etp_rd_iovec[RD_IOVEC];
 	cp_grant_id_t etp_rd_vec_grant;
 	event_t etp_recvev;
@@ -40,6 +45,7 @@ typedef struct osdep_eth_port
 	kipc_msg_t etp_recvrepl;
 	cp_grant_id_t etp_stat_gid;
 	eth_stat_t *etp_stat_buf;
+	struct rxzc *etp_rxzc;		/* receive buffers lent to the driver */
 } osdep_eth_port_t;
 
 #define OEPS_INIT		0	/* Not initialized */
@@ -62,5 +68,6 @@ typedef struct osdep_eth_port
 #define OEPF_NEED_STAT	8	/* Issue getstat request when the state becomes
 				 * idle
 				 */
+#define OEPF_RECV_MORE	16	/* Driver has more received packets ready */
 
 #endif /* INET__OSDEP_ETH_H */
@@ -23,6 +23,7 @@ void clck_tick(kipc_msg_t *mess);
 
 void eth_rec(kipc_msg_t *m);
 void eth_check_drivers(kipc_msg_t *m);
+int eth_recv_more(void);
 
 /* sr.c */
 
@@ -27,6 +27,8 @@ Created:	June 1995 by Philip Homburg <philip@f-mnx.phicoh.com>
 #include "generic/type.h"
 #include "generic/sr.h"
 
+#include "generic/arp.h"
+
 #include "generic/tcp_int.h"
 #include "generic/udp_int.h"
 #include "mq.h"
@@ -60,6 +62,7 @@ static struct export_param_list inet_ex_list[]=
 	QP_VARIABLE(tcp_cancel_f),
 	QP_VECTOR(udp_port_table, udp_port_table, ip_conf_nr),
 	QP_VARIABLE(udp_fd_table),
+	QP_VECTOR(arp_stat, arp_stat, eth_conf_nr),
 	QP_END()
 };
 
@@ -7,44 +7,65 @@
 struct waiting {
 	endpoint_t who;			/* who is waiting */
 	int val;			/* value he/she is waiting for */
+	struct waiting *next;		/* next one in FIFO order */
+};
+
+struct wait_queue {
+	struct waiting *head;
+	struct waiting *tail;
 };
 
 struct semaphore {
 	unsigned short semval;		/* semaphore value */
 	unsigned short semzcnt;		/* # waiting for zero */
 	unsigned short semncnt;		/* # waiting for increase */
-	struct waiting *zlist;		/* process waiting for zero */
-	struct waiting *nlist;		/* process waiting for increase */
+	struct wait_queue zq;		/* processes waiting for zero */
+	struct wait_queue nq;		/* processes waiting for increase */
 	pid_t sempid;			/* process that did last op */
 };
 
 struct sem_struct {
 	key_t key;
 	int id;
+	int used;			/* slot holds a semaphore set */
+	struct sem_struct *id_next;	/* next set in the id hash chain */
+	struct sem_struct *key_next;	/* next set in the key hash chain */
 	struct semid_ds semid_ds;
 	struct semaphore sems[SEMMSL];
 };
 
+/* The sets keep their slot for their lifetime, and are found through the
+ * hash chains by id and by key.
+ */
+#define SEM_HASH	64		/* power of two */
+#define sem_id_hash(id)		((unsigned) (id) & (SEM_HASH - 1))
+#define sem_key_hash(key)	\
+	(((unsigned) (key) ^ ((unsigned) (key) >> 16)) & (SEM_HASH - 1))
+
 static struct sem_struct sem_list[SEMMNI];
 static int sem_list_nr = 0;
+static struct sem_struct *sem_id_table[SEM_HASH];
+static struct sem_struct *sem_key_table[SEM_HASH];
 
 static struct sem_struct *sem_find_key(key_t key)
 {
-	int i;
+	struct sem_struct *sem;
+
 	if (key == IPC_PRIVATE)
 		return NULL;
-	for (i = 0; i < sem_list_nr; i++)
-		if (sem_list[i].key == key)
-			return sem_list+i;
+	for (sem = sem_key_table[sem_key_hash(key)]; sem; sem = sem->key_next)
+		if (sem->key == key)
+			return sem;
 	return NULL;
 }
 
 static struct sem_struct *sem_find_id(int id)
 {
-	int i;
-	for (i = 0; i < sem_list_nr; i++)
-		if (sem_list[i].id == id)
-			return sem_list+i;
+	struct sem_struct *sem;
+
+	for (sem = sem_id_table[sem_id_hash(id)]; sem; sem = sem->id_next)
+		if (sem->id == id)
+			return sem;
 	return NULL;
 }
 
@@ -54,7 +75,7 @@ static struct sem_struct *sem_find_id(int id)
 int do_semget(kipc_msg_t *m)
 {
 	key_t key;
-	int nsems, flag, id;
+	int nsems, flag, id, i;
 	struct sem_struct *sem;
 
 	key = m->SEMGET_KEY;
@@ -78,7 +99,9 @@ int do_semget(kipc_msg_t *m)
 			return -ENOSPC;
 
 		/* create a new semaphore set */
-		sem = &sem_list[sem_list_nr];
+		for (i = 0; sem_list[i].used; i++)
+			;
+		sem = &sem_list[i];
 		memset(sem, 0, sizeof(struct sem_struct));
 		sem->semid_ds.sem_perm.cuid =
 			sem->semid_ds.sem_perm.uid = getnuid(who_e);
@@ -90,6 +113,14 @@ int do_semget(kipc_msg_t *m)
 		sem->semid_ds.sem_ctime = time(NULL);
 		sem->id = id = identifier++;
 		sem->key = key;
+		sem->used = 1;
+
+		sem->id_next = sem_id_table[sem_id_hash(id)];
+		sem_id_table[sem_id_hash(id)] = sem;
+		if (key != IPC_PRIVATE) {
+			sem->key_next = sem_key_table[sem_key_hash(key)];
+			sem_key_table[sem_key_hash(key)] = sem;
+		}
 
 		sem_list_nr++;
 	}
@@ -109,35 +140,94 @@ static void send_message_to_process(endpoint_t who, int ret, int ignore)
 		printk("IPC send error!\n");
 }
 
+static int wq_append(struct wait_queue *q, endpoint_t who, int val)
+{
+	struct waiting *w;
+
+	if (!(w = malloc(sizeof(struct waiting))))
+		return -ENOMEM;
+
+	w->who = who;
+	w->val = val;
+	w->next = NULL;
+
+	if (q->tail)
+		q->tail->next = w;
+	else
+		q->head = w;
+	q->tail = w;
+
+	return 0;
+}
+
+/* Unlink and free 'w', which follows 'prev' (NULL for the head). */
+static void wq_remove(struct wait_queue *q, struct waiting *prev,
+	struct waiting *w)
+{
+	if (prev)
+		prev->next = w->next;
+	else
+		q->head = w->next;
+
+	if (q->tail == w)
+		q->tail = prev;
+
+	free(w);
+}
+
+/* Remove all waiters of 'q' and send them 'ret'. */
+static void wq_flush(struct wait_queue *q, int ret)
+{
+	struct waiting *w;
+	endpoint_t who;
+
+	while ((w = q->head) != NULL) {
+		who = w->who;
+		wq_remove(q, NULL, w);
+		send_message_to_process(who, ret, 0);
+	}
+}
+
 static void remove_semaphore(struct sem_struct *sem)
 {
+	struct sem_struct **sp;
 	int i, nr;
 
 	nr = sem->semid_ds.sem_nsems;
 
+	/* awaken all processes blocked on the set */
 	for (i = 0; i < nr; i++) {
-		if (sem->sems[i].zlist)
-			free(sem->sems[i].zlist);
-		if (sem->sems[i].nlist)
-			free(sem->sems[i].nlist);
+		wq_flush(&sem->sems[i].zq, -EIDRM);
+		wq_flush(&sem->sems[i].nq, -EIDRM);
 	}
 
-	for (i = 0; i < sem_list_nr; i++) {
-		if (&sem_list[i] == sem)
-			break;
+	for (sp = &sem_id_table[sem_id_hash(sem->id)]; *sp != sem;
+		sp = &(*sp)->id_next)
+		;
+	*sp = sem->id_next;
+
+	if (sem->key != IPC_PRIVATE) {
+		for (sp = &sem_key_table[sem_key_hash(sem->key)]; *sp != sem;
+			sp = &(*sp)->key_next)
+			;
+		*sp = sem->key_next;
 	}
 
-	if (i < sem_list_nr && --sem_list_nr != i)
-		sem_list[i] = sem_list[sem_list_nr];
+	sem->used = 0;
+	sem_list_nr--;
 }
 
 static void show_semaphore(void)
 {
-	int i, j, k;
+	int i, j;
+	struct waiting *w;
 
-	for (i = 0; i < sem_list_nr; i++) {
+	for (i = 0; i < SEMMNI; i++) {
 		int nr = sem_list[i].semid_ds.sem_nsems;
 
+		if (!sem_list[i].used)
+			continue;
+
 		printk("===== [%d] =====\n", i);
 		for (j = 0; j < nr; j++) {
 			struct semaphore *semaphore = &sem_list[i].sems[j];
@@ -148,15 +238,14 @@ static void show_semaphore(void)
 			printk("  (%d): ", semaphore->semval);
 			if (semaphore->semzcnt) {
 				printk("zero(");
-				for (k = 0; k < semaphore->semzcnt; k++)
-					printk("%d,", semaphore->zlist[k].who);
+				for (w = semaphore->zq.head; w; w = w->next)
+					printk("%d,", w->who);
 				printk(")    ");
 			}
 			if (semaphore->semncnt) {
 				printk("incr(");
-				for (k = 0; k < semaphore->semncnt; k++)
-					printk("%d-%d,",
-						semaphore->nlist[k].who, semaphore->nlist[k].val);
+				for (w = semaphore->nq.head; w; w = w->next)
+					printk("%d-%d,", w->who, w->val);
 				printk(")");
 			}
 			printk("\n");
@@ -165,114 +254,93 @@ static void show_semaphore(void)
 	printk("\n");
 }
 
+/* Remove 'pt' from 'q'. Returns 1 if it was waiting there. */
+static int wq_remove_process(struct wait_queue *q, endpoint_t pt)
+{
+	struct waiting *w, *prev;
+
+	for (prev = NULL, w = q->head; w; prev = w, w = w->next) {
+		if (w->who == pt) {
+			wq_remove(q, prev, w);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 static void remove_process(endpoint_t pt)
 {
 	int i;
 
-	for (i = 0; i < sem_list_nr; i++) {
+	for (i = 0; i < SEMMNI; i++) {
 		struct sem_struct *sem = &sem_list[i];
 		int nr = sem->semid_ds.sem_nsems;
 		int j;
 
+		if (!sem->used)
+			continue;
+
 		for (j = 0; j < nr; j++) {
 			struct semaphore *semaphore = &sem->sems[j];
-			int k;
-
-			for (k = 0; k < semaphore->semzcnt; k++) {
-				endpoint_t who_waiting = semaphore->zlist[k].who;
-
-				if (who_waiting == pt) {
-					/* remove this slot first */
-					memmove(semaphore->zlist+k, semaphore->zlist+k+1,
-						sizeof(struct waiting) * (semaphore->semzcnt-k-1));
-					--semaphore->semzcnt;
-					/* then send message to the process */
-					send_message_to_process(who_waiting, -EINTR, 1);
 
-					break;
-				}
+			if (semaphore->semzcnt &&
+				wq_remove_process(&semaphore->zq, pt)) {
+				--semaphore->semzcnt;
+				send_message_to_process(pt, -EINTR, 1);
 			}
 
-			for (k = 0; k < semaphore->semncnt; k++) {
-				endpoint_t who_waiting = semaphore->nlist[k].who;
-
-				if (who_waiting == pt) {
-					/* remove it first */
-					memmove(semaphore->nlist+k, semaphore->nlist+k+1,
-						sizeof(struct waiting) * (semaphore->semncnt-k-1));
-					--semaphore->semncnt;
-					/* send the message to the process */
-					send_message_to_process(who_waiting, -EINTR, 1);
-
-					break;
-				}
+			if (semaphore->semncnt &&
+				wq_remove_process(&semaphore->nq, pt)) {
+				--semaphore->semncnt;
+				send_message_to_process(pt, -EINTR, 1);
 			}
 		}
 	}
 }
 
-static void update_one_semaphore(struct sem_struct *sem, int is_remove)
+/*===========================================================================*
+ *				wake_waiters		     		     *
+ *===========================================================================*/
+static void wake_waiters(struct semaphore *semaphore)
 {
-	int i, j, nr;
-	struct semaphore *semaphore;
+	/* The value of the semaphore has changed. Wake up everybody who can
+	 * proceed now, in FIFO order: first the processes waiting for an
+	 * increase, as long as the value covers what they take, then, if that
+	 * brought the value to zero, all the processes waiting for zero.
+	 */
+	struct waiting *w, *prev, *next;
 	endpoint_t who;
 
-	nr = sem->semid_ds.sem_nsems;
-
-	if (is_remove) {
-		for (i = 0; i < nr; i++) {
-			semaphore = &sem->sems[i];
-
-			for (j = 0; j < semaphore->semzcnt; j++)
-				send_message_to_process(semaphore->zlist[j].who, -EIDRM, 0);
-			for (j = 0; j < semaphore->semncnt; j++)
-				send_message_to_process(semaphore->nlist[j].who, -EIDRM, 0);
-		}
-
-		remove_semaphore(sem);
-		return;
-	}
-
-	for (i = 0; i < nr; i++) {
-		semaphore = &sem->sems[i];
-
-		if (semaphore->zlist && !semaphore->semval) {
-			/* choose one process, policy: FIFO. */
-			who = semaphore->zlist[0].who;
+	prev = NULL;
+	for (w = semaphore->nq.head; w && semaphore->semval; w = next) {
+		next = w->next;
 
-			memmove(semaphore->zlist, semaphore->zlist+1,
-				sizeof(struct waiting) * (semaphore->semzcnt-1));
-			--semaphore->semzcnt;
-
-			send_message_to_process(who, 0, 0);
+		if (w->val > semaphore->semval) {
+			prev = w;
+			continue;
 		}
 
-		if (semaphore->nlist) {
-			for (j = 0; j < semaphore->semncnt; j++) {
-				if (semaphore->nlist[j].val <= semaphore->semval) {
-					semaphore->semval -= semaphore->nlist[j].val;
-					who = semaphore->nlist[j].who;
-
-					memmove(semaphore->nlist+j, semaphore->nlist+j+1,
-						sizeof(struct waiting) * (semaphore->semncnt-j-1));
-					--semaphore->semncnt;
+		semaphore->semval -= w->val;
+		--semaphore->semncnt;
+		who = w->who;
+		wq_remove(&semaphore->nq, prev, w);
 
-					send_message_to_process(who, 0, 0);
+		send_message_to_process(who, 0, 0);
+	}
 
-					/* choose only one process */
-					break;
-				}
-			}
-		}
+	if (!semaphore->semval) {
+		semaphore->semzcnt = 0;
+		wq_flush(&semaphore->zq, 0);
 	}
 }
 
-static void update_semaphores(void)
+static void wake_set(struct sem_struct *sem, int nr)
 {
 	int i;
 
-	for (i = 0; i < sem_list_nr; i++)
-		update_one_semaphore(sem_list+i, 0 /* not remove */);
+	for (i = 0; i < nr; i++)
+		wake_waiters(&sem->sems[i]);
 }
 
 /*===========================================================================*
@@ -346,7 +414,7 @@ int do_semctl(kipc_msg_t *m)
 		/* awaken all processes block in semop
 		 * and remove the semaphore set.
 		 */
-		update_one_semaphore(sem, 1);
+		remove_semaphore(sem);
 		break;
 	case IPC_INFO:
 		break;
@@ -404,14 +472,14 @@ int do_semctl(kipc_msg_t *m)
 		for (i = 0; i < sem->semid_ds.sem_nsems; i++) {
 			if (buf[i] < 0 || buf[i] > SEMVMX) {
 				free(buf);
-				update_semaphores();
+				wake_set(sem, i);
 				return -ERANGE;
 			}
 			sem->sems[i].semval = buf[i];
 		}
 		free(buf);
 		/* awaken if possible */
-		update_semaphores();
+		wake_set(sem, sem->semid_ds.sem_nsems);
 		break;
 	case SETVAL:
 		val = (int) opt;
@@ -428,7 +496,7 @@ int do_semctl(kipc_msg_t *m)
 #endif
 		sem->semid_ds.sem_ctime = time(NULL);
 		/* awaken if possible */
-		update_semaphores();
+		wake_waiters(&sem->sems[num]);
 		break;
 	default:
 		return -EINVAL;
@@ -446,8 +514,10 @@ int do_semop(kipc_msg_t *m)
 	struct sembuf *sops;
 	unsigned int nsops;
 	struct sem_struct *sem;
-	int no_reply;
+	int no_reply, nr_done;
 
+	nr_done = 0;
+	no_reply = 0;
 	id = m->SEMOP_ID;
 	nsops = (unsigned int) m->SEMOP_SIZE;
 
@@ -515,8 +585,7 @@ int do_semop(kipc_msg_t *m)
 
 	}
 	/* there will be no errors left, so we can go ahead */
-	no_reply = 0;
-	for (i = 0; i < nsops; i++) {
+	for (i = 0; i < nsops; i++, nr_done++) {
 		struct semaphore *s;
 		int op_n;
 
@@ -534,14 +603,11 @@ int do_semop(kipc_msg_t *m)
 		} else if (!op_n) {
 			if (s->semval) {
 				/* put the process asleep */
-				s->semzcnt++;
-				s->zlist = realloc(s->zlist, sizeof(struct waiting) * s->semzcnt);
-				if (!s->zlist) {
+				if (wq_append(&s->zq, who_e, op_n) != 0) {
 					printk("IPC: zero waiting list lost...\n");
 					break;
 				}
-				s->zlist[s->semzcnt-1].who = who_e;
-				s->zlist[s->semzcnt-1].val = op_n;
+				s->semzcnt++;
 
 #ifdef DEBUG_SEM
 				printk("SEMOP: Put into sleep... %d\n", who_e);
@@ -557,14 +623,11 @@ int do_semop(kipc_msg_t *m)
 				s->semval += op_n;
 			else {
 				/* put the process asleep */
-				s->semncnt++;
-				s->nlist = realloc(s->nlist, sizeof(struct waiting) * s->semncnt);
-				if (!s->nlist) {
+				if (wq_append(&s->nq, who_e, -op_n) != 0) {
 					printk("IPC: increase waiting list lost...\n");
 					break;
 				}
-				s->nlist[s->semncnt-1].who = who_e;
-				s->nlist[s->semncnt-1].val = -op_n;
+				s->semncnt++;
 
 				no_reply++;
 			}
@@ -573,6 +636,11 @@ int do_semop(kipc_msg_t *m)
 
 	r = 0;
 out_free:
+	/* awaken processes if possible, only the semaphores changed by
+	 * this operation need to be looked at.
+	 */
+	for (i = 0; i < nr_done; i++)
+		wake_waiters(&sem->sems[sops[i].sem_num]);
 	free(sops);
 out:
 	/* if we reach here by errors
@@ -586,9 +654,6 @@ out:
 			printk("IPC send error!\n");
 	}
 
-	/* awaken process if possible */
-	update_semaphores();
-
 	return 0;
 }
 
@@ -16,6 +16,7 @@
 #include <kernel/const.h>
 #include <kernel/types.h>
 #include <kernel/proc.h>
+#include <nucleos/ipctrace.h>
 #include <asm/irq_vectors.h>
 #include <asm/setup.h>
 
@@ -96,6 +97,121 @@ void timing_dmp()
   }
 }
 
+/*===========================================================================*
+ *				ipcstats_dmp				     *
+ *===========================================================================*/
+void ipcstats_dmp()
+{
+#ifdef CONFIG_DEBUG_KERNEL_IPC_TRACE
+  struct ipct_stats *stats, *st;
+  register struct proc *rp;
+  static struct proc *oldrp = BEG_PROC_ADDR;
+  int r, i;
+
+  stats = malloc(sizeof(struct ipct_stats) * (NR_TASKS + NR_PROCS));
+  if (!stats) {
+      report("IS","Error: no enough memory", -ENOMEM);
+      return;
+  }
+
+  if ((r = sys_getproctab(proc)) != 0 || (r = sys_getipcstats(stats)) != 0) {
+      report("IS","warning: couldn't get copy of IPC statistics", r);
+      free(stats);
+      return;
+  }
+
+  printk("\n-nr-name---- --send- --recv- sendrec -notify- -senda- -deliv- -blocked-\n");
+
+  PROCLOOP(rp, oldrp)
+	st = &stats[proc_nr(rp) + NR_TASKS];
+	printk("%-8.8s %7lu %7lu %7lu %8lu %7lu %7lu %9lu\n", rp->p_name,
+	       st->calls[KIPC_SEND], st->calls[KIPC_RECEIVE],
+	       st->calls[KIPC_SENDREC], st->calls[KIPC_NOTIFY],
+	       st->calls[KIPC_SENDA], st->delivered, st->blocked);
+
+	if (st->delivered) {
+		printk("      to:");
+		for (i = 0; i < IPCT_DST_SLOTS; i++) {
+			if (!st->dst[i].count)
+				continue;
+			printk(" %s/%d:%lu", proc_name(_ENDPOINT_P(st->dst[i].dst)),
+			       st->dst[i].m_type, st->dst[i].count);
+		}
+		if (st->other)
+			printk(" other:%lu", st->other);
+		printk("\n");
+	}
+
+	if (st->blocked) {
+		printk("  queued:");
+		for (i = 0; i < IPCT_HIST_BUCKETS; i++) {
+			if (!st->block_hist[i])
+				continue;
+			printk(" <2^%d:%lu", i + IPCT_HIST_SHIFT + 1,
+			       st->block_hist[i]);
+		}
+		printk("\n");
+	}
+  }
+
+  free(stats);
+#else
+  printk("IS: kernel not compiled with IPC tracing\n");
+#endif
+}
+
+/*===========================================================================*
+ *				ipctrace_dmp				     *
+ *===========================================================================*/
+void ipctrace_dmp()
+{
+#ifdef CONFIG_DEBUG_KERNEL_IPC_TRACE
+  static char *ev_names[] = { "?", "deliver", "block", "deadlock" };
+  struct ipct_trace *trace;
+  int r;
+#if IPCT_RING_SIZE > 0
+  u32_t seq, first;
+  struct ipct_event *ev;
+#endif
+
+  trace = malloc(sizeof(struct ipct_trace));
+  if (!trace) {
+      report("IS","Error: no enough memory", -ENOMEM);
+      return;
+  }
+
+  if ((r = sys_getproctab(proc)) != 0 || (r = sys_getipctrace(trace)) != 0) {
+      report("IS","warning: couldn't get copy of IPC trace", r);
+      free(trace);
+      return;
+  }
+
+  printk("deadlock checks %lu, deadlocks %lu, events %u\n",
+	 trace->deadlock_checks, trace->deadlocks, trace->seq);
+
+#if IPCT_RING_SIZE > 0
+  /* Show the most recent events only, a full ring does not fit. */
+  first = trace->seq > LINES ? trace->seq - LINES + 1 : 1;
+
+  printk("--seq---- --tsc---- -event-- call -src---- -dst---- -m_type-\n");
+  for (seq = first; seq <= trace->seq && seq; seq++) {
+	ev = &trace->ring[seq % IPCT_RING_SIZE];
+	if (ev->seq != seq)
+		continue;
+	printk("%9u %9u %-8s %4d %-8.8s %-8.8s %8d\n", ev->seq, ev->tsc,
+	       ev->event < 4 ? ev_names[ev->event] : "?", ev->call,
+	       proc_name(_ENDPOINT_P(ev->src)),
+	       ev->dst == ENDPT_NONE ? "-" : proc_name(_ENDPOINT_P(ev->dst)),
+	       ev->m_type);
+  }
+#endif
+
+  free(trace);
+#else
+  printk("IS: kernel not compiled with IPC tracing\n");
+#endif
+}
+
 /*===========================================================================*
  *				kmessages_dmp				     *
  *===========================================================================*/
@@ -201,7 +317,7 @@ void irqtab_dmp()
 #endif
 
   printk("IRQ policies dump shows use of kernel's IRQ hooks.\n");
-  printk("-h.id- -proc.nr- -irq nr- -policy- -notify id-\n");
+  printk("-h.id- -proc.nr- -irq nr- -policy- -notify id- -intr- -notify- -coalesce-\n");
   for (i=0; i<NR_IRQ_HOOKS; i++) {
   	e = &irq_hooks[i];
   	printk("%3d", i);
@@ -213,6 +329,9 @@ void irqtab_dmp()
   	printk("    (%02d) ", e->irq); 
   	printk("  %s", (e->policy & IRQ_REENABLE) ? "reenable" : "    -   ");
   	printk("   %d", e->notify_id);
+  	printk(" %8lu %8lu", e->nr_intr, e->nr_notify);
+  	if (e->coalesce_ticks)
+  	    printk(" %lu", (unsigned long) e->coalesce_ticks);
 	if (irq_actids[e->irq] & (1 << i))
 		printk("masked");
 	printk("\n");
@@ -42,7 +42,7 @@ void rproc_dmp()
   printk("----label---- endpoint- -pid- flags -dev- -T- alive_tm starts command\n");
   for (i=prev_i; i<NR_SYS_PROCS; i++) {
   	rp = &rproc[i];
-  	if (!(rp->r_flags & RS_IN_USE)) continue;
+  	if (!(rp->r_flags & (RS_IN_USE|RS_WAITING))) continue;
   	if (++n > 22) break;
   	printk("%13s %9d %5d %5s %3d/%1d %3u %8u %5dx %s",
   		rp->r_label, rp->r_proc_nr_e, rp->r_pid,
@@ -65,7 +65,7 @@ static char *s_flags_str(int flags)
 	str[1] = (flags & RS_EXITING)       ? 'E' : '-';
 	str[2] = (flags & RS_REFRESHING)    ? 'R' : '-';
 	str[3] = (flags & RS_NOPINGREPLY)   ? 'N' : '-';
-	str[4] = '-';
+	str[4] = (flags & RS_WAITING)       ? 'W' : '-';
 	str[5] = '\0';
 
 	return(str);
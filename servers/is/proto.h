@@ -29,6 +29,8 @@ void kmessages_dmp(void);
 void cmdline_params_dmp(void);
 void kenv_dmp(void);
 void timing_dmp(void);
+void ipcstats_dmp(void);
+void ipctrace_dmp(void);
 
 /* dmp_pm.c */
 void mproc_dmp(void);
@@ -35,4 +35,7 @@ extern int exec_pipe[2];
 /* Enable/disable verbose output. */
 extern long rs_verbose;
 
+/* Report when the system services come up. */
+extern long rs_boottrace;
+
 #endif /* __RS_GLO_H */
@@ -334,6 +334,7 @@ static void init_server(void)
 
   /* See if we run in verbose mode. */
   env_parse("rs_verbose", "d", 0, &rs_verbose, 0, 1);
+  env_parse("rs_boottrace", "d", 0, &rs_boottrace, 0, 1);
 
   /* Get a copy of the boot image table. */
   if ((s = sys_getimage(boot_image_tab)) != 0)
@@ -490,6 +491,7 @@ static void init_server(void)
       rp->r_stop_tm = 0;                       /* not exiting yet */
       rp->r_restarts = 0;                      /* no restarts so far */
       rp->r_set_resources = 0;                 /* don't set resources */
+      rp->r_spare_pid = -1;                    /* no standby */
 
       /* Mark as in use. */
       rp->r_flags = RS_IN_USE;
@@ -608,6 +610,14 @@ static void init_server(void)
   */
   unmap_ok = 1;
   unmap_page_zero();
+
+  if(rs_boottrace) {
+      clock_t now;
+
+      getuptime(&now);
+      printk("RS: boot trace: boot image services up at %lu ms\n",
+          now * 1000 / sys_hz());
+  }
 }
 
 /*===========================================================================*
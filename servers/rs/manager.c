@@ -31,7 +31,13 @@ static int caller_can_control(endpoint_t endpoint,
 static int copy_label(endpoint_t src_e,
 	struct rss_label *src_label, char *dst_label, size_t dst_len);
 static int start_service(struct rproc *rp, int flags, endpoint_t *ep);
+static pid_t fork_service(struct rproc *rp, int use_copy);
+static int load_service(struct rproc *rp, endpoint_t proc_e);
+static int run_service(struct rproc *rp, int sync_vfs, endpoint_t *ep);
 static int stop_service(struct rproc *rp,int how);
+static void start_standby(struct rproc *rp);
+static int take_standby(struct rproc *rp, endpoint_t *ep);
+static void stop_standby(struct rproc *rp);
 static int fork_nb(void);
 static int read_exec(struct rproc *rp);
 static int share_exec(struct rproc *rp_src,
@@ -43,6 +49,10 @@ static void add_forward_ipc(struct rproc *rp, struct priv *privp);
 static void add_backward_ipc(struct rproc *rp, struct priv *privp);
 static void init_privs(struct rproc *rp, struct priv *privp);
 static void init_pci(struct rproc *rp, int endpoint);
+static int deps_running(struct rproc *rp);
+static void start_waiting(void);
+static void end_waiting(struct rproc *rp, int r);
+static void boot_trace(struct rproc *rp);
 static int set_privs(endpoint, privp, req);
 
 static int shutting_down = FALSE;
@@ -161,7 +171,7 @@ kipc_msg_t *m_ptr;					/* request message pointer */
   /* See if there is a free entry in the table with system processes. */
   for (slot_nr = 0; slot_nr < NR_SYS_PROCS; slot_nr++) {
       rp = &rproc[slot_nr];			/* get pointer to slot */
-      if (!(rp->r_flags & RS_IN_USE)) 		/* check if available */
+      if (!(rp->r_flags & (RS_IN_USE|RS_WAITING)))	/* check if available */
 	  break;
   }
   if (slot_nr >= NR_SYS_PROCS)
@@ -263,10 +273,26 @@ kipc_msg_t *m_ptr;					/* request message pointer */
 	}
   }
 
+  rp->r_nr_depend = 0;
+  if(rs_start.rss_nr_depend > 0) {
+	if (rs_start.rss_nr_depend > RSS_NR_DEPEND)
+	{
+		printk("RS: do_up: too many dependencies\n");
+		return -EINVAL;
+	}
+	for (i=0; i<rs_start.rss_nr_depend; i++) {
+		s = copy_label(m_ptr->m_source, &rs_start.rss_depend[i],
+			rp->r_depend[i], sizeof(rp->r_depend[i]));
+		if(s != 0)
+			return s;
+	}
+	rp->r_nr_depend = rs_start.rss_nr_depend;
+  }
+
   /* Check for duplicates */
   for (slot_nr = 0; slot_nr < NR_SYS_PROCS; slot_nr++) {
       tmp_rp = &rproc[slot_nr];			/* get pointer to slot */
-      if (!(tmp_rp->r_flags & RS_IN_USE)) 	/* check if available */
+      if (!(tmp_rp->r_flags & (RS_IN_USE|RS_WAITING)))	/* check if available */
 	  continue;
       if (tmp_rp == rp)
 	  continue;				/* Our slot */
@@ -336,6 +362,10 @@ kipc_msg_t *m_ptr;					/* request message pointer */
 		return s;
 
 	rp->r_sys_flags |= SF_USE_COPY;
+
+	/* A standby is started from the copy, so only copied ones get one. */
+	if (rs_start.rss_flags & RF_STANDBY)
+		rp->r_sys_flags |= SF_STANDBY;
   }
 
   /* All dynamically created services get the same privilege flags, and
@@ -425,6 +455,7 @@ kipc_msg_t *m_ptr;					/* request message pointer */
   rp->r_dev_style = STYLE_DEV; 
   rp->r_restarts = -1; 				/* will be incremented */
   rp->r_set_resources= 1;			/* set resources */
+  rp->r_spare_pid = -1;				/* standby comes later */
 
   if (sizeof(rp->r_vm) == sizeof(rs_start.rss_vm) &&
       sizeof(rp->r_vm[0]) == sizeof(rs_start.rss_vm[0]))
@@ -437,13 +468,133 @@ kipc_msg_t *m_ptr;					/* request message pointer */
 	  memset(rp->r_vm, '\0', sizeof(rp->r_vm));
   }
 
-  /* All information was gathered. Now try to start the system service. */
+  getuptime(&rp->r_up_tm);
+
+  /* All information was gathered. If the services this one depends on are
+   * not running yet, hold it back and reply once it has been started. This
+   * way independent services can be brought up at the same time.
+   */
+  if (!deps_running(rp)) {
+	if(rs_verbose)
+		printk("RS: do_up: '%s' waits for its dependencies\n",
+			rp->r_label);
+	rp->r_flags = RS_WAITING;
+	rp->r_caller = m_ptr->m_source;
+	return -EDONTREPLY;
+  }
+
+  /* Now try to start the system service. */
   r = start_service(rp, 0, &ep);
   m_ptr->RS_ENDPOINT = ep;
+  if (r == 0) {
+	boot_trace(rp);
+	start_waiting();
+  }
   return r;
 }
 
 
+/*===========================================================================*
+ *				deps_running				     *
+ *===========================================================================*/
+static int deps_running(rp)
+struct rproc *rp;
+{
+/* See if all services the given one depends on are running. */
+  struct rproc *dep_rp;
+  int i;
+
+  for (i = 0; i < rp->r_nr_depend; i++) {
+	for (dep_rp=BEG_RPROC_ADDR; dep_rp<END_RPROC_ADDR; dep_rp++) {
+		if ((dep_rp->r_flags & RS_IN_USE) &&
+		    !(dep_rp->r_flags & RS_EXITING) && dep_rp->r_pid > 0 &&
+		    strcmp(dep_rp->r_label, rp->r_depend[i]) == 0)
+			break;
+	}
+	if (dep_rp == END_RPROC_ADDR)
+		return FALSE;
+  }
+  return TRUE;
+}
+
+
+/*===========================================================================*
+ *				start_waiting				     *
+ *===========================================================================*/
+static void start_waiting()
+{
+/* Start the services whose dependencies are running now and send the late
+ * reply to their RS_UP callers. Starting one may unblock others.
+ */
+  struct rproc *rp;
+  kipc_msg_t m;
+  endpoint_t ep;
+  int started;
+
+  do {
+	started = FALSE;
+	for (rp=BEG_RPROC_ADDR; rp<END_RPROC_ADDR; rp++) {
+		if (!(rp->r_flags & RS_WAITING) || !deps_running(rp))
+			continue;
+
+		rp->r_flags = 0;
+		ep = ENDPT_NONE;
+		m.m_type = start_service(rp, 0, &ep);
+		m.RS_ENDPOINT = ep;
+		if (m.m_type == 0) {
+			boot_trace(rp);
+			started = TRUE;
+		}
+
+		if (kipc_module_call(KIPC_SEND, KIPC_FLG_NONBLOCK, rp->r_caller,
+			&m) != 0) {
+			printk("RS: unable to send reply to %d\n", rp->r_caller);
+		}
+	}
+  } while (started);
+}
+
+
+/*===========================================================================*
+ *				end_waiting				     *
+ *===========================================================================*/
+static void end_waiting(rp, r)
+struct rproc *rp;
+int r;
+{
+/* Give up on a service that was never started. Its RS_UP caller gets the
+ * error, as it would have for a service that failed to start right away.
+ */
+  kipc_msg_t m;
+
+  m.m_type = r;
+  m.RS_ENDPOINT = ENDPT_NONE;
+  if (kipc_module_call(KIPC_SEND, KIPC_FLG_NONBLOCK, rp->r_caller, &m) != 0)
+	printk("RS: unable to send reply to %d\n", rp->r_caller);
+  free_slot(rp);
+}
+
+
+/*===========================================================================*
+ *				boot_trace				     *
+ *===========================================================================*/
+static void boot_trace(rp)
+struct rproc *rp;
+{
+/* Report when a service was started and how long it waited for that. */
+  clock_t now;
+  u32_t hz;
+
+  if (!rs_boottrace)
+	return;
+
+  getuptime(&now);
+  hz = sys_hz();
+  printk("RS: boot trace: '%s' up at %lu ms, waited %lu ms\n", rp->r_label,
+	now * 1000 / hz, (now - rp->r_up_tm) * 1000 / hz);
+}
+
+
 /*===========================================================================*
  *				do_down					     *
  *===========================================================================*/
@@ -467,6 +618,11 @@ int do_down(kipc_msg_t *m_ptr)
   label[len]= '\0';
 
 	for (rp=BEG_RPROC_ADDR; rp<END_RPROC_ADDR; rp++) {
+		if (rp->r_flags & RS_WAITING && strcmp(rp->r_label, label) == 0) {
+			/* Never started, let the RS_UP caller know. */
+			end_waiting(rp, -EINTR);
+			return(0);
+		}
 		if (rp->r_flags & RS_IN_USE && strcmp(rp->r_label, label) == 0) {
 			if(rs_verbose)
 				printk("RS: stopping '%s' (%d)\n", label, rp->r_pid);
@@ -658,9 +814,14 @@ void do_exit(kipc_msg_t *m_ptr)
 	}
 
       /* Search the system process table to see who exited. 
-       * This should always succeed. 
+       * This should always succeed, except for standbys that were stopped.
        */
       for (rp=BEG_RPROC_ADDR; rp<END_RPROC_ADDR; rp++) {
+          if ((rp->r_flags & RS_IN_USE) && rp->r_spare_pid == exit_pid) {
+	      /* Forget the standby, do_period() starts a new one. */
+	      rp->r_spare_pid = -1;
+	      break;
+	  }
           if ((rp->r_flags & RS_IN_USE) && rp->r_pid == exit_pid) {
 	      int proc;
 	      proc = _ENDPOINT_P(rp->r_proc_nr_e);
@@ -712,7 +873,15 @@ rp->r_restarts= 0;
 		  else
 			rp->r_flags |= RS_CRASHED;
 
-		  if (rp->r_script[0] != '\0') {
+		  if (rp->r_spare_pid > 0) {
+			/* Switch to the standby, whatever the backoff. A new
+			 * one is only ready in the next period, so repeated
+			 * failures still back off.
+			 */
+			if (take_standby(rp, &ep) == 0 && m_ptr)
+				m_ptr->RS_ENDPOINT = ep;
+		  }
+		  else if (rp->r_script[0] != '\0') {
 			if(rs_verbose)
 				printk("RS: running restart script for %s\n",
 					rp->r_cmd);
@@ -748,10 +917,19 @@ void do_period(m_ptr)
 kipc_msg_t *m_ptr;
 {
   register struct rproc *rp;
+  static clock_t period_tm;		/* start of the current RS period */
   clock_t now = m_ptr->NOTIFY_TIMESTAMP;
-  int s;
+  int s, new_period, standby;
   endpoint_t ep;
 
+  /* The alarm goes off more often while services with a standby are around,
+   * see below. The backoff is still counted in RS_DELTA_T periods.
+   */
+  new_period = (now - period_tm >= RS_DELTA_T);
+  if (new_period)
+      period_tm = now;
+  standby = FALSE;
+
   /* Search system services table. Only check slots that are in use. */
   for (rp=BEG_RPROC_ADDR; rp<END_RPROC_ADDR; rp++) {
       if (rp->r_flags & RS_IN_USE) {
@@ -761,8 +939,7 @@ kipc_msg_t *m_ptr;
 	   * greater than zero. 
 	   */
 	  if (rp->r_backoff > 0) {
-              rp->r_backoff -= 1;
-	      if (rp->r_backoff == 0) {
+	      if (new_period && --rp->r_backoff == 0) {
 		  start_service(rp, 0, &ep);
 	  	  m_ptr->RS_ENDPOINT = ep;
 	      }
@@ -784,10 +961,13 @@ kipc_msg_t *m_ptr;
 	      /* Check if an answer to a status request is still pending. If 
 	       * the module didn't respond within time, kill it to simulate 
 	       * a crash. The failure will be detected and the service will 
-	       * be restarted automatically.
+	       * be restarted automatically. A service with a standby is
+	       * replaced cheaply, so it gets only half a period to respond.
 	       */
               if (rp->r_alive_tm < rp->r_check_tm) { 
-	          if (now - rp->r_alive_tm > 2*rp->r_period &&
+	          if (((rp->r_sys_flags & SF_STANDBY) ?
+		       now - rp->r_check_tm > rp->r_period/2 :
+		       now - rp->r_alive_tm > 2*rp->r_period) &&
 		      rp->r_pid > 0 && !(rp->r_flags & RS_NOPINGREPLY)) { 
 		      if(rs_verbose)
                            printk("RS: service %d reported late\n",
@@ -809,11 +989,33 @@ kipc_msg_t *m_ptr;
 		  rp->r_check_tm = now;			/* mark time */
               }
           }
+
+	  /* Keep a standby ready for the services that want one. */
+	  if ((rp->r_sys_flags & SF_STANDBY) && !shutting_down) {
+	      standby = TRUE;
+	      if (rp->r_spare_pid <= 0 && rp->r_pid > 0 &&
+		  !(rp->r_flags & RS_EXITING))
+		  start_standby(rp);
+	  }
+      }
+  }
+
+  /* Services may be waiting for one that has been restarted. Those whose
+   * dependencies did not come up in time are not started at all.
+   */
+  start_waiting();
+  for (rp=BEG_RPROC_ADDR; rp<END_RPROC_ADDR; rp++) {
+      if ((rp->r_flags & RS_WAITING) && now - rp->r_up_tm > RS_WAIT_T) {
+	  printk("RS: '%s' timed out waiting for its dependencies\n",
+		rp->r_label);
+	  end_waiting(rp, -ETIMEDOUT);
       }
   }
 
-  /* Reschedule a synchronous alarm for the next period. */
-  if ((s=sys_setalarm(RS_DELTA_T, 0)) != 0)
+  /* Reschedule a synchronous alarm for the next period. Check more often
+   * when services have a standby, so that their failures are noticed early.
+   */
+  if ((s=sys_setalarm(standby ? RS_STANDBY_DELTA_T : RS_DELTA_T, 0)) != 0)
       panic("RS", "couldn't set alarm", s);
 }
 
@@ -832,11 +1034,7 @@ endpoint_t *endpoint;
  */
   int child_proc_nr_e, child_proc_nr_n;		/* child process slot */
   pid_t child_pid;				/* child's process id */
-  char *file_only;
-  int s, use_copy, slot_nr;
-  bitchunk_t *vm_mask;
-  kipc_msg_t m;
-  char * null_env = NULL;
+  int s, use_copy;
 
   use_copy= (rp->r_sys_flags & SF_USE_COPY);
 
@@ -847,6 +1045,54 @@ endpoint_t *endpoint;
 	return(-EPERM);
   }
 
+  if ((child_pid = fork_service(rp, use_copy)) == -1)
+      return(errno);
+  child_proc_nr_e = getnprocnr(child_pid);		/* get child slot */
+
+  /* Regardless of any following failures, there is now a child process.
+   * Update the system process table that is maintained by the RS server.
+   */
+  child_proc_nr_n = _ENDPOINT_P(child_proc_nr_e);
+  rp->r_flags = RS_IN_USE | flags;		/* mark slot in use */
+  rp->r_restarts += 1;				/* raise nr of restarts */
+  rp->r_proc_nr_e = child_proc_nr_e;		/* set child details */
+  rp->r_pid = child_pid;
+  rp->r_check_tm = 0;				/* not checked yet */
+  getuptime(&rp->r_alive_tm); 			/* currently alive */
+  rp->r_stop_tm = 0;				/* not exiting yet */
+  rp->r_backoff = 0;				/* not to be restarted */
+  rproc_ptr[child_proc_nr_n] = rp;		/* mapping for fast access */
+
+  /* If any of the calls below fail, the RS_EXITING flag is set. This implies
+   * that the process will be removed from RS's process table once it has
+   * terminated. The assumption is that it is not useful to try to restart the
+   * process later in these failure cases.
+   */
+  if ((s = load_service(rp, child_proc_nr_e)) != 0) {
+	kill(child_pid, SIGKILL);
+	rp->r_flags |= RS_EXITING;	/* don't try again */
+	return(s);
+  }
+
+  return(run_service(rp, use_copy, endpoint));
+}
+
+/*===========================================================================*
+ *				fork_service				     *
+ *===========================================================================*/
+static pid_t fork_service(rp, use_copy)
+struct rproc *rp;
+int use_copy;
+{
+/* Fork a process for the given service. The child does not run before its
+ * privileges are set. Without a copy it executes the binary itself then,
+ * otherwise the image is loaded into it by load_service() before.
+ */
+  pid_t child_pid;				/* child's process id */
+  char *file_only;
+  int s, slot_nr;
+  char * null_env = NULL;
+
   /* Now fork and branch for parent and child process (and check for error). */
   if (use_copy) {
   if(rs_verbose) printk("RS: fork_nb..\n");
@@ -859,7 +1105,7 @@ endpoint_t *endpoint;
   switch(child_pid) {					/* see fork(2) */
   case -1:						/* fork failed */
       report("RS", "warning, fork() failed", errno);	/* shouldn't happen */
-      return(errno);					/* return error */
+      return(-1);					/* return error */
 
   case 0:						/* child process */
       /* Try to execute the binary that has an absolute path. If this fails, 
@@ -887,71 +1133,76 @@ endpoint_t *endpoint;
   default:						/* parent process */
 #if 0
       if(rs_verbose) printk("RS: parent forked, pid %d..\n", child_pid);
-#endif
-      child_proc_nr_e = getnprocnr(child_pid);		/* get child slot */ 
-#if 0
-      if(rs_verbose) printk("RS: forked into %d..\n", child_proc_nr_e);
 #endif
       break;						/* continue below */
   }
 
-  /* Regardless of any following failures, there is now a child process.
-   * Update the system process table that is maintained by the RS server.
-   */
-  child_proc_nr_n = _ENDPOINT_P(child_proc_nr_e);
-  rp->r_flags = RS_IN_USE | flags;		/* mark slot in use */
-  rp->r_restarts += 1;				/* raise nr of restarts */
-  rp->r_proc_nr_e = child_proc_nr_e;		/* set child details */
-  rp->r_pid = child_pid;
-  rp->r_check_tm = 0;				/* not checked yet */
-  getuptime(&rp->r_alive_tm); 			/* currently alive */
-  rp->r_stop_tm = 0;				/* not exiting yet */
-  rp->r_backoff = 0;				/* not to be restarted */
-  rproc_ptr[child_proc_nr_n] = rp;		/* mapping for fast access */
+  return(child_pid);
+}
 
-  /* If any of the calls below fail, the RS_EXITING flag is set. This implies
-   * that the process will be removed from RS's process table once it has
-   * terminated. The assumption is that it is not useful to try to restart the
-   * process later in these failure cases.
-   */
+/*===========================================================================*
+ *				load_service				     *
+ *===========================================================================*/
+static int load_service(rp, proc_e)
+struct rproc *rp;
+endpoint_t proc_e;
+{
+/* Copy the executable image into a freshly forked process and tell VM about
+ * it. The process still cannot run. The caller kills it when this fails.
+ */
+  bitchunk_t *vm_mask;
+  int s;
 
-  if (use_copy)
+  if (rp->r_sys_flags & SF_USE_COPY)
   {
 	extern char **environ;
 
 	/* Copy the executable image into the child process. If this call
 	 * fails, the child process may or may not be killed already. If it is
-	 * not killed, it's blocked because of NO_PRIV. Kill it now either way.
+	 * not killed, it's blocked because of NO_PRIV.
 	 */
-	s = dev_execve(child_proc_nr_e, rp->r_exec, rp->r_exec_len, rp->r_argv,
+	s = dev_execve(proc_e, rp->r_exec, rp->r_exec_len, rp->r_argv,
 		environ);
 	if (s != 0) {
 		report("RS", "dev_execve call failed", s);
-		kill(child_pid, SIGKILL);
-		rp->r_flags |= RS_EXITING;	/* don't try again */
 		return(s);
 	}
   }
 
-  /* Set resources when asked to. */
+  /* Tell VM about allowed calls when asked to set resources. */
   if (rp->r_set_resources)
   {
-	/* Initialize privilege structure. */
-	init_privs(rp, &rp->r_priv);
-
-	/* Tell VM about allowed calls. */
 	vm_mask = &rp->r_vm[0];
-	if ((s = vm_set_priv(child_proc_nr_e, vm_mask)) < 0) {
+	if ((s = vm_set_priv(proc_e, vm_mask)) < 0) {
 	    report("RS", "vm_set_priv call failed", s);
-	    kill(child_pid, SIGKILL);
-	    rp->r_flags |= RS_EXITING;
 	    return (s);
 	}
   }
 
+  return(0);
+}
+
+/*===========================================================================*
+ *				run_service				     *
+ *===========================================================================*/
+static int run_service(rp, sync_vfs, endpoint)
+struct rproc *rp;
+int sync_vfs;
+endpoint_t *endpoint;
+{
+/* Publish the loaded process of the given service and let it run. */
+  int s;
+
+  /* Set resources when asked to. */
+  if (rp->r_set_resources)
+  {
+	/* Initialize privilege structure. */
+	init_privs(rp, &rp->r_priv);
+  }
+
   /* If PCI properties are set, inform the PCI driver about the new service. */
   if(rp->r_nr_pci_id || rp->r_nr_pci_class) {
-      init_pci(rp, child_proc_nr_e);
+      init_pci(rp, rp->r_proc_nr_e);
   }
 
   /* Publish the new system service. */
@@ -969,13 +1220,15 @@ endpoint_t *endpoint;
    * driver entry. The following temporary hack works around this by forcing
    * blocking communication from PM to VFS. Once VFS has been made non-blocking
    * towards MFS instances, this hack and the entire fork_nb() call can go.
+   * A standby was forked long ago, VFS knows about it already.
    */
-  if (use_copy)
+  if (sync_vfs)
 	setuid(0);
 
   if (rp->r_dev_nr > 0) {				/* set driver map */
       if ((s=mapdriver5(rp->r_label, strlen(rp->r_label),
-	      rp->r_dev_nr, rp->r_dev_style, !!use_copy /* force */)) < 0) {
+	      rp->r_dev_nr, rp->r_dev_style,
+	      !!(rp->r_sys_flags & SF_USE_COPY) /* force */)) < 0) {
           report("RS", "couldn't map driver (continuing)", errno);
       }
   }
@@ -984,27 +1237,109 @@ endpoint_t *endpoint;
    * That will also cause the child process to start running.
    * This call should succeed: we tested number in use above.
    */
-  if ((s = set_privs(child_proc_nr_e, &rp->r_priv, SYS_PRIV_SET_SYS)) != 0) {
+  if ((s = set_privs(rp->r_proc_nr_e, &rp->r_priv, SYS_PRIV_SET_SYS)) != 0) {
       report("RS","set_privs failed", s);
-      kill(child_pid, SIGKILL);				/* kill the module */
+      kill(rp->r_pid, SIGKILL);				/* kill the module */
       rp->r_flags |= RS_EXITING;			/* expect exit */
       return(s);					/* return error */
   }
 
   if(rs_verbose)
       printk("RS: started '%s', major %d, pid %d, endpoint %d, proc %d\n", 
-          rp->r_cmd, rp->r_dev_nr, child_pid,
-	  child_proc_nr_e, child_proc_nr_n);
+          rp->r_cmd, rp->r_dev_nr, rp->r_pid,
+	  rp->r_proc_nr_e, _ENDPOINT_P(rp->r_proc_nr_e));
 
   /* The system service now has been successfully started. The only thing
    * that can go wrong now, is that execution fails at the child. If that's
    * the case, the child will exit. 
    */
-  if(endpoint) *endpoint = child_proc_nr_e;	/* send back child endpoint */
+  if(endpoint) *endpoint = rp->r_proc_nr_e;	/* send back child endpoint */
 
   return(0);
 }
 
+/*===========================================================================*
+ *				start_standby				     *
+ *===========================================================================*/
+static void start_standby(rp)
+struct rproc *rp;
+{
+/* Prepare a hot standby for the given service: a process forked and loaded
+ * from the in-memory copy, that is kept blocked by NO_PRIV until the service
+ * fails. Taking it over then only needs the steps of run_service().
+ */
+  pid_t spare_pid;
+  endpoint_t spare_e;
+
+  if ((spare_pid = fork_service(rp, TRUE)) == -1)
+	return;
+  spare_e = getnprocnr(spare_pid);
+
+  if (load_service(rp, spare_e) != 0) {
+	kill(spare_pid, SIGKILL);
+	return;
+  }
+
+  rp->r_spare_e = spare_e;
+  rp->r_spare_pid = spare_pid;
+
+  if(rs_verbose)
+      printk("RS: standby for '%s' ready, pid %d, endpoint %d\n",
+	  rp->r_label, spare_pid, spare_e);
+}
+
+/*===========================================================================*
+ *				take_standby				     *
+ *===========================================================================*/
+static int take_standby(rp, endpoint)
+struct rproc *rp;
+endpoint_t *endpoint;
+{
+/* Replace the failed process of the given service with its standby. Report
+ * how long the service was gone, counted from its last heartbeat reply.
+ */
+  clock_t now, last_tm;
+  int s;
+
+  last_tm = rp->r_alive_tm;
+  rp->r_flags = RS_IN_USE;			/* forget the failure */
+  rp->r_restarts += 1;				/* raise nr of restarts */
+  rp->r_proc_nr_e = rp->r_spare_e;		/* set standby details */
+  rp->r_pid = rp->r_spare_pid;
+  rp->r_check_tm = 0;				/* not checked yet */
+  getuptime(&rp->r_alive_tm); 			/* currently alive */
+  rp->r_stop_tm = 0;				/* not exiting yet */
+  rp->r_backoff = 0;				/* not to be restarted */
+  rproc_ptr[_ENDPOINT_P(rp->r_proc_nr_e)] = rp;
+  rp->r_spare_pid = -1;				/* start a new one later */
+
+  if ((s = run_service(rp, FALSE, endpoint)) != 0)
+	return(s);
+
+  getuptime(&now);
+  if (rp->r_period > 0)
+	printk("RS: '%s' replaced by its standby, %lu ms after last heartbeat\n",
+		rp->r_label, (now - last_tm) * 1000 / sys_hz());
+  else
+	printk("RS: '%s' replaced by its standby\n", rp->r_label);
+  return(0);
+}
+
+/*===========================================================================*
+ *				stop_standby				     *
+ *===========================================================================*/
+static void stop_standby(rp)
+struct rproc *rp;
+{
+/* Get rid of the standby of a service that goes away. It never ran, so it
+ * is killed right away. Its exit is not reported to any slot.
+ */
+  if (rp->r_spare_pid > 0) {
+	kill(rp->r_spare_pid, SIGKILL);
+	rp->r_spare_pid = -1;
+  }
+}
+
 /*===========================================================================*
  *				stop_service				     *
  *===========================================================================*/
@@ -1149,7 +1484,7 @@ struct rproc *rp;
       has_shared_exec = FALSE;
       for (slot_nr = 0; slot_nr < NR_SYS_PROCS; slot_nr++) {
           other_rp = &rproc[slot_nr];		/* get pointer to slot */
-          if (other_rp->r_flags & RS_IN_USE && other_rp != rp
+          if (other_rp->r_flags & (RS_IN_USE|RS_WAITING) && other_rp != rp
               && other_rp->r_exec == rp->r_exec) {  /* found! */
               has_shared_exec = TRUE;
           }
@@ -1166,9 +1501,13 @@ struct rproc *rp;
       }
   }
 
-  /* Mark slot as no longer in use.. */
+  /* A standby is of no use anymore. */
+  stop_standby(rp);
+
+  /* Mark slot as no longer in use.. A waiting service never had a process. */
+  if (!(rp->r_flags & RS_WAITING))
+      rproc_ptr[_ENDPOINT_P(rp->r_proc_nr_e)] = NULL;
   rp->r_flags = 0;
-  rproc_ptr[_ENDPOINT_P(rp->r_proc_nr_e)] = NULL;
 }
 
 /*===========================================================================*
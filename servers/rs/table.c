@@ -83,3 +83,4 @@ int exec_pipe[2];
 
 /* Enable/disable verbose output. */
 long rs_verbose;
+long rs_boottrace;
@@ -379,6 +379,12 @@ static void vm_init(void)
 	CALLMAP(VM_CTL, do_ctl, NEEDACL);
 	CALLMAP(VM_QUERY_EXIT, do_query_exit, NEEDACL);
 
+#ifdef CONFIG_MEMORY_RAMDISK_MAP
+	/* The memory driver maps RAM disks into file servers. */
+	CALLMAP(VM_REMAP, do_remap, MEM_PROC_NR);
+	CALLMAP(VM_SHM_UNMAP, do_shared_unmap, MEM_PROC_NR);
+#endif
+
 	/* Sanity checks */
 	if(find_kernel_top() >= VM_PROCSTART)
 		vm_panic("kernel loaded too high", NO_NUM);